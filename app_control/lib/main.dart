@@ -1,6 +1,7 @@
 import 'dart:async';
 import 'dart:convert';
 import 'dart:io';
+import 'dart:typed_data';
 
 import 'package:flutter/material.dart';
 import 'package:flutter/services.dart';
@@ -214,7 +215,7 @@ class UdpSender {
 
   final String host;
   final int port;
-  final void Function(String data, InternetAddress address)? onMessage;
+  final void Function(Uint8List data, InternetAddress address)? onMessage;
 
   RawDatagramSocket? _socket;
   InternetAddress? _address;
@@ -229,8 +230,7 @@ class UdpSender {
       if (event == RawSocketEvent.read) {
         final datagram = _socket!.receive();
         if (datagram != null) {
-          final msg = utf8.decode(datagram.data);
-          onMessage?.call(msg, datagram.address);
+          onMessage?.call(datagram.data, datagram.address);
         }
       }
     });
@@ -252,6 +252,13 @@ class UdpSender {
     } catch (_) {}
   }
 
+  void sendBytesTo(InternetAddress addr, List<int> data, {int? toPort}) {
+    if (_socket == null) return;
+    try {
+      _socket!.send(data, addr, toPort ?? port);
+    } catch (_) {}
+  }
+
   void dispose() {
     _socket?.close();
     _socket = null;
@@ -293,21 +300,29 @@ class _ControlScreenState extends State<ControlScreen>
   bool _leftPressed = false;
   bool _rightPressed = false;
   bool _gyroPressed = false;
-  int _gyroSteer = 0;
+  int _gyroSteer = 0; // absolute target from the phone's turn
+  double _gyroAngle = 0; // rad turned since the gyro button went down
+  DateTime? _gyroLastAt;
+  static const double _gyroFullLockRad = 0.6; // ~35 degrees of phone turn
   StreamSubscription<GyroscopeEvent>? _gyroSub;
   bool _parkBlinkOn = false;
-  static const Duration _steerHoldLimit = Duration(seconds: 4);
-  DateTime? _steerHoldStartedAt;
-  bool _steerHoldLockedUntilRelease = false;
-  int _steerHoldDirection = 0; // -1 left, 1 right
   Timer? _parkBlinkTimer;
   Timer? _txTimer;
   Timer? _connectProbeTimer;
 
   double _batteryVoltage = 12.00;
+  int? _batterySoc;
+  int? _runtimeMin;
+  int? _powerLimitPct;
   double _dangerBatteryVolt = 10.8;
   bool _manualMode = false;
   bool _espManualMode = false;
+  bool _espBinary = false;
+  int _txSeq = 0;
+  final Stopwatch _txClock = Stopwatch()..start();
+  // Binary status replies; set false to get JSON status for debugging.
+  static const bool _kBinaryStatus = true;
+  static const int _kEstopPort = 4211; // ESTOP_UDP_PORT on the ESP
   String _manualGear = 'N';
   int _signal = 66; // updated from Wi-Fi RSSI
   bool _connected = false;
@@ -532,55 +547,134 @@ class _ControlScreenState extends State<ControlScreen>
     SystemSound.play(SystemSoundType.alert);
   }
 
-  void _handleUdpMessage(String data, InternetAddress address) {
+  void _handleUdpMessage(Uint8List data, InternetAddress address) {
+    if (data.isNotEmpty && data[0] == 0x5A) {
+      _handleStatusFrame(data, address);
+      return;
+    }
     try {
-      final obj = jsonDecode(data);
+      final obj = jsonDecode(utf8.decode(data));
       if (obj is Map && obj['ok'] == 1) {
-        _lastAck = DateTime.now();
+        _espBinary = obj['bin'] == 1;
         final mode = (obj['mode'] ?? '').toString().toUpperCase();
         final manualGear = (obj['manual_gear'] ?? 'N').toString().toUpperCase();
         final dynamic battRaw = obj['batt_v'];
         final double? battV = battRaw is num
             ? battRaw.toDouble()
             : double.tryParse(battRaw?.toString() ?? '');
-
-        if (!_connected || _signal < 80) {
-          setState(() {
-            _connected = true;
-            _signal = 80;
-            if (mode == 'MANUAL') _espManualMode = true;
-            if (mode == 'REMOTE') _espManualMode = false;
-            _manualGear = (manualGear == 'F' || manualGear == 'R')
-                ? manualGear
-                : 'N';
-            if (battV != null) _batteryVoltage = battV;
-            _espAddress = address;
-          });
-          _udp.address = address;
-        } else if (_espAddress == null ||
-            _espAddress!.address != address.address) {
-          _espAddress = address;
-          _udp.address = address;
-        } else if (battV != null || mode.isNotEmpty) {
-          setState(() {
-            if (battV != null) _batteryVoltage = battV;
-            if (mode == 'MANUAL') _espManualMode = true;
-            if (mode == 'REMOTE') _espManualMode = false;
-            _manualGear = (manualGear == 'F' || manualGear == 'R')
-                ? manualGear
-                : 'N';
-          });
-        }
+        final dynamic socRaw = obj['soc'];
+        final dynamic runtimeRaw = obj['runtime_min'];
+        final dynamic powerRaw = obj['power_limit'];
+        _applyStatus(
+          mode,
+          manualGear,
+          battV,
+          address,
+          soc: socRaw is num ? socRaw.toInt() : null,
+          runtimeMin: runtimeRaw is num && runtimeRaw >= 0
+              ? runtimeRaw.toInt()
+              : null,
+          powerLimitPct: powerRaw is num ? powerRaw.toInt() : null,
+        );
       }
     } catch (_) {
       // ignore parse errors
     }
   }
 
+  // Binary status frame (see spec/protocol.md). Newer firmware may append
+  // fields; the CRC is always the last byte.
+  void _handleStatusFrame(Uint8List data, InternetAddress address) {
+    if (data.length < 15) return;
+    if (_crc8(data, data.length - 1) != data[data.length - 1]) return;
+    _espBinary = true;
+    final flags = data[2];
+    final mode = (flags & 0x01) != 0 ? 'MANUAL' : 'REMOTE';
+    final gearCode = (flags >> 3) & 0x03;
+    final manualGear = gearCode == 1 ? 'F' : (gearCode == 2 ? 'R' : 'N');
+    final battV = (data[6] | (data[7] << 8)) / 1000.0;
+    int? soc;
+    int? runtimeMin;
+    if (data[1] >= 4 && data.length >= 24) {
+      soc = data[20];
+      final rt = data[21] | (data[22] << 8);
+      runtimeMin = rt == 0xFFFF ? null : rt;
+    }
+    int? powerLimitPct;
+    if (data[1] >= 8 && data.length >= 34) {
+      powerLimitPct = data[30];
+    }
+    _applyStatus(
+      mode,
+      manualGear,
+      battV,
+      address,
+      soc: soc,
+      runtimeMin: runtimeMin,
+      powerLimitPct: powerLimitPct,
+    );
+  }
+
+  void _applyStatus(
+    String mode,
+    String manualGear,
+    double? battV,
+    InternetAddress address, {
+    int? soc,
+    int? runtimeMin,
+    int? powerLimitPct,
+  }) {
+    _lastAck = DateTime.now();
+    if (!_connected || _signal < 80) {
+      setState(() {
+        _connected = true;
+        _signal = 80;
+        if (mode == 'MANUAL') _espManualMode = true;
+        if (mode == 'REMOTE') _espManualMode = false;
+        _manualGear = (manualGear == 'F' || manualGear == 'R')
+            ? manualGear
+            : 'N';
+        if (battV != null) _batteryVoltage = battV;
+        _batterySoc = soc;
+        _runtimeMin = runtimeMin;
+        _powerLimitPct = powerLimitPct;
+        _espAddress = address;
+      });
+      _udp.address = address;
+    } else if (_espAddress == null ||
+        _espAddress!.address != address.address) {
+      _espAddress = address;
+      _udp.address = address;
+    } else if (battV != null || mode.isNotEmpty) {
+      setState(() {
+        if (battV != null) _batteryVoltage = battV;
+        _batterySoc = soc;
+        _runtimeMin = runtimeMin;
+        _powerLimitPct = powerLimitPct;
+        if (mode == 'MANUAL') _espManualMode = true;
+        if (mode == 'REMOTE') _espManualMode = false;
+        _manualGear = (manualGear == 'F' || manualGear == 'R')
+            ? manualGear
+            : 'N';
+      });
+    }
+  }
+
+  // Every control packet carries a new sequence number and the sender clock,
+  // so the ESP can drop reordered or delayed ones.
+  int _nextSeq() {
+    _txSeq = (_txSeq + 1) & 0xFFFF;
+    return _txSeq;
+  }
+
+  int _sentMs() => _txClock.elapsedMilliseconds & 0xFFFFFFFF;
+
   Map<String, dynamic> _controlPayload({bool includePing = false}) {
     final payload = {
+      'seq': _nextSeq(),
+      'sent_ms': _sentMs(),
       'throttle': _throttle,
-      'steer': _steer,
+      'steer_pos': _steer,
       'speed': _speed,
       'accel_ms': _accelMs,
       'reverse_speed': _reverseSpeed,
@@ -596,46 +690,75 @@ class _ControlScreenState extends State<ControlScreen>
     return payload;
   }
 
-  int _computeSteerWithHoldLimit() {
-    if (_gyroPressed) {
-      return _gyroSteer;
-    }
-
-    int steer = 0;
-    if (_leftPressed && !_rightPressed) steer = -_speed;
-    if (_rightPressed && !_leftPressed) steer = _speed;
-
-    final int steerDir = steer > 0 ? 1 : (steer < 0 ? -1 : 0);
-    if (steerDir == 0) {
-      _steerHoldStartedAt = null;
-      _steerHoldLockedUntilRelease = false;
-      _steerHoldDirection = 0;
-      return 0;
-    }
-    if (_steerHoldLockedUntilRelease) {
-      return 0;
+  // Binary control frame v2 (see spec/protocol.md). Sent once the ESP
+  // advertises "bin":1 in its status; JSON stays the fallback.
+  Uint8List _controlFrame() {
+    final b = Uint8List(18);
+    final seq = _nextSeq();
+    final sentMs = _sentMs();
+    b[0] = 0xA5;
+    b[1] = 2;
+    b[2] = (_manualMode ? 0x01 : 0) |
+        (_parked ? 0x02 : 0) |
+        (_kBinaryStatus ? 0x04 : 0) |
+        0x08; // steer is an absolute target
+    b[3] = _throttle.clamp(-100, 100) & 0xFF;
+    b[4] = _steer.clamp(-100, 100) & 0xFF;
+    b[5] = _speed.clamp(0, 100);
+    b[6] = _reverseSpeed.clamp(0, 100);
+    b[7] = 0; // steer_ms: unused with an absolute target
+    b[8] = 0;
+    b[9] = _accelMs & 0xFF;
+    b[10] = (_accelMs >> 8) & 0xFF;
+    b[11] = seq & 0xFF;
+    b[12] = (seq >> 8) & 0xFF;
+    b[13] = sentMs & 0xFF;
+    b[14] = (sentMs >> 8) & 0xFF;
+    b[15] = (sentMs >> 16) & 0xFF;
+    b[16] = (sentMs >> 24) & 0xFF;
+    b[17] = _crc8(b, 17);
+    return b;
+  }
+
+  // E-stop frame (see spec/protocol.md), sent to its own port so the ESP
+  // handles it ahead of everything else. Release is harmless when not latched.
+  void _sendEstop(bool stop) {
+    final b = Uint8List(4);
+    b[0] = 0xE5;
+    b[1] = 1;
+    b[2] = stop ? 1 : 0;
+    b[3] = _crc8(b, 3);
+    _udp.sendBytesTo(_espAddress ?? InternetAddress('192.168.4.1'), b,
+        toPort: _kEstopPort);
+  }
+
+  static int _crc8(List<int> data, int len) {
+    int crc = 0;
+    for (int i = 0; i < len; i++) {
+      crc ^= data[i];
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc & 0x80) != 0 ? ((crc << 1) ^ 0x07) & 0xFF : (crc << 1) & 0xFF;
+      }
     }
+    return crc;
+  }
 
-    final now = DateTime.now();
-    if (_steerHoldDirection != steerDir || _steerHoldStartedAt == null) {
-      _steerHoldDirection = steerDir;
-      _steerHoldStartedAt = now;
-      return steer;
-    }
-    if (now.difference(_steerHoldStartedAt!) >= _steerHoldLimit) {
-      _steerHoldLockedUntilRelease = true;
-      return 0;
+  // Absolute steering target (-100 full left .. 100 full right, 0 centre).
+  // The ESP tracks the rack position and stops on the end stops itself, so
+  // a held button is simply held at full lock and release re-centres.
+  int _computeSteerTarget() {
+    if (_gyroPressed) {
+      return _gyroSteer;
     }
-    return steer;
+    if (_leftPressed && !_rightPressed) return -100;
+    if (_rightPressed && !_leftPressed) return 100;
+    return 0;
   }
 
   void _sendState({bool force = false}) {
     if (kIsWeb) return;
     if (_txSilencedByLifecycle && !force) return;
-    final enforcedSteer = _computeSteerWithHoldLimit();
-    if (_steer != enforcedSteer) {
-      _steer = enforcedSteer;
-    }
+    _steer = _computeSteerTarget();
 
     final msSinceAck = DateTime.now().difference(_lastAck).inMilliseconds;
     final isConnected = msSinceAck < 3000;
@@ -658,6 +781,10 @@ class _ControlScreenState extends State<ControlScreen>
     _txCount += 1;
     _lastTx = DateTime.now();
     debugPrint('TX $_txCount @ ${_lastTx.toIso8601String()}');
+    if (_espAddress != null && _espBinary) {
+      _udp.sendBytesTo(_espAddress!, _controlFrame());
+      return;
+    }
     final payload = _controlPayload();
 
     if (_espAddress != null) {
@@ -794,7 +921,7 @@ class _ControlScreenState extends State<ControlScreen>
     int throttle = 0;
     if (_forwardPressed && !_backPressed) throttle = _speed;
     if (_backPressed && !_forwardPressed) throttle = -_reverseSpeed;
-    final steer = _computeSteerWithHoldLimit();
+    final steer = _computeSteerTarget();
 
     setState(() {
       _throttle = throttle;
@@ -876,14 +1003,26 @@ class _ControlScreenState extends State<ControlScreen>
     }
     if (_gyroPressed) return;
     _gyroPressed = true;
+    _gyroAngle = 0;
+    _gyroLastAt = null;
     _gyroSub?.cancel();
     _gyroSub = gyroscopeEventStream().listen((event) {
       if (!_gyroPressed) return;
-      const deadband = 0.25;
-      int nextSteer = 0;
-      if (event.z > deadband) nextSteer = -_speed;
-      if (event.z < -deadband) nextSteer = _speed;
-      if (_gyroSteer != nextSteer) {
+      // Integrate the turn rate into an angle: the phone's heading since the
+      // button went down is the wheel angle. Small rates are sensor noise.
+      final now = DateTime.now();
+      final last = _gyroLastAt;
+      _gyroLastAt = now;
+      if (last == null) return;
+      const noise = 0.05; // rad/s
+      final dt = now.difference(last).inMicroseconds / 1e6;
+      if (event.z.abs() > noise) {
+        _gyroAngle = (_gyroAngle - event.z * dt)
+            .clamp(-_gyroFullLockRad, _gyroFullLockRad);
+      }
+      final nextSteer = (_gyroAngle / _gyroFullLockRad * 100).round();
+      if ((_gyroSteer - nextSteer).abs() >= 5 ||
+          (nextSteer.abs() == 100 && _gyroSteer != nextSteer)) {
         _gyroSteer = nextSteer;
         _applyMotion();
       }
@@ -894,6 +1033,7 @@ class _ControlScreenState extends State<ControlScreen>
   void _gyroUp() {
     _gyroPressed = false;
     _gyroSteer = 0;
+    _gyroAngle = 0;
     _gyroSub?.cancel();
     _gyroSub = null;
     _applyMotion();
@@ -901,6 +1041,10 @@ class _ControlScreenState extends State<ControlScreen>
   }
 
   void _togglePark() {
+    // Parking while driving is an e-stop: the ESP cuts the motors on receipt
+    // and keeps them off until unparked.
+    final bool stopNow = !_parked && _anyPressed();
+    if (stopNow) _sendEstop(true);
     setState(() {
       _parked = !_parked;
       if (_parked) {
@@ -914,6 +1058,7 @@ class _ControlScreenState extends State<ControlScreen>
       _stopTxLoop();
       _applyMotion();
     } else {
+      _sendEstop(false);
       _sendState();
     }
     _persistControls();
@@ -1033,6 +1178,9 @@ class _ControlScreenState extends State<ControlScreen>
                 StatusBarWidget(
                   title: t('app_title'),
                   batteryVoltage: _batteryVoltage,
+                  batterySoc: _batterySoc,
+                  runtimeMin: _runtimeMin,
+                  powerLimitPct: _powerLimitPct,
                   dangerBatteryVolt: _dangerBatteryVolt,
                   signal: _signal,
                   connected: _connected,
@@ -1185,6 +1333,9 @@ class StatusBarWidget extends StatelessWidget {
     super.key,
     required this.title,
     required this.batteryVoltage,
+    this.batterySoc,
+    this.runtimeMin,
+    this.powerLimitPct,
     required this.dangerBatteryVolt,
     required this.signal,
     required this.connected,
@@ -1200,6 +1351,9 @@ class StatusBarWidget extends StatelessWidget {
 
   final String title;
   final double batteryVoltage;
+  final int? batterySoc;
+  final int? runtimeMin;
+  final int? powerLimitPct;
   final double dangerBatteryVolt;
   final int signal;
   final bool connected;
@@ -1212,6 +1366,16 @@ class StatusBarWidget extends StatelessWidget {
   final VoidCallback onWifiTap;
   final VoidCallback onSettingsTap;
 
+  String _batteryText() {
+    final soc = batterySoc != null ? ' $batterySoc%' : '';
+    final runtime = runtimeMin != null ? ' ~${runtimeMin}m' : '';
+    // The car is holding power back to keep the pack above brownout.
+    final limit = powerLimitPct != null && powerLimitPct! < 100
+        ? ' ⚡$powerLimitPct%'
+        : '';
+    return '${batteryVoltage.toStringAsFixed(2)}V$soc$runtime$limit';
+  }
+
   String _timeText() {
     final h = now.hour.toString().padLeft(2, '0');
     final m = now.minute.toString().padLeft(2, '0');
@@ -1287,7 +1451,7 @@ class StatusBarWidget extends StatelessWidget {
           ),
           const SizedBox(width: 8),
           Text(
-            '${batteryVoltage.toStringAsFixed(2)}V',
+            _batteryText(),
             style: const TextStyle(
               color: Colors.white,
               fontSize: 13,
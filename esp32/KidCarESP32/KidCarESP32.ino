@@ -3,6 +3,7 @@
 #include "wifi_ap.h"
 #include "protocol.h"
 #include "control.h"
+#include "log.h"
 
 #if TEST_BLINK
 // RGB LED pin (common for ESP32-S3 boards). If no light, try 38.
@@ -25,11 +26,15 @@ void setup() {
   rgbLedWrite(2, 0, 0, 0);
   rgbLedWrite(21, 0, 0, 0);
 
+  logStartTask();
   setupPins();
   setupPwm();
   controlInit();
 
   wifiApInit();
+#if NET_TASK_ENABLED
+  wifiApStartTask();
+#endif
 #endif
 }
 
@@ -59,12 +64,9 @@ void loop() {
   step = (step + 1) % count;
   delay(400);
 #else
-  static uint32_t lastLog = 0;
-  if (millis() - lastLog >= 5000) {
-    lastLog = millis();
-    Serial.println("KIDCAR RUN");
-  }
+#if !NET_TASK_ENABLED
   wifiApLoop();
+#endif
   controlLoop();
 #endif
 }
@@ -0,0 +1,90 @@
+#include "battery.h"
+#include "config.h"
+
+struct SocPoint {
+  float volts;
+  uint8_t pct;
+};
+
+// Resting open-circuit voltage of a 12 V pack, ascending.
+static constexpr SocPoint SOC_LEAD_ACID[] = {
+  {11.31f, 0},  {11.51f, 10}, {11.66f, 20}, {11.81f, 30}, {11.96f, 40}, {12.10f, 50},
+  {12.24f, 60}, {12.37f, 70}, {12.50f, 80}, {12.62f, 90}, {12.73f, 100},
+};
+
+// LiFePO4 is flat between ~20 and ~90 %, so the ends carry most of the range.
+static constexpr SocPoint SOC_LIFEPO4[] = {
+  {10.00f, 0},  {12.00f, 9},  {12.50f, 14}, {12.80f, 17}, {12.90f, 20}, {13.00f, 30},
+  {13.10f, 40}, {13.20f, 70}, {13.30f, 90}, {13.40f, 99}, {13.60f, 100},
+};
+
+template <size_t N>
+static constexpr bool socTableValid(const SocPoint (&t)[N]) {
+  for (size_t i = 1; i < N; i++) {
+    if (!(t[i].volts > t[i - 1].volts) || t[i].pct < t[i - 1].pct) return false;
+  }
+  return t[0].pct == 0 && t[N - 1].pct == 100;
+}
+static_assert(socTableValid(SOC_LEAD_ACID), "lead-acid SoC table must ascend 0..100");
+static_assert(socTableValid(SOC_LIFEPO4), "LiFePO4 SoC table must ascend 0..100");
+
+static constexpr bool kLifepo4 = BATTERY_CHEMISTRY == BATTERY_LIFEPO4;
+static constexpr const SocPoint* kSocTable = kLifepo4 ? SOC_LIFEPO4 : SOC_LEAD_ACID;
+static constexpr size_t kSocPoints =
+  kLifepo4 ? sizeof(SOC_LIFEPO4) / sizeof(SOC_LIFEPO4[0]) : sizeof(SOC_LEAD_ACID) / sizeof(SOC_LEAD_ACID[0]);
+
+static BatteryState state = {12.0f, 12.0f, 0.0f, 0.0f, 0, BATTERY_RUNTIME_UNKNOWN};
+static uint32_t avgAgeMs = 0;
+
+uint8_t batterySocFromRestVoltage(float restV) {
+  if (restV <= kSocTable[0].volts) return 0;
+  for (size_t i = 1; i < kSocPoints; i++) {
+    if (restV < kSocTable[i].volts) {
+      const SocPoint& lo = kSocTable[i - 1];
+      const SocPoint& hi = kSocTable[i];
+      const float t = (restV - lo.volts) / (hi.volts - lo.volts);
+      return (uint8_t)((float)lo.pct + t * (float)(hi.pct - lo.pct) + 0.5f);
+    }
+  }
+  return 100;
+}
+
+static float modelLoadA(uint8_t rearDutyPct) {
+  return BATTERY_IDLE_A + BATTERY_FULL_DUTY_A * (float)rearDutyPct / 100.0f;
+}
+
+static uint16_t runtimeMinutes() {
+  if (avgAgeMs < BATTERY_RUNTIME_SETTLE_MS || state.avgLoadA <= 0.0f) return BATTERY_RUNTIME_UNKNOWN;
+  const float remainingAh = BATTERY_CAPACITY_AH * (float)state.socPct / 100.0f;
+  const float minutes = remainingAh / state.avgLoadA * 60.0f;
+  if (minutes >= (float)(BATTERY_RUNTIME_UNKNOWN - 1)) return BATTERY_RUNTIME_UNKNOWN - 1;
+  return (uint16_t)minutes;
+}
+
+void batteryReset(float measuredV) {
+  state.measuredV = measuredV;
+  state.restV = measuredV;
+  state.loadA = modelLoadA(0);
+  state.avgLoadA = state.loadA;
+  state.socPct = batterySocFromRestVoltage(measuredV);
+  avgAgeMs = 0;
+  state.runtimeMin = runtimeMinutes();
+}
+
+void batteryUpdate(float measuredV, uint8_t rearDutyPct, uint32_t dtMs) {
+  state.measuredV = measuredV;
+  state.loadA = modelLoadA(rearDutyPct);
+  const float restNow = measuredV + state.loadA * BATTERY_INTERNAL_R_OHM;
+
+  const float dt = (float)dtMs;
+  state.restV += (restNow - state.restV) * (dt / (BATTERY_FILTER_TAU_MS + dt));
+  state.avgLoadA += (state.loadA - state.avgLoadA) * (dt / (BATTERY_LOAD_AVG_TAU_MS + dt));
+  if (avgAgeMs < BATTERY_RUNTIME_SETTLE_MS) avgAgeMs += dtMs;
+
+  state.socPct = batterySocFromRestVoltage(state.restV);
+  state.runtimeMin = runtimeMinutes();
+}
+
+const BatteryState& batteryGetState() {
+  return state;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Battery state estimator =====
+// Runs at a low rate (batteryTask). The measured pack voltage sags under
+// motor load, so the rest voltage is estimated as measured + I * R with I
+// modelled from the applied rear duty, then low-pass filtered. State of
+// charge comes from an open-circuit-voltage table for the chemistry set in
+// config.h; remaining runtime from SoC and the average modelled current.
+
+enum BatteryChemistry : uint8_t {
+  BATTERY_LEAD_ACID = 0, // 6-cell 12 V SLA/AGM
+  BATTERY_LIFEPO4 = 1,   // 4S 12.8 V
+};
+
+static const uint16_t BATTERY_RUNTIME_UNKNOWN = 0xFFFF;
+
+struct BatteryState {
+  float measuredV;     // last pin reading, under load
+  float restV;         // sag-compensated, filtered
+  float loadA;         // modelled current at the last update
+  float avgLoadA;      // slow average used for runtime
+  uint8_t socPct;      // 0..100
+  uint16_t runtimeMin; // BATTERY_RUNTIME_UNKNOWN until the average settles
+};
+
+// Starts the filters from a single reading (taken with the motors off).
+void batteryReset(float measuredV);
+void batteryUpdate(float measuredV, uint8_t rearDutyPct, uint32_t dtMs);
+const BatteryState& batteryGetState();
+
+// Open-circuit voltage to SoC for the configured chemistry.
+uint8_t batterySocFromRestVoltage(float restV);
@@ -0,0 +1,94 @@
+#include "cmd_guard.h"
+#include "config.h"
+
+// A backward seq jump larger than this is a restarted sender, not reordering.
+static const int16_t SEQ_RESYNC_BACKSTEP = 256;
+// After this much silence the next command starts a new session.
+static const uint32_t GUARD_IDLE_RESET_MS = 2000;
+// Baseline delay is the minimum over the current and previous window.
+static const uint32_t DELAY_WINDOW_MS = 2000;
+
+static bool haveLast = false;
+static uint16_t lastSeq = 0;
+static uint32_t lastAcceptMs = 0;
+static bool haveDelay = false;
+static uint32_t delayMin = 0;
+static uint32_t delayPrevMin = 0;
+static uint32_t delayWindowStart = 0;
+static uint32_t lastAgeMs = 0;
+static CmdGuardStats stats = {0, 0, 0, 0};
+
+// Wrap-safe "a is earlier than b" for delay values.
+static inline bool before(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+void cmdGuardReset() {
+  haveLast = false;
+  haveDelay = false;
+  lastAgeMs = 0;
+  stats = {0, 0, 0, 0};
+}
+
+// Returns the command's age above the recent delivery baseline.
+static uint32_t trackAge(uint32_t sentMs, uint32_t nowMs) {
+  // Transit time plus the (unknown, constant) clock offset.
+  const uint32_t delay = nowMs - sentMs;
+  if (!haveDelay) {
+    haveDelay = true;
+    delayMin = delay;
+    delayPrevMin = delay;
+    delayWindowStart = nowMs;
+  }
+  if (nowMs - delayWindowStart >= DELAY_WINDOW_MS) {
+    delayPrevMin = delayMin;
+    delayMin = delay;
+    delayWindowStart = nowMs;
+  }
+  if (before(delay, delayMin)) delayMin = delay;
+  const uint32_t base = before(delayPrevMin, delayMin) ? delayPrevMin : delayMin;
+  return before(delay, base) ? 0 : delay - base;
+}
+
+bool cmdGuardAccept(const ControlCommand& cmd, uint32_t nowMs) {
+  if (haveLast && (nowMs - lastAcceptMs) > GUARD_IDLE_RESET_MS) {
+    haveLast = false;
+    haveDelay = false;
+  }
+
+  if (cmd.hasSeq && haveLast) {
+    const int16_t step = (int16_t)(uint16_t)(cmd.seq - lastSeq);
+    if (step <= 0) {
+      if (step > -SEQ_RESYNC_BACKSTEP) {
+        stats.outOfOrder++;
+        return false;
+      }
+      stats.resyncs++;
+      haveDelay = false;
+    }
+  }
+
+  if (cmd.hasSentMs) {
+    lastAgeMs = trackAge(cmd.sentMs, nowMs);
+    if (lastAgeMs > CMD_MAX_AGE_MS) {
+      stats.stale++;
+      return false;
+    }
+  }
+
+  if (cmd.hasSeq) {
+    lastSeq = cmd.seq;
+    haveLast = true;
+  }
+  lastAcceptMs = nowMs;
+  stats.accepted++;
+  return true;
+}
+
+uint32_t cmdGuardLastAgeMs() {
+  return lastAgeMs;
+}
+
+CmdGuardStats cmdGuardGetStats() {
+  return stats;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "protocol.h"
+
+// ===== Command freshness guard =====
+// Drops reordered, duplicated and delayed commands before controlApply.
+// Order comes from the sender sequence number; age is the sender timestamp
+// measured against the fastest delivery seen in the last few seconds, so no
+// clock sync with the app is needed.
+
+struct CmdGuardStats {
+  uint32_t accepted;
+  uint32_t outOfOrder; // seq not newer than the last accepted command
+  uint32_t stale;      // older than CMD_MAX_AGE_MS
+  uint32_t resyncs;    // sender restarted its sequence
+};
+
+void cmdGuardReset();
+bool cmdGuardAccept(const ControlCommand& cmd, uint32_t nowMs);
+uint32_t cmdGuardLastAgeMs();
+CmdGuardStats cmdGuardGetStats();
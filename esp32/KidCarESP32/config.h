@@ -11,27 +11,154 @@
 static const int PWM_FREQ = 20000; // 20kHz
 static const int PWM_RES  = 10;    // 0..1023
 
+// Wheel encoder and closed-loop rear speed (speed_ctl.h). With an encoder
+// fitted, remote and pedal throttle mean % of WHEEL_MAX_MMPS instead of %
+// duty, and a PI loop finds the duty. Without one (or after an encoder
+// fault) the duty is the throttle, as before.
+static const bool WHEEL_ENCODER_FITTED = false;
+static const float WHEEL_PULSES_PER_M = 400.0f;     // e.g. 6-pole ring on the motor shaft
+static const float WHEEL_MAX_MMPS = 1800.0f;        // real speed meant by 100 %
+static const uint16_t SPEED_CTL_PERIOD_MS = 20;     // PI update, one fade segment
+static const uint8_t SPEED_WINDOW_PERIODS = 5;      // speed measured over 100 ms
+static const float SPEED_KP = 2.0f;                 // duty % per speed % of error
+static const float SPEED_KI = 6.0f;                 // duty % per speed %·s of error
+static const uint16_t SPEED_FAULT_MS = 600;         // this long at >= SPEED_FAULT_DUTY_PCT
+static const uint8_t SPEED_FAULT_DUTY_PCT = 25;     //   without a pulse: encoder fault
+
 // Steering safety
-static const uint16_t STEER_MAX_MS = 5000; // hard limit for steering motor run time
+static const uint16_t STEER_MAX_MS = 5000; // hard limit for one timed steering hold
 // PWM for steering is disabled (ENA jumpered). Only time limit applies.
 static const uint8_t STEER_MAX_PWM_PCT = 60; // unused when PWM disabled
+// Steering actuator (motor_steer.h): the rack position is dead-reckoned
+// from run time at full speed.
+static const uint16_t STEER_TRAVEL_MS = 1600;       // lock to lock
+static const uint16_t STEER_DEADBAND_MS = 30;       // close enough to an absolute target
+static const uint8_t STEER_DRIFT_PCT = 10;          // estimate error per ms moved
+static const uint16_t STEER_ENDSTOP_MS = 120;       // push past the uncertainty before calling it the stop
+static const uint16_t STEER_REVERSE_DWELL_MS = 20;  // coast between opposite directions
 
 // Rear motor soft-start
-static const uint8_t REAR_SOFTSTART_MIN_PCT = 20; // safe start percent
-static const uint16_t REAR_RAMP_MS = 600; // time to ramp to target
+static const uint8_t REAR_SOFTSTART_MIN_PCT = 20; // lowest non-zero pedal command
+static const uint16_t REAR_RAMP_MS = 600; // remote default: stop to full duty
+
+// Rear motion profiles (motion_profile.h), duty %/s and %/s^2.
+// Manual (pedal) launches gentler than the app's default ramp.
+static const float REAR_MANUAL_ACCEL_PCT_S = 80.0f;
+static const float REAR_MANUAL_DECEL_PCT_S = 150.0f;
+static const float REAR_MANUAL_JERK_PCT_S2 = 300.0f;
+static const float REAR_REMOTE_DECEL_PCT_S = 200.0f;
+static const float REAR_REMOTE_JERK_PCT_S2 = 600.0f;
+static const float REAR_EDECEL_PCT_S = 500.0f;    // link cut, failsafe, OTA
+static const uint16_t REAR_COAST_MS = 300;        // hold at zero on reversal
+// Ramps are played by the LEDC fade engine in segments of this length.
+static const uint16_t REAR_FADE_SEGMENT_MS = 20;
+
+// App link failsafe ladder (link_watch.h). The late threshold adapts to the
+// measured packet gaps within [MIN, MAX]; hold and decel follow it.
+static const uint32_t LINK_LATE_MIN_MS = 150;
+static const uint32_t LINK_LATE_MAX_MS = 600;
+static const uint32_t LINK_HOLD_MS = 250;   // last command still applied
+static const uint32_t LINK_DECEL_MS = 750;  // braking before the relay is cut
+// Any datagram this recent, accepted or not, shows the app as connected on
+// the LED; only accepted commands feed the ladder.
+static const uint32_t LINK_ALIVE_MS = 2000;
 
 // Battery voltage calibration factor
 // Calibrated with measured values: meter=13.13V, app=12.65V (ratio 1.037945).
 static const float BATTERY_VOLT_CAL_FACTOR = 1.0142f;
 
+// Main relay policy (relay.h)
+static const uint32_t RELAY_HOLD_MS = 5000;        // stay on after the last motion
+static const uint32_t RELAY_PRECHARGE_MS = 100;    // driver supply settle time
+static const uint32_t RELAY_DISCHARGE_MS = 2000;   // off time that needs a full precharge
+static const uint8_t RELAY_MAX_CYCLES_PER_MIN = 10;
+
+// Battery estimator (battery.h). Chemistry picks the SoC table:
+// 0 = lead-acid 12 V, 1 = LiFePO4 4S.
+static const uint8_t BATTERY_CHEMISTRY = 0;
+static const float BATTERY_CAPACITY_AH = 7.0f;
+static const float BATTERY_INTERNAL_R_OHM = 0.05f; // pack + wiring, for sag
+static const float BATTERY_IDLE_A = 0.3f;          // relay, ESP, steering idle
+static const float BATTERY_FULL_DUTY_A = 15.0f;    // rear motors at 100 % duty
+static const float BATTERY_FILTER_TAU_MS = 3000.0f;
+static const float BATTERY_LOAD_AVG_TAU_MS = 60000.0f;
+static const uint32_t BATTERY_RUNTIME_SETTLE_MS = 10000; // before runtime is reported
+
+// Battery-aware derating (power_derate.h). The pack voltage under load,
+// projected DERATE_LOOKAHEAD_MS ahead while it is falling, is looked up in
+// the curve below (ascending volts; linear in between, flat outside) for the
+// rear duty ceiling and the share of the accel limit. Keep the lowest point
+// well above where the ESP supply browns out or the relay drops.
+static const float DERATE_CURVE_V[] = {8.8f, 9.2f, 9.6f, 10.0f, 10.4f};
+static const uint8_t DERATE_CURVE_DUTY_PCT[] = {20, 40, 60, 80, 100};
+static const uint8_t DERATE_CURVE_ACCEL_PCT[] = {10, 25, 50, 75, 100};
+static const float DERATE_FILTER_TAU_MS = 30.0f;   // pack voltage
+static const float DERATE_SLOPE_TAU_MS = 150.0f;   // its slope
+static const uint16_t DERATE_LOOKAHEAD_MS = 250;
+static const float DERATE_FALL_PCT_S = 400.0f;     // duty ceiling may drop this fast
+static const float DERATE_RISE_PCT_S = 25.0f;      //   and comes back this slowly
+
+// Background ADC (see sensors.h): nominal total conversion rate across the
+// streamed pins and conversions averaged per pin into one frame (about 1 ms
+// per streamed pin). The rate used is moved off the PWM harmonics
+// (sensorsStreamSampleHz); samples per pin set how finely a frame resolves
+// the motor current's duty (1/40 of a period).
+static const uint32_t ADC_STREAM_SAMPLE_HZ = 40000;
+static const uint16_t ADC_STREAM_SAMPLES_PER_PIN = 40;
+
+// Rear motor current (motor_current.h), from the BTS7960 IS pins. The sense
+// current is load / CURRENT_SENSE_RATIO (kILIS, +/-10 % part to part); with
+// 680 ohm the ADC range ends near 40 A.
+static const float CURRENT_SENSE_RATIO = 8500.0f;
+static const float CURRENT_SENSE_R_OHM = 680.0f;
+static const float CURRENT_PEAK_LIMIT_A = 35.0f;    // fast limit, cool motors
+static const float CURRENT_CONT_A = 18.0f;          // what they take indefinitely
+static const float CURRENT_THERMAL_TAU_MS = 20000.0f; // I²t model time constant
+static const float CURRENT_DERATE_FROM_PCT = 80.0f; // heat where the limit starts falling
+static const float CURRENT_RECOVER_PCT_S = 100.0f;  // duty ceiling recovery
+static const float CURRENT_MIN_DUTY_PCT = 10.0f;    // supply-to-motor current below this is noise
+static const uint16_t CURRENT_PEAK_WINDOW_MS = 1000; // reported peak: max over 1..2 windows
+static const float CURRENT_AVG_TAU_MS = 1000.0f;
+
 // Network settings
-static const char* AP_SSID = "KidCar";
-static const char* AP_PASS = "88958004";
+static const char* const AP_SSID = "KidCar";
+static const char* const AP_PASS = "88958004";
 static const uint16_t UDP_PORT = 4210;
+// Commands older than this (by sender timestamp, relative to the fastest
+// recent delivery) are dropped instead of driving the motors.
+static const uint16_t CMD_MAX_AGE_MS = 300;
+
+// Network task: UDP/OTA run in their own FreeRTOS task on the WiFi core and
+// hand commands to controlLoop through net_queue. 0 = run wifiApLoop from
+// loop() instead (same hand-off, single task).
+#define NET_TASK_ENABLED 1
+static const int NET_TASK_CORE = 0;
+static const uint32_t NET_TASK_STACK = 6144;
+static const int NET_TASK_PRIORITY = 2;
+
+// E-stop socket: its own port and a task blocked in recvfrom, above lwIP's
+// tcpip task (18) and below the Wi-Fi driver (23), so a stop datagram is
+// handled as soon as lwIP delivers it. Always on, also without the net task.
+static const uint16_t ESTOP_UDP_PORT = 4211;
+static const uint32_t ESTOP_TASK_STACK = 3072;
+static const int ESTOP_TASK_PRIORITY = 20;
+
+// Logger (log.h): records waiting for the log task, and the level below
+// which nothing is recorded (0 error, 1 warn, 2 info, 3 debug; packet echo
+// is debug).
+static const uint32_t LOG_RING_RECORDS = 64;
+static const uint8_t LOG_DEFAULT_LEVEL = 2;
+static const int LOG_TASK_CORE = 0;
+static const uint32_t LOG_TASK_STACK = 3072;
+static const int LOG_TASK_PRIORITY = 1; // just above idle
+
+// Loop profiler (profiler.h): cycle-count timing of the named sections in the
+// control and network loops. 0 compiles the PROF_SCOPE markers out.
+#define PROFILE_ENABLED 1
 
 // OTA settings (Wi-Fi firmware upload)
-static const char* OTA_HOSTNAME = "kidcar-esp32";
-static const char* OTA_PASSWORD = "kidcar123";
+static const char* const OTA_HOSTNAME = "kidcar-esp32";
+static const char* const OTA_PASSWORD = "kidcar123";
 static const uint16_t OTA_PORT = 3232;
 
 // RGB LED pin (common ESP32-S3 boards use 48, some use 38)
@@ -1,52 +1,61 @@
 #include "control.h"
+#include "net_queue.h"
+#include "telemetry.h"
 #include "motor_rear.h"
 #include "motor_steer.h"
+#include "speed_ctl.h"
+#include "motor_current.h"
+#include "power_derate.h"
+#include "scheduler.h"
+#include "sensors.h"
+#include "battery.h"
+#include "relay.h"
+#include "control_mode.h"
+#include "link_watch.h"
+#include "led.h"
+#include "log.h"
+#include "profiler.h"
 #include "pins.h"
 #include "config.h"
-#include <Arduino.h>
+#include "hal.h"
 
-static ControlCommand lastCmd = {0, 0, 0, 0, REAR_RAMP_MS, false, false, 50};
-static uint32_t lastAppMs = 0;
-static bool appConnected = false;
-static uint32_t lastBlink = 0;
-static bool blinkOn = false;
+#include <atomic>
+
+static const ControlCommand IDLE_CMD = {0, 0, 0, 0, REAR_RAMP_MS, false, false, 50, false, false, 0, false, 0, false};
+static ControlCommand lastCmd = IDLE_CMD;
+static bool appConnected = false; // datagrams arriving, accepted or not (LED)
+static uint32_t lastRxMs = 0;
+static LinkStage linkStage = LINK_CUT;
 static bool relayOn = false;
-static uint32_t relayEnabledAt = 0;
-static const uint32_t RELAY_DELAY_MS = 100;
-static float batteryVoltage = 12.0f;
-static bool manualActive = false;
-static int8_t manualGear = 0; // -1 reverse, 0 neutral, 1 forward
+static ControlMode mode = CTL_MANUAL;
+static bool manualActive = true;
 static int8_t driveDir = 0;    // -1 reverse, 0 stop, 1 forward
 static uint8_t driveSpeedPct = 0; // 0..100
-static bool selectorFwdActive = false;
-static bool selectorBackActive = false;
-static float selectorThrottleVoltage = 0.0f;
-static uint8_t selectorThrottlePct = 0;
-static uint32_t lastAnalogLogMs = 0;
+static ManualReading selector = {0, false, false, 0.0f, 0};
+static uint32_t tickCount = 0;
+// Raw manual inputs, sampled by inputTask.
+static float sampledThrottleV = 3.0f;
+static bool sampledFwd = false;
+static bool sampledBack = false;
+// E-stop latch, set from any task; estopPending marks a stop the control
+// task has not applied yet. The fast path hands its timing over in atomics;
+// estopStats itself is only written by the control task.
+static std::atomic<bool> estopLatched{false};
+static std::atomic<bool> estopPending{false};
+static std::atomic<uint32_t> estopRxUs{0};
+static std::atomic<uint32_t> estopCutUs{0};
+static std::atomic<uint32_t> estopStops{0};
+static std::atomic<uint32_t> estopReleases{0};
+static EstopStats estopStats = {};
 static const float BATTERY_ADC_PIN_CAL_FACTOR = 1.0452f; // 2.31V meter / 2.21V ADC
 
-static void setRgb(uint8_t r, uint8_t g, uint8_t b) {
-  rgbLedWrite(RGB_PIN, r, g, b);
-}
-
 static void setRelay(bool enable) {
   if (enable == relayOn) return;
   relayOn = enable;
-  digitalWrite(PIN_RELAY_EN, enable ? HIGH : LOW);
-  if (enable) relayEnabledAt = millis();
+  halDigitalWrite(PIN_RELAY_EN, enable ? HIGH : LOW);
 }
 
-static int readAdcAvg(int pin, uint8_t samples) {
-  uint32_t sum = 0;
-  for (uint8_t i = 0; i < samples; i++) {
-    sum += (uint32_t)analogRead(pin);
-  }
-  return (int)(sum / samples);
-}
-
-static float readBatteryVoltageInstant() {
-  const int raw = readAdcAvg(PIN_BATTERY_FB, 8);
-  const float vAdc = ((float)raw * 3.3f) / 4095.0f;
+static float batteryFromPinVoltage(float vAdc) {
   const float divider = (100.0f + 22.0f) / 22.0f;
   float vBat = vAdc * divider * BATTERY_VOLT_CAL_FACTOR;
   if (vBat < 0.0f) vBat = 0.0f;
@@ -54,156 +63,137 @@ static float readBatteryVoltageInstant() {
   return vBat;
 }
 
-static float readBatteryAdcVoltage() {
-  const int raw = readAdcAvg(PIN_BATTERY_FB, 8);
-  return (((float)raw * 3.3f) / 4095.0f) * BATTERY_ADC_PIN_CAL_FACTOR;
+// One consistent view of this tick for the status reply and the log.
+static void publishTelemetry(uint32_t now, TelemetrySnapshot& snap) {
+  snap.tick = ++tickCount;
+  snap.ms = now;
+  const BatteryState& batt = batteryGetState();
+  snap.batteryV = batt.restV;
+  snap.batteryMeasuredV = batt.measuredV;
+  snap.batterySocPct = batt.socPct;
+  snap.batteryRuntimeMin = batt.runtimeMin;
+  snap.appConnected = appConnected;
+  snap.linkStage = (uint8_t)linkStage;
+  snap.linkLateMs = (uint16_t)linkWatchStats().lateMs;
+  snap.mode = (uint8_t)mode;
+  snap.manualActive = manualActive;
+  snap.relayOn = relayOn;
+  snap.manualGear = selector.gear;
+  snap.driveDir = driveDir;
+  snap.driveSpeedPct = driveSpeedPct;
+  snap.selectorFwd = selector.fwd;
+  snap.selectorBack = selector.back;
+  snap.selectorThrottleV = selector.throttleV;
+  snap.selectorThrottlePct = selector.throttlePct;
+  const CurrentState current = currentGetState();
+  snap.motorPeakA = current.peakA;
+  snap.motorAvgA = current.avgA;
+  snap.motorHeatPct = current.heatPct > 255.0f ? 255 : (uint8_t)(current.heatPct + 0.5f);
+  snap.currentLimited = current.limiting;
+  const DerateState derate = derateGetState();
+  snap.powerLimitPct = (uint8_t)(derate.maxDutyPct + 0.5f);
+  snap.derateEvents = derateGetStats().events;
+  telemetryPublish(snap);
 }
 
+void controlApply(const ControlCommand& cmd) {
+  lastCmd = cmd;
+  rearSetRampMs(cmd.accelMs);
+}
 
-static int readManualThrottlePct() {
-  const int raw = readAdcAvg(PIN_MANUAL_THROTTLE, 6);
-  const float v = ((float)raw * 3.3f) / 4095.0f;
-
-  // Manual throttle mapping:
-  // >=2.0V: full stop
-  // 1.4V: minimum speed
-  // 0.0V: maximum speed
-  if (v >= 2.0f) return 0;
-
-  const int minPct = REAR_SOFTSTART_MIN_PCT;
-  if (v <= 1.4f) {
-    // 0.0..1.4V -> 100..minPct
-    float t = v / 1.4f;
-    if (t < 0.0f) t = 0.0f;
-    if (t > 1.0f) t = 1.0f;
-    int pct = (int)(100.0f - t * (100.0f - (float)minPct));
-    if (pct < minPct) pct = minPct;
-    if (pct > 100) pct = 100;
-    return pct;
+// Applies everything the network side queued since the last tick.
+static void pollNetQueue() {
+  NetMsg msg;
+  while (netQueuePop(msg)) {
+    switch (msg.kind) {
+      case NET_MSG_COMMAND:
+        // Only commands the guard accepted feed the watchdog: junk and stale
+        // frames must not hold the ladder at OK.
+        linkWatchPacket(halMillis());
+        controlNotifyAppActivity();
+        controlApply(msg.cmd);
+        break;
+      case NET_MSG_ACTIVITY:
+        controlNotifyAppActivity();
+        break;
+    }
   }
-
-  // 1.4..2.0V -> minPct..0 for smooth transition to stop
-  float t = (v - 1.4f) / 0.6f;
-  if (t < 0.0f) t = 0.0f;
-  if (t > 1.0f) t = 1.0f;
-  int pct = (int)((1.0f - t) * (float)minPct);
-  if (pct < 0) pct = 0;
-  if (pct > minPct) pct = minPct;
-  return pct;
 }
 
-static float readManualThrottleVoltage() {
-  const int raw = readAdcAvg(PIN_MANUAL_THROTTLE, 6);
-  return ((float)raw * 3.3f) / 4095.0f;
+// ===== Periodic tasks =====
+// Manual selector and pedal. Analog values come from the sensor cache, which
+// the background ADC keeps current; no conversions are started here.
+static void inputTask(uint32_t) {
+  sensorsPoll();
+  sampledThrottleV = sensorsPinVoltage(SENSOR_THROTTLE);
+  sampledFwd = halDigitalRead(PIN_MANUAL_FWD) == LOW;   // active-low
+  sampledBack = halDigitalRead(PIN_MANUAL_BACK) == LOW; // active-low
 }
 
-static ControlCommand resolveDriveCommand() {
-  ControlCommand cmd = lastCmd;
-  manualActive = (!appConnected) || lastCmd.manualMode;
-  manualGear = 0;
-  selectorFwdActive = false;
-  selectorBackActive = false;
-  selectorThrottleVoltage = 0.0f;
-  selectorThrottlePct = 0;
-
-  if (manualActive) {
-    const bool parkLockedByApp = appConnected && lastCmd.manualMode && lastCmd.park;
-    if (parkLockedByApp) {
-      // Safety lock: when app is connected in MANUAL mode and Park is ON,
-      // ignore selector commands until Park is released from the app.
-      manualGear = 0;
-      selectorFwdActive = false;
-      selectorBackActive = false;
-      selectorThrottleVoltage = readManualThrottleVoltage();
-      selectorThrottlePct = 0;
-      cmd.throttle = 0;
-      cmd.steer = 0;
-      cmd.steerMs = STEER_MAX_MS;
-      cmd.speed = 0;
-      return cmd;
-    }
-
-    const float throttleV = readManualThrottleVoltage();
-    selectorThrottleVoltage = throttleV;
-    if (throttleV > 2.0f) {
-      // Highest priority: if throttle input is above 2V, force full stop.
-      manualGear = 0;
-      selectorFwdActive = false;
-      selectorBackActive = false;
-      selectorThrottlePct = 0;
-      cmd.throttle = 0;
-      cmd.steer = 0;
-      cmd.steerMs = STEER_MAX_MS;
-      cmd.speed = 0;
-      return cmd;
-    }
-
-    const bool fwd = digitalRead(PIN_MANUAL_FWD) == LOW;   // active-low
-    const bool back = digitalRead(PIN_MANUAL_BACK) == LOW; // active-low
-    selectorFwdActive = fwd;
-    selectorBackActive = back;
-
-    int dir = 0;
-    if (fwd && !back) dir = 1;
-    if (back && !fwd) dir = -1;
-
-    int pct = readManualThrottlePct();
-    int reverseLimit = (int)lastCmd.reverseSpeed;
-    if (reverseLimit < 0) reverseLimit = 0;
-    if (reverseLimit > 100) reverseLimit = 100;
-    if (dir < 0 && pct > reverseLimit) pct = reverseLimit;
-
-    selectorThrottlePct = (uint8_t)pct;
-    // Keep full stop when throttle voltage commands 0%.
-    // Soft-start minimum applies only for non-zero throttle requests.
-    if (dir != 0 && pct > 0 && pct < REAR_SOFTSTART_MIN_PCT) {
-      pct = REAR_SOFTSTART_MIN_PCT;
-    }
+static void batteryTask(uint32_t dtUs) {
+  batteryUpdate(batteryFromPinVoltage(sensorsPinVoltage(SENSOR_BATTERY)), rearGetDutyPct(), dtUs / 1000);
+}
 
-    manualGear = (int8_t)dir;
-    cmd.throttle = dir * pct;
-    cmd.steer = 0;
-    cmd.steerMs = STEER_MAX_MS;
-    cmd.speed = pct;
-  }
+// Inputs for the mode table this tick.
+static uint8_t modeInputs(uint32_t now) {
+  linkStage = linkWatchUpdate(now);
+  appConnected = now - lastRxMs <= LINK_ALIVE_MS;
+  uint8_t in = 0;
+  if (estopLatched.load(std::memory_order_acquire)) in |= CTL_IN_ESTOP;
+  if (netOtaActive()) in |= CTL_IN_OTA;
+  // A selector cannot be in FWD and BACK at once: wiring fault.
+  if (sampledFwd && sampledBack) in |= CTL_IN_FAULT;
+  if (linkStage != LINK_CUT) in |= CTL_IN_LINK;
+  if (linkStage >= LINK_DECEL) in |= CTL_IN_STALE;
+  if (lastCmd.manualMode) in |= CTL_IN_APP_MANUAL;
+  if (lastCmd.park) in |= CTL_IN_PARK;
+  if (rearGetDutyPct() == 0) in |= CTL_IN_STOPPED;
+  return in;
+}
 
-  if (cmd.throttle < 0) {
-    int reverseLimit = (int)lastCmd.reverseSpeed;
-    if (reverseLimit < 0) reverseLimit = 0;
-    if (reverseLimit > 100) reverseLimit = 100;
-    int rev = -cmd.throttle;
-    if (rev > reverseLimit) cmd.throttle = -reverseLimit;
-    if (cmd.speed > reverseLimit) cmd.speed = reverseLimit;
+// Battery derating for the rear driver, from the pack voltage under load.
+static void updatePowerLimit(uint32_t dtUs) {
+  const bool wasActive = derateGetState().active;
+  const DerateLimits lim = derateUpdate(batteryFromPinVoltage(sensorsPinVoltage(SENSOR_BATTERY)), dtUs);
+  rearSetPowerLimit(lim.maxDutyPct, lim.accelScale);
+  const DerateState d = derateGetState();
+  if (d.active && !wasActive) {
+    logMsg(LOG_WARN, "derate: pack %.2fV (%.1fV/s, %.2fV ahead), duty max %.0f%%", d.filteredV, d.slopeVps,
+           d.projectedV, d.maxDutyPct);
+  } else if (!d.active && wasActive) {
+    logMsg(LOG_INFO, "derate: cleared at %.2fV", d.filteredV);
   }
-
-  return cmd;
 }
 
-void controlInit() {
-  rearSetSpeed(0);
-  steerStop();
-  setRgb(0, 0, 0);
-  lastAppMs = millis();
-  setRelay(false);
-  batteryVoltage = readBatteryVoltageInstant();
+// Commands, safety and motor outputs. Runs at the ramp rate so the rear
+// ramp integrates over a constant dt.
+// E-stop outputs off: bridge registers and relay pin, safe from any task.
+static void cutOutputs() {
+  rearCutRegisters();
+  halDigitalWrite(PIN_RELAY_EN, LOW);
 }
 
-void controlApply(const ControlCommand& cmd) {
-  lastCmd = cmd;
-  rearSetRampMs(cmd.accelMs);
+// Latched, but not yet in this tick's mode (the e-stop task runs beside the
+// control task).
+static bool estopRaced() {
+  return mode != CTL_ESTOP && estopLatched.load();
 }
 
-void controlLoop() {
-  const uint32_t now = millis();
-  if (now - lastAppMs > 2000) {
-    appConnected = false;
+static void motorTask(uint32_t dtUs) {
+  {
+    // Every tick, so the current limit sees each ADC frame as it completes.
+    PROF_SCOPE(PROF_ADC);
+    sensorsPollStream();
   }
-
-  // Smooth battery voltage for stable UI readout
-  const float instantBattery = readBatteryVoltageInstant();
-  batteryVoltage = instantBattery;
-
-  const ControlCommand cmd = resolveDriveCommand();
+  updatePowerLimit(dtUs);
+  pollNetQueue();
+  const uint32_t now = halMillis();
+  mode = controlModeNext(mode, modeInputs(now));
+  const ControlModeDef& def = controlModeDef(mode);
+  manualActive = !def.appDrives;
+
+  const ManualInputs manual = {sampledThrottleV, sampledFwd, sampledBack};
+  const ControlCommand cmd = controlModeCommand(mode, lastCmd, manual, selector);
   if (cmd.throttle > 0) driveDir = 1;
   else if (cmd.throttle < 0) driveDir = -1;
   else driveDir = 0;
@@ -211,128 +201,276 @@ void controlLoop() {
   if (absThrottle < 0) absThrottle = -absThrottle;
   if (absThrottle > 100) absThrottle = 100;
   driveSpeedPct = (uint8_t)absThrottle;
-  const bool wantMotion = (cmd.throttle != 0) || (cmd.steer != 0);
-
-  if (manualActive) {
-    if (wantMotion) {
-      if (!relayOn) setRelay(true);
-      if (relayOn && (now - relayEnabledAt) >= RELAY_DELAY_MS) {
-        rearSetSpeed(cmd.throttle);
-      } else {
-        rearSetSpeed(0);
-      }
-    } else {
-      rearSetSpeed(0);
-      setRelay(false);
-    }
-    steerStop();
-  } else {
-    if (!appConnected) {
-      setRelay(false);
-      rearSetSpeed(0);
-      steerStop();
-    } else if (wantMotion) {
-      if (!relayOn) {
-        setRelay(true);
-      }
-      if (relayOn && (now - relayEnabledAt) >= RELAY_DELAY_MS) {
-        rearSetSpeed(cmd.throttle);
-        steerStart(cmd.steer, cmd.steerMs);
-      } else {
-        rearSetSpeed(0);
-        steerStop();
-      }
-    } else {
-      rearSetSpeed(0);
-      steerStop();
-      setRelay(false);
-    }
+  // An absolute steer target wants power until the rack gets there, centre
+  // included; a timed pulse only while it is held.
+  const bool steerWanted = cmd.steerAbs ? steerNeedsMove(cmd.steer) : cmd.steer != 0;
+  const bool wantMotion = (cmd.throttle != 0) || steerWanted;
+  rearSetMode(def.rearMode);
+
+  // A stop latched by the e-stop task after this tick read its inputs:
+  // leave the cut outputs alone, the next pass applies it.
+  if (estopRaced()) {
+    TelemetrySnapshot snap;
+    publishTelemetry(now, snap);
+    return;
   }
+  const bool powerReady = relayPolicyUpdate(wantMotion, def.forceRelayOff, now);
+  setRelay(relayPolicyOn());
 
-  // RGB status blink:
-  // connected -> 500ms, disconnected -> 150ms
-  const uint32_t blinkPeriod = appConnected ? 500 : 150;
-  if (now - lastBlink >= blinkPeriod) {
-    lastBlink = now;
-    blinkOn = !blinkOn;
-  }
-  if (blinkOn) {
-    if (driveSpeedPct == 0) {
-      // Stopped: solid red during ON phase
-      setRgb(255, 0, 0);
+  if (def.emergencyStop) {
+    rearEmergencyStop(dtUs);
+    steerStop();
+  } else if (wantMotion && powerReady) {
+    rearSetSpeed(cmd.throttle, dtUs);
+    if (def.allowSteer && cmd.steerAbs) {
+      steerTarget(cmd.steer);
+    } else if (def.allowSteer) {
+      steerStart(cmd.steer, cmd.steerMs);
     } else {
-      // Moving: brightness follows speed, color follows direction
-      uint8_t v = (uint8_t)((driveSpeedPct * 255) / 100);
-      if (v < 20) v = 20;
-      if (driveDir > 0) {
-        setRgb(0, v, 0);    // forward: green
-      } else if (driveDir < 0) {
-        setRgb(0, 0, v);    // reverse: blue
-      } else {
-        setRgb(255, 0, 0);  // fallback
-      }
+      steerStop();
     }
   } else {
-    setRgb(0, 0, 0);
-  }
-  if (now - lastAnalogLogMs >= 500) {
-    lastAnalogLogMs = now;
-    const float battAdcV = readBatteryAdcVoltage();
-    Serial.printf("ADC_BAT=%.3fV BAT=%.2fV THR=%.3fV\n", battAdcV, batteryVoltage, selectorThrottleVoltage);
+    rearSetSpeed(0, dtUs);
+    steerStop();
   }
+  // Latched while the writes above ran: controlEstop latches before it
+  // cuts, so either its cut lands after them or this sees the latch.
+  if (estopRaced()) cutOutputs();
 
   steerLoop();
+  TelemetrySnapshot snap;
+  publishTelemetry(now, snap);
 }
 
-void controlNotifyAppActivity() {
-  lastAppMs = millis();
-  if (!appConnected) {
-    appConnected = true;
-    // Keep blink phase continuous; blink timing controls LED visibility.
+// ===== Status LED =====
+// Blink rate shows the app link (500 ms connected, 150 ms not), colour the
+// drive: red stopped, green forward, blue reverse, brighter with speed.
+static const LedPattern LED_LINK_UP = {500, {255, 0, 0}, true};
+static const LedPattern LED_LINK_DOWN = {150, {255, 0, 0}, true};
+static const LedPattern LED_HARD_STOP = {60, {255, 0, 0}, false}; // e-stop, failsafe
+static const LedPattern LED_OTA = {0, {0, 0, 64}, false};
+
+static const LedPattern& ledPatternFor(ControlMode m, bool connected) {
+  switch (m) {
+    case CTL_ESTOP:
+    case CTL_FAILSAFE:
+      return LED_HARD_STOP;
+    case CTL_OTA:
+      return LED_OTA;
+    default:
+      return connected ? LED_LINK_UP : LED_LINK_DOWN;
   }
 }
 
-float controlGetBatteryVoltage() {
-  return batteryVoltage;
+static void ledTask(uint32_t) {
+  PROF_SCOPE(PROF_LED);
+  ledSetPattern(ledPatternFor(mode, appConnected), driveDir, driveSpeedPct);
+  ledRun(halMillis());
 }
 
-bool controlIsManualActive() {
-  return manualActive;
+static void logTask(uint32_t) {
+  TelemetrySnapshot snap;
+  telemetryRead(snap);
+  const float battAdcV = sensorsPinVoltage(SENSOR_BATTERY) * BATTERY_ADC_PIN_CAL_FACTOR;
+  logMsg(LOG_INFO, "ADC_BAT=%.3fV BAT=%.2fV EST=%.2fV SOC=%u%% THR=%.3fV", battAdcV, snap.batteryMeasuredV,
+         snap.batteryV, (unsigned)snap.batterySocPct, snap.selectorThrottleV);
 }
 
-int8_t controlGetManualGear() {
-  return manualGear;
+static void heartbeatTask(uint32_t);
+
+// Table order is run order within a tick: inputs before the motor task that
+// consumes them.
+static SchedTask tasks[] = {
+  {"input",   inputTask,     5000,    0, {}},  // 200 Hz
+  {"battery", batteryTask,   100000,  0, {}},  // 10 Hz
+  {"motor",   motorTask,     1000,    0, {}},  // 1 kHz
+  {"led",     ledTask,       10000,   0, {}},  // 100 Hz, writes only on change
+  {"log",     logTask,       500000,  0, {}},  // 2 Hz
+  {"beat",    heartbeatTask, 5000000, 0, {}},  // 0.2 Hz
+};
+static const uint8_t TASK_COUNT = sizeof(tasks) / sizeof(tasks[0]);
+
+static void heartbeatTask(uint32_t dtUs) {
+  static RearPwmStats lastPwm = {0, 0, 0};
+  logMsg(LOG_INFO, "KIDCAR RUN");
+  for (uint8_t i = 0; i < TASK_COUNT; i++) {
+    const SchedStats& s = tasks[i].stats;
+    logMsg(LOG_INFO, "  %-7s runs=%lu over=%lu late_max=%luus late_avg=%luus exec_max=%luus",
+           tasks[i].name, (unsigned long)s.runs, (unsigned long)s.overruns,
+           (unsigned long)s.maxLateUs,
+           (unsigned long)(s.runs ? s.sumLateUs / s.runs : 0),
+           (unsigned long)s.maxExecUs);
+  }
+  const SensorStats adc = sensorsGetStats();
+  logMsg(LOG_INFO, "  adc stream=%d frames=%lu direct=%lu", adc.streaming ? 1 : 0,
+         (unsigned long)adc.frames, (unsigned long)adc.directReads);
+  const RearPwmStats pwm = rearGetPwmStats();
+  const float secs = dtUs ? (float)dtUs / 1e6f : 1.0f;
+  logMsg(LOG_INFO, "  pwm writes/s=%.1f fades/s=%.1f skipped/s=%.1f",
+         (float)(pwm.writes - lastPwm.writes) / secs,
+         (float)(pwm.fades - lastPwm.fades) / secs,
+         (float)(pwm.skipped - lastPwm.skipped) / secs);
+  lastPwm = pwm;
+  const RelayStats relay = relayPolicyStats();
+  const LinkWatchStats link = linkWatchStats();
+  logMsg(LOG_INFO, "  link stage=%u gap_avg=%lums gap_dev=%lums gap_max=%lums late=%lums holds=%lu decels=%lu cuts=%lu",
+         (unsigned)linkStage, (unsigned long)link.meanGapMs, (unsigned long)link.devGapMs,
+         (unsigned long)link.maxGapMs, (unsigned long)link.lateMs, (unsigned long)link.holds,
+         (unsigned long)link.decels, (unsigned long)link.cuts);
+  if (estopStats.stops) {
+    logMsg(LOG_INFO, "  estop stops=%lu releases=%lu cut_max=%luus apply_max=%luus",
+           (unsigned long)estopStats.stops, (unsigned long)estopStats.releases,
+           (unsigned long)estopStats.maxCutUs, (unsigned long)estopStats.maxApplyUs);
+    for (uint8_t b = 0; b < ESTOP_HIST_BUCKETS; b++) {
+      if (!estopStats.cutHist[b] && !estopStats.applyHist[b]) continue;
+      logMsg(LOG_INFO, "  estop hist us<%lu cut=%lu apply=%lu", 1UL << b, (unsigned long)estopStats.cutHist[b],
+             (unsigned long)estopStats.applyHist[b]);
+    }
+  }
+  const SteerState steer = steerGetState();
+  const SteerStats steerStats = steerGetStats();
+  logMsg(LOG_INFO, "  steer pos=%.0f%% unc=%.0f%% homed=%d end_stops=%lu hold_cutoffs=%lu pin_writes=%lu",
+         steer.positionPct, steer.uncertaintyPct, steer.homed ? 1 : 0, (unsigned long)steerStats.endStops,
+         (unsigned long)steerStats.holdCutoffs, (unsigned long)steerStats.pinWrites);
+  const CurrentState current = currentGetState();
+  const CurrentStats currentStats = currentGetStats();
+  logMsg(LOG_INFO, "  current now=%.1fA peak=%.1fA avg=%.1fA max=%.1fA limit=%.1fA ceiling=%.0f%% heat=%.0f%% cuts=%lu",
+         current.motorA, current.peakA, current.avgA, currentStats.maxA, current.limitA, current.ceilingPct,
+         current.heatPct, (unsigned long)currentStats.cuts);
+  const DerateState derate = derateGetState();
+  const DerateStats derateStats = derateGetStats();
+  logMsg(LOG_INFO, "  derate v=%.2fV slope=%.2fV/s ahead=%.2fV duty=%.0f%% accel=%.0f%% events=%lu active=%lums min=%.2fV",
+         derate.filteredV, derate.slopeVps, derate.projectedV, derate.maxDutyPct, derate.accelPct,
+         (unsigned long)derateStats.events, (unsigned long)derateStats.activeMs, derateStats.minV);
+  const SpeedCtlState speed = speedCtlGetState();
+  if (speed.fitted) {
+    const SpeedCtlStats speedStats = speedCtlGetStats();
+    logMsg(LOG_INFO, "  speed mmps=%.0f set=%.0f%% duty=%.0f%% i=%.1f fault=%d updates=%lu saturated=%lu",
+           speed.measuredMmps, speed.setpointPct, speed.dutyPct, speed.integralPct, speed.fault ? 1 : 0,
+           (unsigned long)speedStats.updates, (unsigned long)speedStats.saturated);
+  }
+  const LedStats led = ledGetStats();
+  logMsg(LOG_INFO, "  led writes=%lu suppressed=%lu", (unsigned long)led.writes, (unsigned long)led.suppressed);
+  logMsg(LOG_INFO, "  relay state=%u cycles=%lu hold_reuses=%lu cap_deferrals=%lu",
+         (unsigned)relayPolicyState(), (unsigned long)relay.cycles,
+         (unsigned long)relay.holdReuses, (unsigned long)relay.capDeferrals);
+  for (uint8_t i = 0; i < PROF_SECTION_COUNT; i++) {
+    const ProfSection sec = (ProfSection)i;
+    const ProfStats& p = profStats(sec);
+    if (!p.count) continue;
+    logMsg(LOG_INFO, "  prof %-7s n=%lu min=%lucyc avg=%lucyc max=%lucyc p99<%lucyc", profName(sec),
+           (unsigned long)p.count, (unsigned long)p.minCycles, (unsigned long)(p.sumCycles / p.count),
+           (unsigned long)p.maxCycles, (unsigned long)profPercentileCycles(sec, 99));
+  }
+  const LogStats lg = logGetStats();
+  logMsg(LOG_INFO, "  log written=%lu dropped=%lu printed=%lu depth_max=%lu", (unsigned long)lg.written,
+         (unsigned long)lg.dropped, (unsigned long)lg.printed, (unsigned long)lg.maxDepth);
 }
 
-int8_t controlGetDriveDir() {
-  return driveDir;
+void controlInit() {
+  // From power-up state, also when called again (host simulator runs).
+  controlApply(IDLE_CMD);
+  mode = CTL_MANUAL;
+  manualActive = true;
+  appConnected = false;
+  lastRxMs = halMillis() - LINK_ALIVE_MS - 1;
+  linkStage = LINK_CUT;
+  driveDir = 0;
+  driveSpeedPct = 0;
+  estopLatched.store(false);
+  estopPending.store(false);
+  estopStops.store(0);
+  estopReleases.store(0);
+  estopStats = EstopStats{};
+  speedCtlInit(WHEEL_ENCODER_FITTED);
+  rearCut();
+  steerReset();
+  ledReset(LED_LINK_DOWN, halMillis());
+  linkWatchReset(linkWatchDefaultConfig(), halMillis());
+  relayPolicyReset(relayDefaultConfig(), halMillis());
+  setRelay(false);
+  sensorsInit();
+  currentInit();
+  inputTask(0);
+  batteryReset(batteryFromPinVoltage(sensorsPinVoltage(SENSOR_BATTERY)));
+  derateReset(derateDefaultConfig(), batteryFromPinVoltage(sensorsPinVoltage(SENSOR_BATTERY)));
+  rearSetPowerLimit(derateGetState().maxDutyPct, derateGetState().accelPct / 100.0f);
+  TelemetrySnapshot snap;
+  publishTelemetry(halMillis(), snap);
+  schedInit(tasks, TASK_COUNT, halMicros());
 }
 
-uint8_t controlGetDriveSpeedPct() {
-  return driveSpeedPct;
+static uint8_t histBucket(uint32_t us) {
+  uint8_t b = 0;
+  while (us && b < ESTOP_HIST_BUCKETS - 1) {
+    us >>= 1;
+    b++;
+  }
+  return b;
 }
 
-bool controlGetSelectorFwdActive() {
-  return selectorFwdActive;
+// Control-task half of the e-stop: the fast path has already written the
+// outputs off; bring the driver state, relay policy and mode in line.
+static void applyEstop() {
+  rearCut();
+  steerStop();
+  const uint32_t now = halMillis();
+  relayPolicyUpdate(false, true, now);
+  setRelay(false);
+  mode = CTL_ESTOP;
+  manualActive = true;
+  driveDir = 0;
+  driveSpeedPct = 0;
+  const uint32_t cutUs = estopCutUs.load(std::memory_order_relaxed);
+  estopStats.cutHist[histBucket(cutUs)]++;
+  if (cutUs > estopStats.maxCutUs) estopStats.maxCutUs = cutUs;
+  const uint32_t us = halMicros() - estopRxUs.load(std::memory_order_relaxed);
+  estopStats.applyHist[histBucket(us)]++;
+  if (us > estopStats.maxApplyUs) estopStats.maxApplyUs = us;
+  TelemetrySnapshot snap;
+  publishTelemetry(now, snap);
 }
 
-bool controlGetSelectorBackActive() {
-  return selectorBackActive;
+void controlLoop() {
+  PROF_SCOPE(PROF_LOOP);
+  // E-stop before anything else on this pass, overdue tasks included.
+  if (estopPending.exchange(false, std::memory_order_acq_rel)) applyEstop();
+  schedRun(tasks, TASK_COUNT, halMicros());
 }
 
-float controlGetSelectorThrottleVoltage() {
-  return selectorThrottleVoltage;
+void controlEstop(uint32_t rxUs) {
+  // Latch first: a motor tick on the other core that writes after this
+  // point sees it and cuts again (estopRaced).
+  estopLatched.store(true);
+  cutOutputs();
+  estopCutUs.store(halMicros() - rxUs, std::memory_order_relaxed);
+  estopRxUs.store(rxUs, std::memory_order_relaxed);
+  estopStops.fetch_add(1, std::memory_order_relaxed);
+  estopPending.store(true, std::memory_order_release);
 }
 
-uint8_t controlGetSelectorThrottlePct() {
-  return selectorThrottlePct;
+void controlEstopRelease() {
+  if (!estopLatched.exchange(false, std::memory_order_acq_rel)) return;
+  estopReleases.fetch_add(1, std::memory_order_relaxed);
 }
 
+EstopStats controlEstopStats() {
+  EstopStats s = estopStats;
+  s.stops = estopStops.load(std::memory_order_relaxed);
+  s.releases = estopReleases.load(std::memory_order_relaxed);
+  return s;
+}
 
+const SchedTask* controlSchedTasks(uint8_t& count) {
+  count = TASK_COUNT;
+  return tasks;
+}
 
+void controlResetSchedStats() {
+  schedResetStats(tasks, TASK_COUNT);
+}
 
-
-
-
-
-
+void controlNotifyAppActivity() {
+  // appConnected follows on the next motor tick; blink phase stays continuous.
+  lastRxMs = halMillis();
+}
@@ -1,16 +1,38 @@
 #pragma once
 #include "protocol.h"
+#include "scheduler.h"
 
 void controlInit();
 void controlApply(const ControlCommand& cmd);
+// Polls the task table (see controlInit for rates); call as often as possible.
 void controlLoop();
+// A datagram from the app arrived (LED only; the link watchdog is fed by
+// accepted commands).
 void controlNotifyAppActivity();
-float controlGetBatteryVoltage();
-bool controlIsManualActive();
-int8_t controlGetManualGear();
-int8_t controlGetDriveDir();
-uint8_t controlGetDriveSpeedPct();
-bool controlGetSelectorFwdActive();
-bool controlGetSelectorBackActive();
-float controlGetSelectorThrottleVoltage();
-uint8_t controlGetSelectorThrottlePct();
+// Scheduler table with per-task run/overrun/jitter counters.
+const SchedTask* controlSchedTasks(uint8_t& count);
+void controlResetSchedStats();
+// State for status/logging is published per tick, see telemetry.h.
+
+// ===== E-stop fast path =====
+// controlEstop may be called from any task (the e-stop socket task, the
+// network task). It writes the rear bridge and relay to off itself, before
+// returning, and latches ESTOP; the next controlLoop pass applies the mode
+// before running any task. The latch holds until controlEstopRelease and
+// the car has stopped.
+static const uint8_t ESTOP_HIST_BUCKETS = 16; // bucket i: latency < 2^i us
+// Histograms get one entry per stop the control task applies (stops that
+// arrive while one is pending share it).
+struct EstopStats {
+  uint32_t stops;
+  uint32_t releases;
+  uint32_t cutHist[ESTOP_HIST_BUCKETS];   // datagram read -> outputs off
+  uint32_t applyHist[ESTOP_HIST_BUCKETS]; // datagram read -> control task in ESTOP
+  uint32_t maxCutUs;
+  uint32_t maxApplyUs;
+};
+// rxUs: halMicros() when the datagram was read.
+void controlEstop(uint32_t rxUs);
+void controlEstopRelease();
+// Control task.
+EstopStats controlEstopStats();
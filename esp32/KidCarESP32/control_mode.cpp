@@ -0,0 +1,164 @@
+#include "control_mode.h"
+#include "config.h"
+
+static const ControlModeDef kModes[CTL_MODE_COUNT] = {
+  // name        app    pedal  steer  estop  relayOff rear mode
+  {"MANUAL",     false, true,  false, false, false, REAR_MODE_MANUAL},
+  {"REMOTE",     true,  false, true,  false, false, REAR_MODE_REMOTE},
+  {"PARK_LOCK",  false, false, false, false, false, REAR_MODE_MANUAL},
+  {"LINK_LOST",  false, false, false, false, false, REAR_MODE_REMOTE},
+  {"FAILSAFE",   false, false, false, true,  true,  REAR_MODE_MANUAL},
+  {"OTA",        false, false, false, true,  true,  REAR_MODE_MANUAL},
+  {"LINK_CUT",   false, false, false, true,  true,  REAR_MODE_REMOTE},
+  {"ESTOP",      false, false, false, true,  true,  REAR_MODE_MANUAL},
+};
+
+// Where the inputs alone point, ignoring history.
+static constexpr ControlMode baseMode(uint8_t in) {
+  if (!(in & CTL_IN_LINK)) return CTL_MANUAL;
+  // Stale app commands never take over from the pedal.
+  if (!(in & CTL_IN_APP_MANUAL)) return (in & CTL_IN_STALE) ? CTL_MANUAL : CTL_REMOTE;
+  return (in & CTL_IN_PARK) ? CTL_PARK_LOCK : CTL_MANUAL;
+}
+
+static constexpr ControlMode nextRule(ControlMode mode, uint8_t in) {
+  if (in & CTL_IN_ESTOP) return CTL_ESTOP;
+  if (in & CTL_IN_OTA) return CTL_OTA;
+  if (in & CTL_IN_FAULT) return CTL_FAILSAFE;
+  const bool stopped = (in & CTL_IN_STOPPED) != 0;
+  switch (mode) {
+    case CTL_REMOTE:
+    case CTL_LINK_LOST:
+    case CTL_LINK_CUT:
+      // A moving car that loses the app brakes before the pedal takes over.
+      if (!(in & CTL_IN_LINK)) return stopped ? CTL_MANUAL : CTL_LINK_CUT;
+      if ((in & CTL_IN_STALE) && !(in & CTL_IN_APP_MANUAL)) {
+        return mode == CTL_REMOTE ? CTL_LINK_LOST : mode;
+      }
+      return baseMode(in);
+    case CTL_FAILSAFE:
+    case CTL_OTA:
+    case CTL_ESTOP:
+      // Only hand control back once the car is standing.
+      return stopped ? baseMode(in) : mode;
+    case CTL_MANUAL:
+    case CTL_PARK_LOCK:
+    default:
+      return baseMode(in);
+  }
+}
+
+struct ModeTable {
+  ControlMode next[CTL_MODE_COUNT][CTL_INPUT_COMBOS];
+};
+
+static constexpr ModeTable buildTable() {
+  ModeTable t = {};
+  for (uint8_t m = 0; m < CTL_MODE_COUNT; m++) {
+    for (uint16_t in = 0; in < CTL_INPUT_COMBOS; in++) {
+      t.next[m][in] = nextRule((ControlMode)m, (uint8_t)in);
+    }
+  }
+  return t;
+}
+
+static constexpr ModeTable kTable = buildTable();
+
+static constexpr bool tableIsStable(const ModeTable& t) {
+  for (uint8_t m = 0; m < CTL_MODE_COUNT; m++) {
+    for (uint16_t in = 0; in < CTL_INPUT_COMBOS; in++) {
+      const ControlMode n = t.next[m][in];
+      if (t.next[n][in] != n) return false;
+    }
+  }
+  return true;
+}
+static_assert(tableIsStable(kTable), "mode table must settle in one step");
+
+ControlMode controlModeNext(ControlMode mode, uint8_t inputs) {
+  if (mode >= CTL_MODE_COUNT) mode = CTL_FAILSAFE;
+  return kTable.next[mode][inputs & (CTL_INPUT_COMBOS - 1)];
+}
+
+const ControlModeDef& controlModeDef(ControlMode mode) {
+  return kModes[mode < CTL_MODE_COUNT ? mode : CTL_FAILSAFE];
+}
+
+int controlManualThrottlePct(float v) {
+  // Manual throttle mapping:
+  // >=2.0V: full stop
+  // 1.4V: minimum speed
+  // 0.0V: maximum speed
+  if (v >= 2.0f) return 0;
+
+  const int minPct = REAR_SOFTSTART_MIN_PCT;
+  if (v <= 1.4f) {
+    // 0.0..1.4V -> 100..minPct
+    float t = v / 1.4f;
+    if (t < 0.0f) t = 0.0f;
+    if (t > 1.0f) t = 1.0f;
+    int pct = (int)(100.0f - t * (100.0f - (float)minPct));
+    if (pct < minPct) pct = minPct;
+    if (pct > 100) pct = 100;
+    return pct;
+  }
+
+  // 1.4..2.0V -> minPct..0 for smooth transition to stop
+  float t = (v - 1.4f) / 0.6f;
+  if (t < 0.0f) t = 0.0f;
+  if (t > 1.0f) t = 1.0f;
+  int pct = (int)((1.0f - t) * (float)minPct);
+  if (pct < 0) pct = 0;
+  if (pct > minPct) pct = minPct;
+  return pct;
+}
+
+static void pedalCommand(const ManualInputs& in, ControlCommand& cmd, ManualReading& reading) {
+  if (in.throttleV > 2.0f) {
+    // Highest priority: if throttle input is above 2V, force full stop.
+    return;
+  }
+  reading.fwd = in.fwd;
+  reading.back = in.back;
+
+  int dir = 0;
+  if (in.fwd && !in.back) dir = 1;
+  if (in.back && !in.fwd) dir = -1;
+
+  int pct = controlManualThrottlePct(in.throttleV);
+  reading.throttlePct = (uint8_t)pct;
+  // Keep full stop when throttle voltage commands 0%.
+  // Soft-start minimum applies only for non-zero throttle requests.
+  if (dir != 0 && pct > 0 && pct < REAR_SOFTSTART_MIN_PCT) {
+    pct = REAR_SOFTSTART_MIN_PCT;
+  }
+  reading.gear = (int8_t)dir;
+  cmd.throttle = dir * pct;
+  cmd.speed = pct;
+}
+
+ControlCommand controlModeCommand(ControlMode mode, const ControlCommand& app, const ManualInputs& in,
+                                  ManualReading& reading) {
+  const ControlModeDef& def = controlModeDef(mode);
+  reading = ManualReading{0, false, false, 0.0f, 0};
+  ControlCommand cmd = app;
+  if (!def.appDrives) {
+    cmd.throttle = 0;
+    cmd.steer = 0;
+    cmd.steerMs = STEER_MAX_MS;
+    cmd.steerAbs = false;
+    cmd.speed = 0;
+  }
+  if (mode == CTL_MANUAL || mode == CTL_PARK_LOCK) reading.throttleV = in.throttleV;
+  if (def.pedalDrives) pedalCommand(in, cmd, reading);
+
+  // Reverse limit, for app and pedal alike.
+  int reverseLimit = (int)app.reverseSpeed;
+  if (reverseLimit > 100) reverseLimit = 100;
+  if (cmd.throttle < 0) {
+    if (-cmd.throttle > reverseLimit) cmd.throttle = -reverseLimit;
+    if (cmd.speed > reverseLimit) cmd.speed = reverseLimit;
+    if (reading.throttlePct > reverseLimit) reading.throttlePct = (uint8_t)reverseLimit;
+  }
+  return cmd;
+}
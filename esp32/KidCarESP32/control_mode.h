@@ -0,0 +1,82 @@
+#pragma once
+#include <Arduino.h>
+#include "protocol.h"
+#include "motor_rear.h"
+
+// ===== Control mode state machine =====
+// Who drives the car this tick, from a compile-time transition table:
+// next = table[mode][inputs], one lookup per tick. The table is built so a
+// second lookup with the same inputs never moves again (checked at compile
+// time), so one evaluation per tick is always enough.
+//
+//   MANUAL     pedal + selector (no app, or app in manual mode)
+//   REMOTE     app commands
+//   PARK_LOCK  app in manual mode with Park on: selector ignored
+//   LINK_LOST  REMOTE commands went stale (link_watch.h): brake on the
+//              remote profile, back to REMOTE if the app recovers
+//   LINK_CUT   app gone while still moving: emergency stop, relay off, then
+//              MANUAL once stopped
+//   FAILSAFE   input fault (selector reads FWD and BACK at once): stop, relay
+//              off, until the fault clears and the car has stopped
+//   OTA        firmware upload: stop, relay off
+//   ESTOP      e-stop datagram: outputs already cut by the fast path (see
+//              controlEstop), held off until released and stopped
+
+enum ControlMode : uint8_t {
+  CTL_MANUAL = 0,
+  CTL_REMOTE,
+  CTL_PARK_LOCK,
+  CTL_LINK_LOST,
+  CTL_FAILSAFE,
+  CTL_OTA,
+  CTL_LINK_CUT,
+  CTL_ESTOP,
+  CTL_MODE_COUNT
+};
+
+// Per-tick inputs, as a bit set.
+enum : uint8_t {
+  CTL_IN_OTA = 0x01,        // OTA in progress
+  CTL_IN_FAULT = 0x02,      // manual input fault
+  CTL_IN_LINK = 0x04,       // app connected (link stage below LINK_CUT)
+  CTL_IN_APP_MANUAL = 0x08, // last app command asked for manual mode
+  CTL_IN_PARK = 0x10,       // last app command had Park on
+  CTL_IN_STOPPED = 0x20,    // rear output at zero
+  CTL_IN_STALE = 0x40,      // app commands stale (link stage LINK_DECEL or later)
+  CTL_IN_ESTOP = 0x80,      // e-stop latched
+};
+static const uint16_t CTL_INPUT_COMBOS = 0x100;
+
+struct ControlModeDef {
+  const char* name;
+  bool appDrives;      // command source: app (else pedal/selector or none)
+  bool pedalDrives;
+  bool allowSteer;
+  bool emergencyStop;  // brake with the emergency decel
+  bool forceRelayOff;
+  RearDriveMode rearMode;
+};
+
+struct ManualInputs {
+  float throttleV;
+  bool fwd;
+  bool back;
+};
+
+// What the selector/pedal resolved to, for status and logs.
+struct ManualReading {
+  int8_t gear;      // -1 R, 0 N, 1 F
+  bool fwd;
+  bool back;
+  float throttleV;
+  uint8_t throttlePct;
+};
+
+ControlMode controlModeNext(ControlMode mode, uint8_t inputs);
+const ControlModeDef& controlModeDef(ControlMode mode);
+// Command for this tick in `mode`, with the reverse limit applied once for
+// every source.
+ControlCommand controlModeCommand(ControlMode mode, const ControlCommand& app, const ManualInputs& in,
+                                  ManualReading& reading);
+// Pedal voltage to throttle percent (>= 2.0 V is stop).
+int controlManualThrottlePct(float v);
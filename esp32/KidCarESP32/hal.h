@@ -0,0 +1,130 @@
+#pragma once
+#include <Arduino.h>
+#if !defined(KIDCAR_HOST)
+#include <driver/ledc.h>
+#include <driver/gpio.h>
+#include <driver/pulse_cnt.h>
+#endif
+
+// ===== Hardware abstraction =====
+// Core control code talks to the board through these calls only, so the same
+// translation units can be built on the host (see esp32/host) against a
+// simulated clock, GPIO, ADC and LEDC backend.
+
+// Continuous (DMA) ADC: the ESP32-S3 driver only streams ADC1, i.e. GPIO1..10.
+inline bool halAdcStreamCapable(int pin) { return pin >= 1 && pin <= 10; }
+
+#if defined(KIDCAR_HOST)
+uint32_t halMillis();
+uint32_t halMicros();
+void halDigitalWrite(int pin, int level);
+int halDigitalRead(int pin);
+int halAnalogRead(int pin);
+void halLedcWrite(int channel, uint32_t duty);
+void halRgbWrite(int pin, uint8_t r, uint8_t g, uint8_t b);
+bool halAdcStreamStart(const uint8_t* pins, uint8_t count, uint16_t samplesPerPin, uint32_t sampleHz);
+bool halAdcStreamRead(uint16_t* raw, uint8_t count);
+bool halLedcFade(int pin, int channel, uint32_t fromDuty, uint32_t toDuty, uint16_t ms);
+bool halLedcFading(int channel);
+void halLedcFadeStop(int channel);
+// Host: a monotonic nanosecond count of real (not virtual) time, so
+// profiled sections measure what the host actually spent.
+uint32_t halCycles();
+inline uint32_t halCyclesPerUs() { return 1000; }
+bool halPcntBegin(int pin);
+uint32_t halPcntCount();
+#else
+inline uint32_t halMillis() { return millis(); }
+inline uint32_t halMicros() { return micros(); }
+inline void halDigitalWrite(int pin, int level) { digitalWrite(pin, level); }
+inline int halDigitalRead(int pin) { return digitalRead(pin); }
+inline int halAnalogRead(int pin) { return analogRead(pin); }
+inline void halLedcWrite(int channel, uint32_t duty) { ledcWriteChannel(channel, duty); }
+inline void halRgbWrite(int pin, uint8_t r, uint8_t g, uint8_t b) { rgbLedWrite(pin, r, g, b); }
+// CPU cycle counter (CCOUNT) of the calling core; wraps every ~18 s at 240 MHz.
+inline uint32_t halCycles() { return ESP.getCycleCount(); }
+inline uint32_t halCyclesPerUs() { return getCpuFrequencyMhz(); }
+
+// LEDC hardware fade. The core's fade API is per pin, the rest of the LEDC
+// calls here are per channel, so fades take both. The completion ISR clears
+// the busy flag; a new write or fade must wait for it or stop the fade.
+static const int HAL_LEDC_CHANNELS = 16;
+inline volatile bool halLedcFadeBusy[HAL_LEDC_CHANNELS] = {};
+inline void ARDUINO_ISR_ATTR halLedcOnFadeDone(void* arg) {
+  halLedcFadeBusy[(uintptr_t)arg] = false;
+}
+
+inline bool halLedcFade(int pin, int channel, uint32_t fromDuty, uint32_t toDuty, uint16_t ms) {
+  halLedcFadeBusy[channel] = true;
+  if (!ledcFadeWithInterruptArg(pin, fromDuty, toDuty, ms, halLedcOnFadeDone, (void*)(uintptr_t)channel)) {
+    halLedcFadeBusy[channel] = false;
+    return false;
+  }
+  return true;
+}
+inline bool halLedcFading(int channel) { return halLedcFadeBusy[channel]; }
+// Freezes the duty where the fade got to.
+inline void halLedcFadeStop(int channel) {
+  if (!halLedcFadeBusy[channel]) return;
+  ledc_fade_stop((ledc_mode_t)(channel / 8), (ledc_channel_t)(channel % 8));
+  halLedcFadeBusy[channel] = false;
+}
+
+// Pulse counter (PCNT) on one input: rising edges counted in hardware with
+// a glitch filter, accumulated past the unit's 16-bit range. The count is a
+// free-running uint32; callers take differences.
+inline pcnt_unit_handle_t halPcntUnit = nullptr;
+inline bool halPcntBegin(int pin) {
+  pcnt_unit_config_t unitCfg = {};
+  unitCfg.low_limit = -1;
+  unitCfg.high_limit = 30000;
+  unitCfg.flags.accum_count = 1;
+  if (pcnt_new_unit(&unitCfg, &halPcntUnit) != ESP_OK) return false;
+  pcnt_glitch_filter_config_t filter = {};
+  filter.max_glitch_ns = 1000;
+  pcnt_unit_set_glitch_filter(halPcntUnit, &filter);
+  pcnt_chan_config_t chanCfg = {};
+  chanCfg.edge_gpio_num = pin;
+  chanCfg.level_gpio_num = -1;
+  pcnt_channel_handle_t chan = nullptr;
+  if (pcnt_new_channel(halPcntUnit, &chanCfg, &chan) != ESP_OK) return false;
+  pcnt_channel_set_edge_action(chan, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_HOLD);
+  gpio_pullup_en((gpio_num_t)pin); // open-collector hall sensors
+  // With accum_count, reaching the watch point folds the count into the total.
+  pcnt_unit_add_watch_point(halPcntUnit, unitCfg.high_limit);
+  pcnt_unit_enable(halPcntUnit);
+  pcnt_unit_clear_count(halPcntUnit);
+  return pcnt_unit_start(halPcntUnit) == ESP_OK;
+}
+inline uint32_t halPcntCount() {
+  int count = 0;
+  if (halPcntUnit != nullptr) pcnt_unit_get_count(halPcntUnit, &count);
+  return (uint32_t)count;
+}
+
+// Set from the driver ISR when a frame (samplesPerPin conversions of every
+// pin) is complete, so the read below never has to wait or time out.
+inline volatile bool halAdcFrameReady = false;
+inline void ARDUINO_ISR_ATTR halAdcOnFrame() { halAdcFrameReady = true; }
+
+// Starts background conversions of `pins` round-robin at sampleHz in total.
+inline bool halAdcStreamStart(const uint8_t* pins, uint8_t count, uint16_t samplesPerPin, uint32_t sampleHz) {
+  analogContinuousSetWidth(12);
+  analogContinuousSetAtten(ADC_11db);
+  if (!analogContinuous((uint8_t*)pins, count, samplesPerPin, sampleHz, halAdcOnFrame)) return false;
+  return analogContinuousStart();
+}
+
+// Copies the newest completed frame (per-pin averages, in start order).
+// Returns false without touching raw when no new frame is ready.
+inline bool halAdcStreamRead(uint16_t* raw, uint8_t count) {
+  if (!halAdcFrameReady) return false;
+  halAdcFrameReady = false;
+  adc_continuous_data_t* result = nullptr;
+  if (!analogContinuousRead(&result, 0) || result == nullptr) return false;
+  for (uint8_t i = 0; i < count; i++) {
+    raw[i] = (uint16_t)result[i].avg_read_raw;
+  }
+  return true;
+}
+#endif
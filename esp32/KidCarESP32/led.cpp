@@ -0,0 +1,66 @@
+#include "led.h"
+#include "config.h"
+#include "pins.h"
+#include "hal.h"
+
+static LedPattern pattern = {0, {0, 0, 0}, false};
+static int8_t driveDir = 0;
+static uint8_t driveSpeedPct = 0;
+static bool phaseOn = true;
+static uint32_t phaseStartMs = 0;
+static LedRgb shown = {0, 0, 0};
+static LedStats stats = {0, 0};
+
+static bool sameColor(const LedRgb& a, const LedRgb& b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+static void show(const LedRgb& c) {
+  if (sameColor(c, shown)) {
+    stats.suppressed++;
+    return;
+  }
+  halRgbWrite(RGB_PIN, c.r, c.g, c.b);
+  shown = c;
+  stats.writes++;
+}
+
+void ledReset(const LedPattern& p, uint32_t nowMs) {
+  pattern = p;
+  driveDir = 0;
+  driveSpeedPct = 0;
+  phaseOn = true;
+  phaseStartMs = nowMs;
+  stats = LedStats{0, 0};
+  halRgbWrite(RGB_PIN, 0, 0, 0);
+  shown = LedRgb{0, 0, 0};
+}
+
+void ledSetPattern(const LedPattern& p, int8_t dir, uint8_t speedPct) {
+  pattern = p;
+  driveDir = dir;
+  driveSpeedPct = speedPct;
+}
+
+static LedRgb onColor() {
+  if (!pattern.byDirection || driveSpeedPct == 0 || driveDir == 0) return pattern.color;
+  // Brightness follows speed, colour follows direction.
+  uint8_t v = (uint8_t)((driveSpeedPct * 255) / 100);
+  if (v < 20) v = 20;
+  return driveDir > 0 ? LedRgb{0, v, 0} : LedRgb{0, 0, v};
+}
+
+void ledRun(uint32_t nowMs) {
+  if (pattern.blinkMs == 0) {
+    phaseOn = true;
+    phaseStartMs = nowMs;
+  } else if (nowMs - phaseStartMs >= pattern.blinkMs) {
+    phaseStartMs = nowMs;
+    phaseOn = !phaseOn;
+  }
+  show(phaseOn ? onColor() : LedRgb{0, 0, 0});
+}
+
+LedStats ledGetStats() {
+  return stats;
+}
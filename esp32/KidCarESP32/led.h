@@ -0,0 +1,34 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== RGB status LED =====
+// Small pattern engine for the on-board WS2812. The caller picks a pattern
+// (usually from a table keyed by state) and feeds the live drive values;
+// ledRun works out the colour for now and only writes the LED when that
+// colour differs from the last frame sent. rgbLedWrite is a blocking RMT
+// transaction, so a steady pattern costs nothing between blink edges.
+
+struct LedRgb {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+};
+
+struct LedPattern {
+  uint16_t blinkMs;   // on and off phase length; 0 = solid
+  LedRgb color;       // colour while on (and when stopped, if byDirection)
+  bool byDirection;   // moving: green forward / blue reverse, brightness by speed
+};
+
+struct LedStats {
+  uint32_t writes;     // frames sent to the LED
+  uint32_t suppressed; // runs that found the colour unchanged
+};
+
+// Clears the LED and starts with `p`.
+void ledReset(const LedPattern& p, uint32_t nowMs);
+// Pattern and drive values for the next ledRun. Switching pattern keeps the
+// blink phase, so the LED does not jump on every state change.
+void ledSetPattern(const LedPattern& p, int8_t dir, uint8_t speedPct);
+void ledRun(uint32_t nowMs);
+LedStats ledGetStats();
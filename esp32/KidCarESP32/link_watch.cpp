@@ -0,0 +1,86 @@
+#include "link_watch.h"
+#include "config.h"
+
+// Gaps longer than this are an outage, not a sample of the link's rhythm.
+static const uint32_t MAX_GAP_SAMPLE_MS = 2000;
+
+static LinkWatchConfig cfg = {0, 0, 0, 0};
+static LinkStage stage = LINK_CUT;
+static bool seen = false;
+static bool haveGap = false;
+static uint32_t lastPacketMs = 0;
+// Smoothed gap and mean deviation, in ms << 3 / ms << 2 (RFC 6298 gains).
+static uint32_t sGap8 = 0;
+static uint32_t sDev4 = 0;
+static LinkWatchStats stats = {0, 0, 0, 0, 0, 0, 0, 0};
+
+LinkWatchConfig linkWatchDefaultConfig() {
+  return LinkWatchConfig{LINK_LATE_MIN_MS, LINK_LATE_MAX_MS, LINK_HOLD_MS, LINK_DECEL_MS};
+}
+
+static uint32_t lateMs() {
+  if (!haveGap) return cfg.lateMaxMs;
+  uint32_t late = (sGap8 >> 3) + sDev4; // mean + 4 * dev
+  if (late < cfg.lateMinMs) late = cfg.lateMinMs;
+  if (late > cfg.lateMaxMs) late = cfg.lateMaxMs;
+  return late;
+}
+
+void linkWatchReset(const LinkWatchConfig& config, uint32_t nowMs) {
+  cfg = config;
+  stage = LINK_CUT;
+  seen = false;
+  haveGap = false;
+  lastPacketMs = nowMs;
+  sGap8 = 0;
+  sDev4 = 0;
+  stats = LinkWatchStats{0, 0, 0, 0, lateMs(), 0, 0, 0};
+}
+
+void linkWatchPacket(uint32_t nowMs) {
+  stats.packets++;
+  const uint32_t gap = nowMs - lastPacketMs;
+  if (seen && gap > 0) {
+    if (gap > stats.maxGapMs) stats.maxGapMs = gap;
+    if (gap <= MAX_GAP_SAMPLE_MS) {
+      if (!haveGap) {
+        sGap8 = gap << 3;
+        sDev4 = gap << 1; // dev = gap / 2
+        haveGap = true;
+      } else {
+        const uint32_t mean = sGap8 >> 3;
+        const uint32_t err = gap > mean ? gap - mean : mean - gap;
+        sGap8 = sGap8 - (sGap8 >> 3) + gap;
+        sDev4 = sDev4 - (sDev4 >> 2) + err;
+      }
+    }
+  }
+  seen = true;
+  lastPacketMs = nowMs;
+}
+
+LinkStage linkWatchUpdate(uint32_t nowMs) {
+  LinkStage next = LINK_CUT;
+  const uint32_t late = lateMs();
+  if (seen) {
+    const uint32_t silence = nowMs - lastPacketMs;
+    if (silence <= late) next = LINK_OK;
+    else if (silence <= late + cfg.holdMs) next = LINK_HOLD;
+    else if (silence <= late + cfg.holdMs + cfg.decelMs) next = LINK_DECEL;
+  }
+  if (next > stage) {
+    // Count each rung passed, also when a tick skips one.
+    if (stage < LINK_HOLD && next >= LINK_HOLD) stats.holds++;
+    if (stage < LINK_DECEL && next >= LINK_DECEL) stats.decels++;
+    if (next == LINK_CUT) stats.cuts++;
+  }
+  stage = next;
+  stats.lateMs = late;
+  stats.meanGapMs = sGap8 >> 3;
+  stats.devGapMs = sDev4 >> 2;
+  return stage;
+}
+
+LinkWatchStats linkWatchStats() {
+  return stats;
+}
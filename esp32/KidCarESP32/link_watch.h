@@ -0,0 +1,50 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== App link watchdog =====
+// Tracks the gaps between accepted commands from the app (datagrams that fail
+// to parse or that cmd_guard rejects do not count) and turns silence into a
+// failsafe stage:
+//   LINK_OK     silence within what the link usually shows
+//   LINK_HOLD   late: keep applying the last command for holdMs
+//   LINK_DECEL  commands are stale: brake along the normal profile
+//   LINK_CUT    app gone: relay off, pedal takes over once stopped
+// "Usually" is learned from the inter-arrival times (smoothed mean plus four
+// mean deviations, as for a TCP retransmit timer), clamped to
+// [lateMinMs, lateMaxMs], so a steady 100 ms sender trips much sooner than
+// one the phone is throttling to 500 ms.
+
+enum LinkStage : uint8_t {
+  LINK_OK = 0,
+  LINK_HOLD,
+  LINK_DECEL,
+  LINK_CUT,
+};
+
+struct LinkWatchConfig {
+  uint32_t lateMinMs;
+  uint32_t lateMaxMs;
+  uint32_t holdMs;
+  uint32_t decelMs;
+};
+
+struct LinkWatchStats {
+  uint32_t packets;
+  uint32_t meanGapMs;
+  uint32_t devGapMs;
+  uint32_t maxGapMs;
+  uint32_t lateMs;  // current OK -> HOLD threshold
+  uint32_t holds;   // times each stage was entered
+  uint32_t decels;
+  uint32_t cuts;
+};
+
+// Default ladder from config.h.
+LinkWatchConfig linkWatchDefaultConfig();
+// Starts in LINK_CUT: no app until the first datagram.
+void linkWatchReset(const LinkWatchConfig& cfg, uint32_t nowMs);
+// A datagram arrived (any kind).
+void linkWatchPacket(uint32_t nowMs);
+// Stage for this tick; call once per control tick.
+LinkStage linkWatchUpdate(uint32_t nowMs);
+LinkWatchStats linkWatchStats();
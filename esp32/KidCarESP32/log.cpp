@@ -0,0 +1,178 @@
+#include "log.h"
+#include "mpsc_queue.h"
+#include "config.h"
+#include "hal.h"
+#include "profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static MpscQueue<LogRecord, LOG_RING_RECORDS> ring;
+static std::atomic<uint8_t> level{LOG_DEFAULT_LEVEL};
+static std::atomic<uint32_t> written{0};
+static std::atomic<uint32_t> dropped{0};
+static std::atomic<uint32_t> maxDepth{0};
+static uint32_t printed = 0;        // consumer only
+static uint32_t droppedReported = 0; // consumer only
+
+void logSetLevel(LogLevel l) {
+  level.store(l, std::memory_order_relaxed);
+}
+
+LogLevel logGetLevel() {
+  return (LogLevel)level.load(std::memory_order_relaxed);
+}
+
+static bool push(LogLevel lvl, const char* fmt, const LogArg* args, uint8_t argc, const char* text,
+                 size_t len) {
+  if (!logEnabled(lvl)) return false;
+  if (argc > LOG_MAX_ARGS) argc = LOG_MAX_ARGS;
+  if (len > LOG_TEXT_MAX) len = LOG_TEXT_MAX;
+  const uint32_t now = halMillis();
+  // Only the used part of the record is copied.
+  const bool ok = ring.emplace([&](LogRecord& rec) {
+    rec.ms = now;
+    rec.fmt = fmt;
+    rec.level = lvl;
+    rec.argc = argc;
+    rec.textLen = (uint8_t)len;
+    if (argc) memcpy(rec.args, args, argc * sizeof(LogArg));
+    if (len) memcpy(rec.text, text, len);
+  });
+  if (!ok) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  written.fetch_add(1, std::memory_order_relaxed);
+  const uint32_t depth = ring.size();
+  uint32_t seen = maxDepth.load(std::memory_order_relaxed);
+  while (depth > seen && !maxDepth.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {
+  }
+  return true;
+}
+
+bool logPush(LogLevel lvl, const char* fmt, const LogArg* args, uint8_t argc) {
+  return push(lvl, fmt, args, argc, nullptr, 0);
+}
+
+bool logText(LogLevel lvl, const char* prefix, const char* text, size_t len) {
+  return push(lvl, prefix, nullptr, 0, text, len);
+}
+
+// ===== Formatting (log task) =====
+static void advance(size_t& n, int w, size_t cap) {
+  if (w <= 0) return;
+  n += (size_t)w;
+  if (n > cap - 1) n = cap - 1;
+}
+
+size_t logFormat(const LogRecord& rec, char* buf, size_t cap) {
+  if (cap == 0) return 0;
+  size_t n = 0;
+  uint8_t argi = 0;
+  const char* p = rec.fmt ? rec.fmt : "";
+  while (*p && n + 1 < cap) {
+    if (*p != '%') {
+      buf[n++] = *p++;
+      continue;
+    }
+    if (p[1] == '%') {
+      buf[n++] = '%';
+      p += 2;
+      continue;
+    }
+    // Rebuild the conversion without length modifiers: arguments are 32-bit.
+    char spec[16];
+    size_t sl = 0;
+    spec[sl++] = *p++;
+    while (*p && strchr("-+ #0123456789.", *p) && sl < sizeof(spec) - 2) spec[sl++] = *p++;
+    while (*p == 'l' || *p == 'h' || *p == 'z') p++;
+    const char conv = *p;
+    if (!conv) break;
+    p++;
+    spec[sl++] = conv;
+    spec[sl] = 0;
+    LogArg a;
+    a.u = 0;
+    if (argi < rec.argc) a = rec.args[argi++];
+    switch (conv) {
+      case 'd':
+      case 'i':
+      case 'c':
+        advance(n, snprintf(buf + n, cap - n, spec, (int)a.i), cap);
+        break;
+      case 'u':
+      case 'x':
+      case 'X':
+        advance(n, snprintf(buf + n, cap - n, spec, (unsigned)a.u), cap);
+        break;
+      case 'f':
+      case 'e':
+      case 'g':
+      case 'E':
+      case 'G':
+        advance(n, snprintf(buf + n, cap - n, spec, (double)a.f), cap);
+        break;
+      case 's':
+        advance(n, snprintf(buf + n, cap - n, spec, a.s ? a.s : "(null)"), cap);
+        break;
+      default:
+        break;
+    }
+  }
+  for (uint8_t i = 0; i < rec.textLen && n + 1 < cap; i++) buf[n++] = rec.text[i];
+  buf[n] = 0;
+  return n;
+}
+
+uint32_t logDrain(uint32_t maxRecords) {
+  const uint32_t lost = dropped.load(std::memory_order_relaxed);
+  if (lost != droppedReported) {
+    Serial.printf("LOG DROPPED %lu\n", (unsigned long)(lost - droppedReported));
+    droppedReported = lost;
+  }
+  uint32_t count = 0;
+  LogRecord rec;
+  char line[160];
+  while (count < maxRecords && ring.pop(rec)) {
+    logFormat(rec, line, sizeof(line));
+    {
+      PROF_SCOPE(PROF_SERIAL);
+      Serial.println(line);
+    }
+    count++;
+  }
+  printed += count;
+  return count;
+}
+
+LogStats logGetStats() {
+  return LogStats{written.load(std::memory_order_relaxed), dropped.load(std::memory_order_relaxed), printed,
+                  maxDepth.load(std::memory_order_relaxed)};
+}
+
+void logReset() {
+  LogRecord rec;
+  while (ring.pop(rec)) {
+  }
+  written.store(0);
+  dropped.store(0);
+  maxDepth.store(0);
+  printed = 0;
+  droppedReported = 0;
+}
+
+#if defined(KIDCAR_HOST)
+void logStartTask() {}
+#else
+static void logTask(void*) {
+  for (;;) {
+    // Serial blocks this task (and only this task) while the UART drains.
+    if (logDrain(8) == 0) vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+void logStartTask() {
+  xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK, nullptr, LOG_TASK_PRIORITY, nullptr, LOG_TASK_CORE);
+}
+#endif
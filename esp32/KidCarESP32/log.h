@@ -0,0 +1,84 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Deferred logger =====
+// Hot paths must not block on the UART (at 115200 baud an 80-byte line is
+// ~7 ms once the FIFO is full). logMsg stores a binary record (format
+// pointer plus raw arguments) in a lock-free ring and returns; a
+// low-priority task formats and prints the records later. When the ring is
+// full the record is dropped and counted; the caller never waits.
+//
+// Format strings must be literals (only the pointer is stored). %s
+// arguments must be static strings too; copy dynamic text with logText.
+// Supported conversions: d i u x X c f e g s %, with flags, width,
+// precision and the l length modifier.
+
+enum LogLevel : uint8_t {
+  LOG_ERROR = 0,
+  LOG_WARN,
+  LOG_INFO,
+  LOG_DEBUG,
+};
+
+static const uint8_t LOG_MAX_ARGS = 8;
+static const uint8_t LOG_TEXT_MAX = 64;
+
+union LogArg {
+  int32_t i;
+  uint32_t u;
+  float f;
+  const char* s;
+};
+
+struct LogRecord {
+  uint32_t ms;
+  const char* fmt;
+  uint8_t level;
+  uint8_t argc;
+  uint8_t textLen; // logText: bytes in text, appended after fmt
+  LogArg args[LOG_MAX_ARGS];
+  char text[LOG_TEXT_MAX];
+};
+
+struct LogStats {
+  uint32_t written;
+  uint32_t dropped;  // ring full
+  uint32_t printed;
+  uint32_t maxDepth; // most records waiting at once
+};
+
+void logSetLevel(LogLevel level);
+LogLevel logGetLevel();
+inline bool logEnabled(LogLevel level) {
+  return level <= logGetLevel();
+}
+
+bool logPush(LogLevel level, const char* fmt, const LogArg* args, uint8_t argc);
+// Prints `prefix` followed by up to LOG_TEXT_MAX bytes of `text`.
+bool logText(LogLevel level, const char* prefix, const char* text, size_t len);
+
+// int32_t/uint32_t are int or long depending on the toolchain; both are covered.
+inline LogArg logArg(int v) { LogArg a; a.i = (int32_t)v; return a; }
+inline LogArg logArg(unsigned v) { LogArg a; a.u = (uint32_t)v; return a; }
+inline LogArg logArg(long v) { LogArg a; a.i = (int32_t)v; return a; }
+inline LogArg logArg(unsigned long v) { LogArg a; a.u = (uint32_t)v; return a; }
+inline LogArg logArg(double v) { LogArg a; a.f = (float)v; return a; }
+inline LogArg logArg(const char* v) { LogArg a; a.s = v; return a; }
+
+template <typename... Args>
+inline bool logMsg(LogLevel level, const char* fmt, Args... args) {
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+  if (!logEnabled(level)) return false;
+  const LogArg packed[sizeof...(Args) + 1] = {logArg(args)...};
+  return logPush(level, fmt, packed, (uint8_t)sizeof...(Args));
+}
+
+// Formats and prints up to maxRecords waiting records; returns how many.
+// Single consumer: the log task, or the caller's loop on the host.
+uint32_t logDrain(uint32_t maxRecords);
+// Formats one record into buf (no newline); returns the length.
+size_t logFormat(const LogRecord& rec, char* buf, size_t cap);
+LogStats logGetStats();
+void logReset();
+// Device: low-priority task that drains the ring to Serial.
+void logStartTask();
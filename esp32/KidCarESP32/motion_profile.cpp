@@ -0,0 +1,84 @@
+#include "motion_profile.h"
+#include <math.h>
+
+static int8_t signOf(float v) {
+  if (v > 0.0f) return 1;
+  if (v < 0.0f) return -1;
+  return 0;
+}
+
+void motionReset(MotionState& s) {
+  s.duty = 0.0f;
+  s.rate = 0.0f;
+  s.dir = 0;
+  s.zeroUs = 0xFFFFFFFFu;
+}
+
+float motionStep(MotionState& s, const MotionLimits& lim, float target, bool emergency, uint32_t dtUs) {
+  if (target > 100.0f) target = 100.0f;
+  if (target < -100.0f) target = -100.0f;
+  if (dtUs == 0) return s.duty;
+  const float dt = (float)dtUs * 1e-6f;
+
+  // Reversal: brake to zero first, then coast there before pulling the
+  // other way.
+  float goal = target;
+  const int8_t targetDir = signOf(target);
+  if (s.duty != 0.0f) {
+    s.dir = signOf(s.duty);
+    s.zeroUs = 0;
+    if (targetDir != 0 && targetDir != s.dir) goal = 0.0f;
+  } else {
+    if (s.zeroUs < 0xFFFFFFFFu - dtUs) s.zeroUs += dtUs;
+    const bool reversing = targetDir != 0 && s.dir != 0 && targetDir != s.dir;
+    if (reversing && s.zeroUs < (uint32_t)lim.coastMs * 1000U) goal = 0.0f;
+  }
+
+  const float err = goal - s.duty;
+  if (emergency && goal == 0.0f) {
+    // Straight line down, no jerk shaping.
+    const float step = lim.eDecelPctPerS * dt;
+    if (fabsf(s.duty) <= step) {
+      s.duty = 0.0f;
+      s.rate = 0.0f;
+    } else {
+      s.rate = -(float)signOf(s.duty) * lim.eDecelPctPerS;
+      s.duty += s.rate * dt;
+    }
+    return s.duty;
+  }
+
+  const bool growing = fabsf(goal) > fabsf(s.duty);
+  const float rateMax = growing ? lim.accelPctPerS : lim.decelPctPerS;
+  // Fastest rate from which a jerk-limited brake, taken in dt-sized steps,
+  // still stops on the goal: v^2 / 2J + v dt / 2 = |err|.
+  const float j = lim.jerkPctPerS2;
+  float want = j * (sqrtf(dt * dt * 0.25f + 2.0f * fabsf(err) / j) - dt * 0.5f);
+  if (want > rateMax) want = rateMax;
+  want *= (float)signOf(err);
+
+  const float maxDv = lim.jerkPctPerS2 * dt;
+  float dv = want - s.rate;
+  if (dv > maxDv) dv = maxDv;
+  if (dv < -maxDv) dv = -maxDv;
+  s.rate += dv;
+  const float before = s.duty;
+  s.duty += s.rate * dt;
+  if (signOf(before) * signOf(s.duty) < 0) {
+    // A leftover braking rate never carries through zero into the other
+    // direction; only a fresh start from zero does.
+    s.duty = 0.0f;
+    s.rate = 0.0f;
+    return s.duty;
+  }
+
+  // Land exactly on the goal instead of crossing it (or zero on a reversal).
+  if ((err > 0.0f && s.duty >= goal) || (err < 0.0f && s.duty <= goal) ||
+      (err == 0.0f && fabsf(s.rate) <= maxDv && fabsf(s.duty - goal) <= maxDv * dt)) {
+    s.duty = goal;
+    s.rate = 0.0f;
+  }
+  if (s.duty > 100.0f) s.duty = 100.0f;
+  if (s.duty < -100.0f) s.duty = -100.0f;
+  return s.duty;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Rear motion profile =====
+// Jerk-limited (S-curve) tracking of a signed duty target, in % of full
+// duty. Pure math, no I/O: motor_rear owns one state and feeds it the
+// target every motor tick.
+//
+// - accel applies while |duty| grows, decel while it shrinks; the rate of
+//   change itself moves at most `jerk` per second, and braking towards the
+//   target starts early enough to land on it without overshoot.
+// - emergency stops ignore jerk and use eDecel.
+// - a reversal brakes to zero, holds zero for coastMs, then starts again.
+
+struct MotionLimits {
+  float accelPctPerS;
+  float decelPctPerS;
+  float eDecelPctPerS;
+  float jerkPctPerS2;
+  uint16_t coastMs;
+};
+
+struct MotionState {
+  float duty;        // signed, -100..100
+  float rate;        // duty %/s
+  int8_t dir;        // last non-zero direction
+  uint32_t zeroUs;   // time spent at zero since the last motion
+};
+
+void motionReset(MotionState& s);
+// Advances the profile by dtUs towards target (-100..100); returns the new
+// signed duty.
+float motionStep(MotionState& s, const MotionLimits& lim, float target, bool emergency, uint32_t dtUs);
@@ -0,0 +1,87 @@
+#include "motor_current.h"
+#include "sensors.h"
+#include "config.h"
+
+static float motorA = 0.0f;
+static float peakA = 0.0f;      // current window
+static float peakPrevA = 0.0f;  // previous window
+static float avgA = 0.0f;
+static float heat = 0.0f;       // (I / CURRENT_CONT_A)² filtered over the thermal time constant
+static float ceiling = 100.0f;
+static uint32_t lastUpdates = 0;
+static uint32_t sinceSampleUs = 0;
+static uint32_t windowUs = 0;
+static CurrentStats stats = {0, 0, 0.0f};
+
+static float limitFor(float h) {
+  const float from = CURRENT_DERATE_FROM_PCT / 100.0f;
+  if (h <= from) return CURRENT_PEAK_LIMIT_A;
+  if (h >= 1.0f) return CURRENT_CONT_A;
+  return CURRENT_PEAK_LIMIT_A + (CURRENT_CONT_A - CURRENT_PEAK_LIMIT_A) * (h - from) / (1.0f - from);
+}
+
+static float blend(float tauMs, float dtS) {
+  const float k = dtS * 1000.0f / tauMs;
+  return k > 1.0f ? 1.0f : k;
+}
+
+void currentInit() {
+  motorA = 0.0f;
+  peakA = 0.0f;
+  peakPrevA = 0.0f;
+  avgA = 0.0f;
+  heat = 0.0f;
+  ceiling = 100.0f;
+  lastUpdates = sensorsUpdates(SENSOR_MOTOR_CURRENT);
+  sinceSampleUs = 0;
+  windowUs = 0;
+  stats = CurrentStats{0, 0, 0.0f};
+}
+
+float currentDutyCeiling(float appliedPct, uint32_t dtUs) {
+  sinceSampleUs += dtUs;
+  windowUs += dtUs;
+  if (windowUs >= (uint32_t)CURRENT_PEAK_WINDOW_MS * 1000U) {
+    peakPrevA = peakA;
+    peakA = 0.0f;
+    windowUs = 0;
+  }
+
+  const uint32_t n = sensorsUpdates(SENSOR_MOTOR_CURRENT);
+  if (n != lastUpdates) {
+    lastUpdates = n;
+    const float dtS = (float)sinceSampleUs / 1.0e6f;
+    sinceSampleUs = 0;
+    const float supplyA = sensorsPinVoltage(SENSOR_MOTOR_CURRENT) / CURRENT_SENSE_R_OHM * CURRENT_SENSE_RATIO;
+    const float duty = appliedPct < CURRENT_MIN_DUTY_PCT ? CURRENT_MIN_DUTY_PCT : appliedPct;
+    motorA = supplyA * 100.0f / duty;
+    stats.samples++;
+    if (motorA > stats.maxA) stats.maxA = motorA;
+    if (motorA > peakA) peakA = motorA;
+    avgA += (motorA - avgA) * blend(CURRENT_AVG_TAU_MS, dtS);
+    const float rel = motorA / CURRENT_CONT_A;
+    heat += (rel * rel - heat) * blend(CURRENT_THERMAL_TAU_MS, dtS);
+
+    const float limit = limitFor(heat);
+    if (motorA > limit) {
+      const float cut = appliedPct * limit / motorA;
+      if (cut < ceiling) ceiling = cut;
+      stats.cuts++;
+      return ceiling;
+    }
+  }
+  if (motorA <= limitFor(heat) && ceiling < 100.0f) {
+    ceiling += CURRENT_RECOVER_PCT_S * (float)dtUs / 1.0e6f;
+    if (ceiling > 100.0f) ceiling = 100.0f;
+  }
+  return ceiling;
+}
+
+CurrentState currentGetState() {
+  return CurrentState{motorA, peakA > peakPrevA ? peakA : peakPrevA, avgA, limitFor(heat), ceiling,
+                      heat * 100.0f, ceiling < 100.0f};
+}
+
+CurrentStats currentGetStats() {
+  return stats;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Rear motor current =====
+// The BTS7960 IS pins source a fixed fraction of the high-side current, so
+// an ADC frame (its samples spread evenly over the PWM period, see
+// sensorsStreamSampleHz) reads the supply current, duty x motor current. Divided by the duty that was on the bridge it gives
+// the motor current, which is what heats the motors and the bridge.
+//
+// Fast limit: a reading above the limit cuts the duty ceiling in proportion
+// (a stalled motor's current scales with duty, so the next reading lands on
+// the limit); below it the ceiling climbs back at CURRENT_RECOVER_PCT_S. The
+// limit is CURRENT_PEAK_LIMIT_A while the I²t model is cool and falls to
+// CURRENT_CONT_A as the model nears its steady state at that current.
+// Braking current flows through the low sides and is not seen by IS.
+
+void currentInit();
+// Every motor tick. Folds in a new IS reading if the sensor cache has one,
+// taken while `appliedPct` duty (magnitude) was on the bridge, and returns
+// the duty ceiling, 0..100 %.
+float currentDutyCeiling(float appliedPct, uint32_t dtUs);
+
+struct CurrentState {
+  float motorA;     // last reading
+  float peakA;      // highest reading over the last 1..2 CURRENT_PEAK_WINDOW_MS
+  float avgA;       // CURRENT_AVG_TAU_MS average
+  float limitA;     // limit now, after derating
+  float ceilingPct; // duty ceiling
+  float heatPct;    // I²t state, 100 = steady state at CURRENT_CONT_A
+  bool limiting;    // ceiling below 100 %
+};
+
+struct CurrentStats {
+  uint32_t samples;
+  uint32_t cuts;    // readings over the limit
+  float maxA;       // highest reading since init
+};
+
+CurrentState currentGetState();
+CurrentStats currentGetStats();
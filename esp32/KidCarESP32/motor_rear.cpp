@@ -1,84 +1,178 @@
 #include "motor_rear.h"
+#include "motion_profile.h"
 #include "pins.h"
 #include "config.h"
-#include <Arduino.h>
+#include "hal.h"
+#include "profiler.h"
+#include "speed_ctl.h"
+#include "motor_current.h"
 
-static uint16_t gRearRampMs = REAR_RAMP_MS;
+static MotionLimits gLimits[REAR_MODE_COUNT] = {
+  {REAR_MANUAL_ACCEL_PCT_S, REAR_MANUAL_DECEL_PCT_S, REAR_EDECEL_PCT_S, REAR_MANUAL_JERK_PCT_S2, REAR_COAST_MS},
+  {100000.0f / REAR_RAMP_MS, REAR_REMOTE_DECEL_PCT_S, REAR_EDECEL_PCT_S, REAR_REMOTE_JERK_PCT_S2, REAR_COAST_MS},
+};
+static RearDriveMode gMode = REAR_MODE_MANUAL;
+static MotionState gProfile = {0.0f, 0.0f, 0, 0xFFFFFFFFu};
+static int gRearDutyOut = 0;
+static float gPowerMaxPct = 100.0f;
+static float gAccelScale = 1.0f;
 
-static int toDuty(int pct) {
-  if (pct < 0) pct = -pct;
-  if (pct > 100) pct = 100;
-  int maxDuty = (1 << PWM_RES) - 1;
-  return map(pct, 0, 100, 0, maxDuty);
+void rearSetMode(RearDriveMode mode) {
+  if (mode < REAR_MODE_COUNT) gMode = mode;
 }
 
 void rearSetRampMs(uint16_t rampMs) {
   if (rampMs < 100) rampMs = 100;
   if (rampMs > 5000) rampMs = 5000;
-  gRearRampMs = rampMs;
+  gLimits[REAR_MODE_REMOTE].accelPctPerS = 100000.0f / (float)rampMs;
 }
 
-void rearSetSpeed(int speed) {
-  static float currentDuty = 0.0f;
-  static int currentDir = 0; // -1, 0, 1
-  static uint32_t lastMs = 0;
-
-  const uint32_t now = millis();
-  if (lastMs == 0) lastMs = now;
-  const uint32_t dt = now - lastMs;
-  lastMs = now;
-
-  int targetDir = 0;
-  if (speed > 0) targetDir = 1;
-  else if (speed < 0) targetDir = -1;
-
-  const int minDuty = toDuty(REAR_SOFTSTART_MIN_PCT);
-
-  if (targetDir == 0) {
-    currentDuty = 0.0f;
-    currentDir = 0;
-  } else if (targetDir != currentDir) {
-    // Direction change: stop first, then switch and start from min duty.
-    currentDuty = (float)minDuty;
-    currentDir = targetDir;
-  } else if (currentDir != 0 && currentDuty <= 0.0f) {
-    // Motion start: jump to minimum effective PWM first, then ramp.
-    currentDuty = (float)minDuty;
+void rearSetPowerLimit(float maxDutyPct, float accelScale) {
+  gPowerMaxPct = maxDutyPct < 0.0f ? 0.0f : (maxDutyPct > 100.0f ? 100.0f : maxDutyPct);
+  gAccelScale = accelScale < 0.0f ? 0.0f : (accelScale > 1.0f ? 1.0f : accelScale);
+}
+
+// ===== PWM output =====
+// The profile runs every tick, but the bridge is only touched when its duty
+// changes: ramps go to the LEDC fade engine one segment at a time (the
+// segment's end point is found by running a copy of the profile ahead), and
+// the next segment is queued once the fade-done interrupt has fired. Ramp
+// timing is then set by the hardware, not by when the loop gets to run.
+struct RearChannel {
+  int pin;
+  int channel;
+  uint32_t duty; // last value written, or the end of the running fade
+};
+static RearChannel gOut[2] = {
+  {PIN_BTS_RPWM, CH_BTS_R, 0},
+  {PIN_BTS_LPWM, CH_BTS_L, 0},
+};
+static RearPwmStats gPwmStats = {0, 0, 0};
+static bool gWasEmergency = false;
+
+static uint32_t pctToDuty(float signedPct) {
+  const int maxDuty = (1 << PWM_RES) - 1;
+  const float pct = signedPct < 0.0f ? -signedPct : signedPct;
+  int duty = (int)(pct * (float)maxDuty / 100.0f + 0.5f);
+  if (duty > maxDuty) duty = maxDuty;
+  return (uint32_t)duty;
+}
+
+static void writeNow(RearChannel& out, uint32_t duty) {
+  if (halLedcFading(out.channel)) {
+    halLedcFadeStop(out.channel);
+  } else if (duty == out.duty) {
+    gPwmStats.skipped++;
+    return;
   }
+  halLedcWrite(out.channel, duty);
+  out.duty = duty;
+  gPwmStats.writes++;
+}
 
-  int targetDuty = 0;
-  if (targetDir != 0) {
-    int pct = speed;
-    if (pct < 0) pct = -pct;
-    if (pct < REAR_SOFTSTART_MIN_PCT) pct = REAR_SOFTSTART_MIN_PCT;
-    targetDuty = toDuty(pct);
+static void fadeTo(RearChannel& out, uint32_t duty) {
+  if (duty == out.duty) {
+    gPwmStats.skipped++;
+    return;
   }
+  if (halLedcFade(out.pin, out.channel, out.duty, duty, REAR_FADE_SEGMENT_MS)) {
+    out.duty = duty;
+    gPwmStats.fades++;
+  } else {
+    writeNow(out, duty);
+  }
+}
+
+static void drive(float target, bool emergency, uint32_t dtUs) {
+  PROF_SCOPE(PROF_REAR);
+  // Open loop the profile output is the duty; closed loop it is the speed
+  // setpoint and the PI loop finds the duty (speed_ctl.h). Either way the
+  // current limit (motor_current.h) and the battery derating
+  // (power_derate.h) cap it; the derating also scales the accel limit.
+  const int maxDuty = (1 << PWM_RES) - 1;
+  const float currentPct = currentDutyCeiling((float)gRearDutyOut * 100.0f / (float)maxDuty, dtUs);
+  const float ceiling = gPowerMaxPct < currentPct ? gPowerMaxPct : currentPct;
+  MotionLimits limits = gLimits[gMode];
+  limits.accelPctPerS *= gAccelScale;
+  const float profile = motionStep(gProfile, limits, target, emergency, dtUs);
+  float duty = speedCtlStep(profile, emergency, dtUs, ceiling, currentPct < 100.0f && currentPct <= gPowerMaxPct);
+  const bool limited = duty > ceiling || duty < -ceiling;
+  if (limited) duty = duty < 0.0f ? -ceiling : ceiling;
+  gRearDutyOut = (int)pctToDuty(duty);
+  const int active = duty < 0.0f ? 1 : 0;
+  RearChannel& on = gOut[active];
+  RearChannel& off = gOut[1 - active];
 
-  // dt can be 0 on very fast loops; do not force a minimum step in that case.
-  if (dt > 0) {
-    const int maxDuty = (1 << PWM_RES) - 1;
-    const float step = ((float)maxDuty * (float)dt) / (float)gRearRampMs;
-
-    if (currentDuty < (float)targetDuty) {
-      currentDuty += step;
-      if (currentDuty > (float)targetDuty) currentDuty = (float)targetDuty;
-    } else if (currentDuty > (float)targetDuty) {
-      currentDuty -= step;
-      if (currentDuty < (float)targetDuty) currentDuty = (float)targetDuty;
+  // The idle side is always 0 and never fades.
+  writeNow(off, 0);
+  // An emergency stop cuts into a running segment instead of finishing it.
+  if (emergency && !gWasEmergency) halLedcFadeStop(on.channel);
+  gWasEmergency = emergency;
+
+  // A current or battery cut goes out now, not at the end of a fade segment.
+  if (dtUs == 0 || duty == 0.0f || limited) {
+    writeNow(on, (uint32_t)gRearDutyOut);
+    return;
+  }
+  if (speedCtlClosed()) {
+    // The PI output moves once per segment: fade to it, except in an
+    // emergency stop, which goes out directly.
+    if (emergency) {
+      writeNow(on, (uint32_t)gRearDutyOut);
+    } else if (!halLedcFading(on.channel)) {
+      fadeTo(on, (uint32_t)gRearDutyOut);
     }
+    return;
+  }
+  if (halLedcFading(on.channel)) return;
+  // Settled on the target and already on the bridge: nothing to plan.
+  if (gProfile.rate == 0.0f && (uint32_t)gRearDutyOut == on.duty) return;
+
+  // Where the profile will be one segment from now if the target holds.
+  MotionState ahead = gProfile;
+  const uint32_t steps = ((uint32_t)REAR_FADE_SEGMENT_MS * 1000U) / dtUs;
+  float end = duty;
+  for (uint32_t i = 0; i < steps; i++) {
+    end = motionStep(ahead, limits, target, emergency, dtUs);
+    if (end == 0.0f || (end < 0.0f) != (duty < 0.0f)) break;
   }
+  if ((end < 0.0f) != (duty < 0.0f)) end = 0.0f;
+  fadeTo(on, pctToDuty(end));
+}
 
-  int dutyOut = (int)(currentDuty + 0.5f);
-  if (dutyOut < 0) dutyOut = 0;
+void rearSetSpeed(int speed, uint32_t dtUs) {
+  if (speed > 100) speed = 100;
+  if (speed < -100) speed = -100;
+  drive((float)speed, false, dtUs);
+}
 
-  if (currentDir > 0) {
-    ledcWriteChannel(CH_BTS_R, dutyOut);
-    ledcWriteChannel(CH_BTS_L, 0);
-  } else if (currentDir < 0) {
-    ledcWriteChannel(CH_BTS_R, 0);
-    ledcWriteChannel(CH_BTS_L, dutyOut);
-  } else {
-    ledcWriteChannel(CH_BTS_R, 0);
-    ledcWriteChannel(CH_BTS_L, 0);
+void rearEmergencyStop(uint32_t dtUs) {
+  drive(0.0f, true, dtUs);
+}
+
+void rearCutRegisters() {
+  for (RearChannel& out : gOut) {
+    halLedcFadeStop(out.channel);
+    halLedcWrite(out.channel, 0);
   }
 }
+
+void rearCut() {
+  rearCutRegisters();
+  for (RearChannel& out : gOut) {
+    out.duty = 0;
+    gPwmStats.writes++;
+  }
+  motionReset(gProfile);
+  gRearDutyOut = 0;
+  gWasEmergency = false;
+}
+
+RearPwmStats rearGetPwmStats() {
+  return gPwmStats;
+}
+
+uint8_t rearGetDutyPct() {
+  const int maxDuty = (1 << PWM_RES) - 1;
+  return (uint8_t)((gRearDutyOut * 100 + maxDuty / 2) / maxDuty);
+}
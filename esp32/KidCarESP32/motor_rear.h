@@ -1,7 +1,40 @@
 #pragma once
 #include <Arduino.h>
 
-// Rear motor control
+// Rear motor control. Output is shaped by the motion profile of the active
+// drive mode (motion_profile.h, limits in config.h). With a wheel encoder the
+// shaped value is a speed setpoint closed by speed_ctl.h, else the duty.
+enum RearDriveMode : uint8_t {
+  REAR_MODE_MANUAL = 0, // pedal + selector
+  REAR_MODE_REMOTE,     // app; accel follows accel_ms
+  REAR_MODE_COUNT
+};
+
+void rearSetMode(RearDriveMode mode);
+// Remote-mode accel: time from stop to full duty (app accel_ms).
 void rearSetRampMs(uint16_t rampMs);
-void rearSetSpeed(int speed); // -100..100
+// speed -100..100 (% duty, or % of WHEEL_MAX_MMPS closed loop); dtUs is the time since the previous call (the caller's
+// fixed tick), used to advance the profile. dtUs == 0 only re-applies.
+void rearSetSpeed(int speed, uint32_t dtUs);
+// Brakes to zero at the emergency-decel limit, ignoring jerk shaping.
+void rearEmergencyStop(uint32_t dtUs);
+// E-stop: both bridge sides to 0 at once, running fades stopped. Register
+// writes only, safe from any task; the control task follows up with rearCut.
+void rearCutRegisters();
+// rearCutRegisters plus a profile reset, so the next command starts from a
+// standstill. Control task only.
+void rearCut();
+// Battery derating (power_derate.h): duty ceiling in % and a 0..1 factor on
+// the accel limit, applied from the next tick until changed.
+void rearSetPowerLimit(float maxDutyPct, float accelScale);
+// Duty currently applied (after the profile), 0..100 %.
+uint8_t rearGetDutyPct();
 
+// Bridge register traffic: direct duty writes, hardware fades started, and
+// updates skipped because the duty was already there.
+struct RearPwmStats {
+  uint32_t writes;
+  uint32_t fades;
+  uint32_t skipped;
+};
+RearPwmStats rearGetPwmStats();
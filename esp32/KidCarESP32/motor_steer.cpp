@@ -1,54 +1,195 @@
 #include "motor_steer.h"
 #include "pins.h"
 #include "config.h"
+#include "hal.h"
 
-static uint32_t steerEndAt = 0;
-static bool steerActive = false;
+enum SteerCmd : uint8_t {
+  STEER_CMD_NONE = 0,
+  STEER_CMD_TARGET,
+  STEER_CMD_TIMED,
+};
 
-static int toDuty(int pct) {
-  if (pct < 0) pct = -pct;
+static const float HALF_TRAVEL_MS = STEER_TRAVEL_MS / 2.0f;
+
+static SteerCmd cmdKind = STEER_CMD_NONE;
+static int targetPct = 0;
+static int8_t timedDir = 0;
+static bool timedDone = false;
+static uint32_t timedStartMs = 0;
+static uint32_t timedEndMs = 0;
+
+static float posMs = 0.0f;            // + right of centre
+static float uncMs = HALF_TRAVEL_MS;  // unknown until the first end stop
+static float pushMs = 0.0f;           // driven while the estimate sat at the end
+static int8_t atEnd = 0;              // end stop found and not left since
+static bool homed = false;
+
+static int8_t applied = 0;
+static int8_t lastDir = 0;            // direction before the last stop
+static uint32_t offSinceMs = 0;
+static uint32_t lastMs = 0;
+static uint8_t pinIn1 = LOW;
+static uint8_t pinIn2 = LOW;
+static SteerStats stats = {0, 0, 0};
+
+static void writePin(int pin, uint8_t level, uint8_t& shadow) {
+  if (level == shadow) return;
+  halDigitalWrite(pin, level);
+  shadow = level;
+  stats.pinWrites++;
+}
+
+// IN1 high = right, IN2 high = left, both low = coast.
+static void applyDrive(int8_t d, uint32_t now) {
+  if (d == applied) return;
+  writePin(PIN_L298_IN1, d > 0 ? HIGH : LOW, pinIn1);
+  writePin(PIN_L298_IN2, d < 0 ? HIGH : LOW, pinIn2);
+  if (d == 0) {
+    lastDir = applied;
+    offSinceMs = now;
+  } else if (d == -atEnd) {
+    atEnd = 0;
+  }
+  applied = d;
+}
+
+// Integrates the drive applied since the last call.
+static void advance(uint32_t now) {
+  const uint32_t dt = now - lastMs;
+  lastMs = now;
+  if (applied == 0 || dt == 0) return;
+  posMs += applied * (float)dt;
+  uncMs += (float)dt * STEER_DRIFT_PCT / 100.0f;
+  if (uncMs > HALF_TRAVEL_MS) uncMs = HALF_TRAVEL_MS;
+  if (posMs > HALF_TRAVEL_MS || posMs < -HALF_TRAVEL_MS) {
+    const float end = applied * HALF_TRAVEL_MS;
+    pushMs += (posMs - end) * applied;
+    posMs = end;
+  } else {
+    pushMs = 0.0f;
+  }
+  if (pushMs >= uncMs + STEER_ENDSTOP_MS) {
+    // Pushed further than the estimate can be off: on the stop.
+    posMs = applied * HALF_TRAVEL_MS;
+    uncMs = 0.0f;
+    pushMs = 0.0f;
+    atEnd = applied;
+    homed = true;
+    stats.endStops++;
+  }
+}
+
+static float targetMs(int pct) {
+  return pct * HALF_TRAVEL_MS / 100.0f;
+}
+
+static int8_t wantedDrive(uint32_t now) {
+  int8_t want = 0;
+  if (cmdKind == STEER_CMD_TIMED) {
+    if (!timedDone && (int32_t)(now - timedEndMs) >= 0) {
+      if (STEER_MAX_MS > 0 && now - timedStartMs >= STEER_MAX_MS) stats.holdCutoffs++;
+      timedDone = true;
+    }
+    if (!timedDone) want = timedDir;
+  } else if (cmdKind == STEER_CMD_TARGET) {
+    if (targetPct >= 100) {
+      want = 1;
+    } else if (targetPct <= -100) {
+      want = -1;
+    } else {
+      const float err = targetMs(targetPct) - posMs;
+      if (applied != 0 && err * applied > 0.0f) {
+        want = applied; // keep going until the target is passed
+      } else if (err > STEER_DEADBAND_MS) {
+        want = 1;
+      } else if (err < -(float)STEER_DEADBAND_MS) {
+        want = -1;
+      }
+    }
+  }
+  if (want != 0 && want == atEnd) want = 0; // already on that stop
+  return want;
+}
+
+void steerTarget(int pct) {
   if (pct > 100) pct = 100;
-  int maxDuty = (1 << PWM_RES) - 1;
-  return map(pct, 0, 100, 0, maxDuty);
+  if (pct < -100) pct = -100;
+  cmdKind = STEER_CMD_TARGET;
+  targetPct = pct;
 }
 
 void steerStart(int direction, uint16_t durationMs) {
   if (STEER_MAX_MS > 0 && durationMs > STEER_MAX_MS) durationMs = STEER_MAX_MS;
-  if (durationMs == 0) {
+  const int8_t dir = (direction > 0) ? 1 : (direction < 0 ? -1 : 0);
+  if (dir == 0 || durationMs == 0) {
     steerStop();
     return;
   }
-  if (direction == 0) {
-    steerStop();
-    return;
+  const uint32_t now = halMillis();
+  if (cmdKind != STEER_CMD_TIMED || dir != timedDir) {
+    cmdKind = STEER_CMD_TIMED;
+    timedDir = dir;
+    timedDone = false;
+    timedStartMs = now;
   }
+  // A hold extends the pulse, measured from the start of the hold.
+  uint32_t end = now + durationMs;
+  if (STEER_MAX_MS > 0 && end - timedStartMs > STEER_MAX_MS) end = timedStartMs + STEER_MAX_MS;
+  timedEndMs = end;
+}
 
-  const int dir = (direction > 0) ? 1 : (direction < 0 ? -1 : 0);
-  if (dir == 0) {
-    steerStop();
-    return;
-  }
+void steerStop() {
+  const uint32_t now = halMillis();
+  advance(now);
+  cmdKind = STEER_CMD_NONE;
+  applyDrive(0, now);
+}
 
-  if (dir > 0) {
-    digitalWrite(PIN_L298_IN1, HIGH);
-    digitalWrite(PIN_L298_IN2, LOW);
-  } else {
-    digitalWrite(PIN_L298_IN1, LOW);
-    digitalWrite(PIN_L298_IN2, HIGH);
+void steerLoop() {
+  const uint32_t now = halMillis();
+  advance(now);
+  int8_t want = wantedDrive(now);
+  if (want != 0 && applied == -want) {
+    want = 0; // reversing: coast first
+  } else if (want != 0 && applied == 0 && lastDir == -want && now - offSinceMs < STEER_REVERSE_DWELL_MS) {
+    want = 0;
   }
+  applyDrive(want, now);
+}
 
-  steerEndAt = millis() + durationMs;
-  steerActive = true;
+bool steerNeedsMove(int pct) {
+  if (applied != 0) return true;
+  if (pct >= 100) return atEnd != 1;
+  if (pct <= -100) return atEnd != -1;
+  const float err = targetMs(pct) - posMs;
+  return err > STEER_DEADBAND_MS || err < -(float)STEER_DEADBAND_MS;
 }
 
-void steerStop() {
-  digitalWrite(PIN_L298_IN1, LOW);
-  digitalWrite(PIN_L298_IN2, LOW);
-  steerActive = false;
+void steerReset() {
+  halDigitalWrite(PIN_L298_IN1, LOW);
+  halDigitalWrite(PIN_L298_IN2, LOW);
+  pinIn1 = LOW;
+  pinIn2 = LOW;
+  applied = 0;
+  lastDir = 0;
+  cmdKind = STEER_CMD_NONE;
+  targetPct = 0;
+  timedDir = 0;
+  timedDone = false;
+  posMs = 0.0f;
+  uncMs = HALF_TRAVEL_MS;
+  pushMs = 0.0f;
+  atEnd = 0;
+  homed = false;
+  lastMs = halMillis();
+  offSinceMs = lastMs;
+  stats = SteerStats{0, 0, 0};
 }
 
-void steerLoop() {
-  if (STEER_MAX_MS > 0 && steerActive && millis() >= steerEndAt) {
-    steerStop();
-  }
+SteerState steerGetState() {
+  return SteerState{posMs * 100.0f / HALF_TRAVEL_MS, uncMs * 100.0f / HALF_TRAVEL_MS, applied, homed};
+}
+
+SteerStats steerGetStats() {
+  return stats;
 }
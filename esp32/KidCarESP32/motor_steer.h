@@ -1,6 +1,42 @@
 #pragma once
 #include <Arduino.h>
 
+// Steering motor (L298N, ENA jumpered: full speed or off). The rack has no
+// position sensor: its position is dead-reckoned from motor run time, with
+// an uncertainty that grows with every move. Driving on past the estimated
+// end for longer than that uncertainty means the rack is on its end stop;
+// the estimate is re-zeroed there and the motor is switched off instead of
+// stalling. Until the first end stop the rack is assumed to start centred.
+// Direction pins are written only when the drive changes.
+
+// Absolute target, -100 full left .. 100 full right, 0 centre. A target at
+// full lock drives to the end stop and stops there.
+void steerTarget(int pct);
+// Timed pulse (older app builds): runs `direction` for durationMs. Calls
+// repeated during a hold extend it, but never past STEER_MAX_MS from the
+// start of the hold; after that it stays off until steerStop.
 void steerStart(int direction, uint16_t durationMs);
+// Motor off now, command dropped; the position estimate is kept.
 void steerStop();
+// Advances the estimate and applies the drive. Every control tick.
 void steerLoop();
+// True while steerTarget(pct) still has to move the rack.
+bool steerNeedsMove(int pct);
+// Pins off, estimate back to "centred, not homed", stats cleared.
+void steerReset();
+
+struct SteerState {
+  float positionPct;    // estimate, -100..100
+  float uncertaintyPct; // +/- around the estimate
+  int8_t drive;         // -1 left, 0 off, 1 right, as on the pins
+  bool homed;           // an end stop was found since reset
+};
+
+struct SteerStats {
+  uint32_t pinWrites;
+  uint32_t endStops;     // end stops found (estimate re-zeroed)
+  uint32_t holdCutoffs;  // timed holds stopped by STEER_MAX_MS
+};
+
+SteerState steerGetState();
+SteerStats steerGetStats();
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// ===== Multi-producer/single-consumer ring =====
+// Bounded, lock-free (Vyukov's sequenced cells): any number of tasks may
+// push, each claiming a cell with one CAS; exactly one task may pop. push
+// fails instead of waiting when the ring is full. N must be a power of two.
+
+template <typename T, uint32_t N>
+class MpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "MpscQueue capacity must be a power of two");
+
+public:
+  MpscQueue() {
+    for (uint32_t i = 0; i < N; i++) cells_[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  // Any task. `fill` writes the value in place once a cell is claimed.
+  template <typename Fill>
+  bool emplace(Fill fill) {
+    uint32_t pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& c = cells_[pos & (N - 1)];
+      const uint32_t seq = c.seq.load(std::memory_order_acquire);
+      const int32_t diff = (int32_t)(seq - pos);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          fill(c.value);
+          c.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool push(const T& value) {
+    return emplace([&](T& slot) { slot = value; });
+  }
+
+  // Consumer side. Also false while the oldest claimed cell is still being
+  // filled; the next pop picks it up.
+  bool pop(T& out) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    Cell& c = cells_[tail & (N - 1)];
+    if (c.seq.load(std::memory_order_acquire) != tail + 1) return false;
+    out = c.value;
+    c.seq.store(tail + N, std::memory_order_release);
+    tail_.store(tail + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Approximate; claimed cells count even before they are filled.
+  uint32_t size() const {
+    return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+  }
+
+  static constexpr uint32_t capacity() { return N; }
+
+private:
+  struct Cell {
+    std::atomic<uint32_t> seq;
+    T value;
+  };
+  Cell cells_[N];
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0}; // written by the consumer only
+};
@@ -0,0 +1,28 @@
+#include "net_queue.h"
+#include "spsc_queue.h"
+
+static SpscQueue<NetMsg, 16> queue;
+static std::atomic<uint32_t> dropped{0};
+static std::atomic<bool> otaActive{false};
+
+bool netQueuePush(const NetMsg& msg) {
+  if (queue.push(msg)) return true;
+  dropped.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+bool netQueuePop(NetMsg& out) {
+  return queue.pop(out);
+}
+
+uint32_t netQueueDropped() {
+  return dropped.load(std::memory_order_relaxed);
+}
+
+void netSetOtaActive(bool active) {
+  otaActive.store(active, std::memory_order_release);
+}
+
+bool netOtaActive() {
+  return otaActive.load(std::memory_order_acquire);
+}
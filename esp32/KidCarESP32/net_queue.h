@@ -0,0 +1,25 @@
+#pragma once
+#include "protocol.h"
+
+// ===== Network -> control hand-off =====
+// The network side (wifiApLoop, possibly on its own task) pushes; controlLoop
+// pops. Nothing else crosses between the two.
+
+enum NetMsgKind : uint8_t {
+  NET_MSG_ACTIVITY,  // datagram received, nothing accepted: LED only, not the link watchdog
+  NET_MSG_COMMAND,   // accepted command, newest in its burst
+};
+
+struct NetMsg {
+  NetMsgKind kind;
+  ControlCommand cmd;
+};
+
+bool netQueuePush(const NetMsg& msg);
+bool netQueuePop(NetMsg& out);
+uint32_t netQueueDropped(); // pushes that found the ring full
+
+// Firmware upload in progress. A flag rather than a message so it can never
+// be lost to a full ring; controlLoop holds all outputs off while it is set.
+void netSetOtaActive(bool active);
+bool netOtaActive();
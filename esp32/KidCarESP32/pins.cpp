@@ -1,5 +1,6 @@
 #include "pins.h"
 #include "config.h"
+#include "hal.h"
 #include <Arduino.h>
 #include <esp32-hal-ledc.h>
 
@@ -23,16 +24,20 @@ void setupPins() {
   pinMode(PIN_MANUAL_BACK, INPUT_PULLUP);
   pinMode(PIN_MANUAL_THROTTLE, INPUT);
   pinMode(PIN_BATTERY_FB, INPUT);
+  pinMode(PIN_BTS_IS, INPUT);
 
   analogReadResolution(12);
   analogSetPinAttenuation(PIN_MANUAL_THROTTLE, ADC_11db);
   analogSetPinAttenuation(PIN_BATTERY_FB, ADC_11db);
+  analogSetPinAttenuation(PIN_BTS_IS, ADC_11db);
 
   digitalWrite(PIN_RELAY_EN, LOW);
   digitalWrite(PIN_BTS_REN, HIGH);
   digitalWrite(PIN_BTS_LEN, HIGH);
   digitalWrite(PIN_L298_IN1, LOW);
   digitalWrite(PIN_L298_IN2, LOW);
+
+  if (WHEEL_ENCODER_FITTED) halPcntBegin(PIN_WHEEL_ENC);
 }
 
 void setupPwm() {
@@ -8,6 +8,7 @@ static const int PIN_BTS_RPWM = 4;  // PWM
 static const int PIN_BTS_LPWM = 5;  // PWM
 static const int PIN_BTS_REN  = 17; // Enable
 static const int PIN_BTS_LEN  = 18; // Enable
+static const int PIN_BTS_IS   = 7;  // ADC: R_IS and L_IS tied, CURRENT_SENSE_R_OHM to GND
 
 // Main power relay (enable)
 static const int PIN_RELAY_EN = 16; // HIGH = enable
@@ -17,12 +18,17 @@ static const int PIN_L298_ENA = 21; // Enable (kept HIGH)
 static const int PIN_L298_IN1 = 10; // Dir
 static const int PIN_L298_IN2 = 11; // Dir
 
+// Wheel encoder (optional, see WHEEL_ENCODER_FITTED): hall/optical pulses
+static const int PIN_WHEEL_ENC = 6;  // PCNT input, pulled up
+
 
 // Manual selector + battery feedback inputs
 static const int PIN_BATTERY_FB = 1;   // ADC, divider 100k/22k
 static const int PIN_MANUAL_FWD = 14;  // Active LOW (pull-up to 3.3V)
 static const int PIN_MANUAL_BACK = 13; // Active LOW (pull-up to 3.3V)
 static const int PIN_MANUAL_THROTTLE = 12; // ADC direct: 3.0V idle, 1.0/0.5/0.0V gears
+// GPIO12 is ADC2, which continuous mode cannot stream; moving the pedal to a
+// free ADC1 pin (GPIO2..10) puts it on the DMA path as well.
 // LEDC channels
 static const int CH_BTS_R = 0;
 static const int CH_BTS_L = 1;
@@ -0,0 +1,95 @@
+#include "power_derate.h"
+#include "config.h"
+
+static const uint8_t DERATE_POINTS = sizeof(DERATE_CURVE_V) / sizeof(DERATE_CURVE_V[0]);
+static_assert(sizeof(DERATE_CURVE_DUTY_PCT) == DERATE_POINTS, "DERATE_CURVE_DUTY_PCT needs one entry per voltage");
+static_assert(sizeof(DERATE_CURVE_ACCEL_PCT) == DERATE_POINTS, "DERATE_CURVE_ACCEL_PCT needs one entry per voltage");
+static_assert(DERATE_POINTS >= 1, "derate curve is empty");
+
+static DerateConfig cfg = {nullptr, nullptr, nullptr, 0, 0.0f, 0.0f, 0, 0.0f, 0.0f};
+static float filteredV = 0.0f;
+static float slopeVps = 0.0f;
+static float projectedV = 0.0f;
+static float maxDuty = 100.0f;
+static float accel = 100.0f;
+static bool active = false;
+static uint32_t activeUs = 0;
+static DerateStats stats = {0, 0, 0.0f};
+
+DerateConfig derateDefaultConfig() {
+  return DerateConfig{DERATE_CURVE_V, DERATE_CURVE_DUTY_PCT, DERATE_CURVE_ACCEL_PCT, DERATE_POINTS,
+                      DERATE_FILTER_TAU_MS, DERATE_SLOPE_TAU_MS, DERATE_LOOKAHEAD_MS,
+                      DERATE_FALL_PCT_S, DERATE_RISE_PCT_S};
+}
+
+static float blend(float tauMs, float dtS) {
+  if (tauMs <= 0.0f) return 1.0f;
+  const float k = dtS * 1000.0f / tauMs;
+  return k > 1.0f ? 1.0f : k;
+}
+
+// Curve lookup at `v` for the duty (`accelOut` false) or accel column.
+static float lookup(float v, bool accelOut) {
+  const uint8_t* col = accelOut ? cfg.curveAccelPct : cfg.curveDutyPct;
+  if (cfg.points == 0) return 100.0f;
+  if (v <= cfg.curveV[0]) return col[0];
+  const uint8_t last = cfg.points - 1;
+  if (v >= cfg.curveV[last]) return col[last];
+  uint8_t i = 1;
+  while (v > cfg.curveV[i]) i++;
+  const float f = (v - cfg.curveV[i - 1]) / (cfg.curveV[i] - cfg.curveV[i - 1]);
+  return (float)col[i - 1] + ((float)col[i] - (float)col[i - 1]) * f;
+}
+
+static float follow(float now, float target, float dtS) {
+  if (target < now) {
+    const float next = now - cfg.fallPctPerS * dtS;
+    return next < target ? target : next;
+  }
+  const float next = now + cfg.risePctPerS * dtS;
+  return next > target ? target : next;
+}
+
+void derateReset(const DerateConfig& config, float packV) {
+  cfg = config;
+  filteredV = packV;
+  slopeVps = 0.0f;
+  projectedV = packV;
+  maxDuty = lookup(packV, false);
+  accel = lookup(packV, true);
+  active = maxDuty < 100.0f || accel < 100.0f;
+  activeUs = 0;
+  stats = DerateStats{active ? 1U : 0U, 0, packV};
+}
+
+DerateLimits derateUpdate(float packV, uint32_t dtUs) {
+  const float dtS = (float)dtUs / 1.0e6f;
+  if (dtUs > 0) {
+    const float prevV = filteredV;
+    filteredV += (packV - filteredV) * blend(cfg.filterTauMs, dtS);
+    slopeVps += ((filteredV - prevV) / dtS - slopeVps) * blend(cfg.slopeTauMs, dtS);
+  }
+  projectedV = filteredV;
+  if (slopeVps < 0.0f) projectedV += slopeVps * (float)cfg.lookaheadMs / 1000.0f;
+  if (filteredV < stats.minV) stats.minV = filteredV;
+
+  maxDuty = follow(maxDuty, lookup(projectedV, false), dtS);
+  accel = follow(accel, lookup(projectedV, true), dtS);
+  const bool now = maxDuty < 100.0f || accel < 100.0f;
+  if (now && !active) stats.events++;
+  active = now;
+  if (active) {
+    activeUs += dtUs;
+    stats.activeMs += activeUs / 1000U;
+    activeUs %= 1000U;
+  }
+  return DerateLimits{maxDuty, accel / 100.0f};
+}
+
+DerateState derateGetState() {
+  return DerateState{filteredV, slopeVps, projectedV, maxDuty, accel, active};
+}
+
+DerateStats derateGetStats() {
+  return stats;
+}
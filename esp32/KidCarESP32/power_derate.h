@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Battery-aware power derating =====
+// A tired or cold pack sags under a full-throttle launch far enough to
+// brown out the ESP supply or drop the relay. This stage watches the pack
+// voltage at the motor rate and caps the rear duty and the accel limit
+// before that happens:
+//   - the pin voltage is low-pass filtered (filterTauMs) and its slope
+//     tracked (slopeTauMs);
+//   - while the voltage is falling it is projected lookaheadMs ahead, so a
+//     launch that is heading for the knee is held back on the way down
+//     rather than after it gets there;
+//   - the projected voltage is looked up in the curve (ascending volts,
+//     linear in between, flat outside) for the duty ceiling and the share
+//     of the mode's accel limit;
+//   - the ceiling follows the curve down at fallPctPerS and back up at
+//     risePctPerS, so a recovering pack does not pump the motors.
+
+struct DerateConfig {
+  const float* curveV;       // ascending
+  const uint8_t* curveDutyPct;
+  const uint8_t* curveAccelPct;
+  uint8_t points;
+  float filterTauMs;
+  float slopeTauMs;
+  uint32_t lookaheadMs;
+  float fallPctPerS;
+  float risePctPerS;
+};
+
+struct DerateLimits {
+  float maxDutyPct;  // 0..100
+  float accelScale;  // 0..1, applied to the accel limit
+};
+
+struct DerateState {
+  float filteredV;
+  float slopeVps;    // V/s, negative while sagging
+  float projectedV;  // what the curve is looked up at
+  float maxDutyPct;
+  float accelPct;
+  bool active;       // either limit below 100 %
+};
+
+struct DerateStats {
+  uint32_t events;   // inactive -> active transitions
+  uint32_t activeMs;
+  float minV;        // lowest filtered voltage since reset
+};
+
+// Curve and filters from config.h.
+DerateConfig derateDefaultConfig();
+// Starts the filter at `packV` with no slope and the limits the curve gives
+// for it, so a flat pack is held back from the first tick.
+void derateReset(const DerateConfig& cfg, float packV);
+// Every motor tick with the pack voltage under load.
+DerateLimits derateUpdate(float packV, uint32_t dtUs);
+DerateState derateGetState();
+DerateStats derateGetStats();
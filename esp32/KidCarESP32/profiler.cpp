@@ -0,0 +1,73 @@
+#include "profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static ProfStats stats[PROF_SECTION_COUNT];
+
+static const char* const kNames[PROF_SECTION_COUNT] = {
+  "loop", "adc", "rear", "led", "ota", "udp_rx", "parse", "status", "udp_tx", "serial",
+};
+
+void profRecord(ProfSection s, uint32_t cycles) {
+  ProfStats& st = stats[s];
+  if (st.count == 0 || cycles < st.minCycles) st.minCycles = cycles;
+  if (cycles > st.maxCycles) st.maxCycles = cycles;
+  st.sumCycles += cycles;
+  st.hist[profBucket(cycles)]++;
+  st.count++;
+}
+
+const ProfStats& profStats(ProfSection s) {
+  return stats[s];
+}
+
+const char* profName(ProfSection s) {
+  return s < PROF_SECTION_COUNT ? kNames[s] : "?";
+}
+
+uint32_t profPercentileCycles(ProfSection s, uint8_t pct) {
+  const ProfStats& st = stats[s];
+  if (st.count == 0) return 0;
+  // Smallest bucket with at least pct% of the samples at or below it.
+  const uint64_t want = ((uint64_t)st.count * pct + 99) / 100;
+  uint64_t seen = 0;
+  for (uint8_t b = 0; b < PROF_BUCKETS; b++) {
+    seen += st.hist[b];
+    if (seen >= want) return b == PROF_BUCKETS - 1 ? st.maxCycles : 1UL << b;
+  }
+  return st.maxCycles;
+}
+
+void profReset() {
+  memset(stats, 0, sizeof(stats));
+}
+
+size_t profFormat(char* out, size_t cap) {
+  if (cap == 0) return 0;
+  out[0] = 0;
+  const float perUs = (float)halCyclesPerUs();
+  size_t n = 0;
+  char line[256];
+  for (uint8_t i = 0; i < PROF_SECTION_COUNT; i++) {
+    const ProfSection s = (ProfSection)i;
+    const ProfStats st = stats[s];
+    if (st.count == 0) continue;
+    int w = snprintf(line, sizeof(line), "%-7s n=%lu min=%.1fus avg=%.1fus max=%.1fus p50<%.1fus p99<%.1fus hist(<2^k cyc)",
+                     kNames[s], (unsigned long)st.count, st.minCycles / perUs,
+                     (float)((double)st.sumCycles / st.count) / perUs, st.maxCycles / perUs,
+                     profPercentileCycles(s, 50) / perUs, profPercentileCycles(s, 99) / perUs);
+    for (uint8_t b = 0; b < PROF_BUCKETS && w > 0 && (size_t)w < sizeof(line); b++) {
+      if (!st.hist[b]) continue;
+      w += snprintf(line + w, sizeof(line) - w, " %u:%lu", (unsigned)b, (unsigned long)st.hist[b]);
+    }
+    if (w <= 0) continue;
+    if ((size_t)w >= sizeof(line)) w = sizeof(line) - 1;
+    if (n + (size_t)w + 2 > cap) break;
+    memcpy(out + n, line, (size_t)w);
+    n += (size_t)w;
+    out[n++] = '\n';
+    out[n] = 0;
+  }
+  return n;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "hal.h"
+
+// ===== Loop profiler =====
+// PROF_SCOPE(section) times the rest of the enclosing block in CPU cycles
+// and folds it into that section's count, min, max, sum and a log2
+// histogram. Each section is recorded by one task only (the control loop or
+// the network task, both pinned), so recording takes no lock; a report or
+// reset from another task may catch one section half-updated, which is fine
+// for diagnostics.
+
+enum ProfSection : uint8_t {
+  // Control loop (loop task)
+  PROF_LOOP = 0,  // whole controlLoop pass
+  PROF_ADC,       // sensor cache poll
+  PROF_REAR,      // rear motor update
+  PROF_LED,       // status LED
+  // Network task
+  PROF_OTA,       // ArduinoOTA.handle
+  PROF_UDP_RX,    // parsePacket + read
+  PROF_PARSE,     // JSON / binary command decode
+  PROF_STATUS,    // status frame / JSON formatting
+  PROF_UDP_TX,    // status reply send
+  // Log task
+  PROF_SERIAL,    // one formatted line to the UART
+  PROF_SECTION_COUNT,
+};
+
+// Bucket b counts samples below 2^b cycles (and at least 2^(b-1)); the last
+// bucket takes everything longer.
+static const uint8_t PROF_BUCKETS = 24;
+
+struct ProfStats {
+  uint32_t count;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t sumCycles;
+  uint32_t hist[PROF_BUCKETS];
+};
+
+void profRecord(ProfSection s, uint32_t cycles);
+const ProfStats& profStats(ProfSection s);
+const char* profName(ProfSection s);
+// Upper bound (cycles) of the bucket holding the pct-th percentile, 0 if the
+// section has no samples.
+uint32_t profPercentileCycles(ProfSection s, uint8_t pct);
+void profReset();
+
+// Text report, one line per section that has samples:
+//   rear     n=1000 min=1.2us avg=2.0us max=15.3us p50<2.1us p99<4.3us hist(<2^k cyc) 9:10 10:900 11:90
+// Only whole lines are written. Returns the length (excluding NUL).
+size_t profFormat(char* out, size_t cap);
+
+inline uint8_t profBucket(uint32_t cycles) {
+  if (cycles == 0) return 0;
+  const uint8_t b = (uint8_t)(32 - __builtin_clz(cycles));
+  return b < PROF_BUCKETS ? b : PROF_BUCKETS - 1;
+}
+
+class ProfScope {
+public:
+  explicit ProfScope(ProfSection s) : section_(s), start_(halCycles()) {}
+  ~ProfScope() { profRecord(section_, halCycles() - start_); }
+  ProfScope(const ProfScope&) = delete;
+  ProfScope& operator=(const ProfScope&) = delete;
+
+private:
+  ProfSection section_;
+  uint32_t start_;
+};
+
+#define PROF_CONCAT_(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT_(a, b)
+#if PROFILE_ENABLED
+#define PROF_SCOPE(section) ProfScope PROF_CONCAT(profScope_, __LINE__)(section)
+#else
+#define PROF_SCOPE(section) ((void)0)
+#endif
@@ -1,33 +1,59 @@
 #include "protocol.h"
 #include "config.h"
-#include <ArduinoJson.h>
 #include <string.h>
 
-bool protocolParse(const char* msg, ControlCommand& out) {
-  StaticJsonDocument<256> doc;
-  DeserializationError err = deserializeJson(doc, msg);
-  if (err) return false;
-
-  out.throttle = doc["throttle"] | 0;
-  out.steer = doc["steer"] | 0;
-  out.steerMs = doc["steer_ms"] | STEER_MAX_MS;
-  out.speed = doc["speed"] | 0;
-  out.accelMs = doc["accel_ms"] | REAR_RAMP_MS;
-  out.manualMode = doc["manual"] | false;
-  out.park = doc["park"] | false;
-  out.reverseSpeed = doc["reverse_speed"] | 50;
-
-  if (doc["mode"].is<const char*>()) {
-    const char* mode = doc["mode"];
-    if (mode != nullptr) {
-      if (strcmp(mode, "manual") == 0 || strcmp(mode, "MANUAL") == 0) {
-        out.manualMode = true;
-      } else if (strcmp(mode, "remote") == 0 || strcmp(mode, "REMOTE") == 0) {
-        out.manualMode = false;
-      }
+struct Crc8Table {
+  uint8_t v[256];
+};
+
+static constexpr Crc8Table makeCrc8Table() {
+  Crc8Table t = {};
+  for (int i = 0; i < 256; i++) {
+    uint8_t crc = (uint8_t)i;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
     }
+    t.v[i] = crc;
+  }
+  return t;
+}
+
+static constexpr Crc8Table kCrc8 = makeCrc8Table();
+
+uint8_t protocolCrc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < len; i++) {
+    crc = kCrc8.v[crc ^ data[i]];
   }
+  return crc;
+}
+
+bool protocolDecodeEstop(const uint8_t* data, size_t len, uint8_t& action) {
+  if (len != ESTOP_FRAME_LEN || data[0] != ESTOP_FRAME_MAGIC) return false;
+  if (data[1] != ESTOP_FRAME_VERSION) return false;
+  if (protocolCrc8(data, len - 1) != data[len - 1]) return false;
+  if (data[2] != ESTOP_ACTION_STOP && data[2] != ESTOP_ACTION_RELEASE) return false;
+  action = data[2];
+  return true;
+}
+
+size_t protocolEncodeEstop(uint8_t action, uint8_t* out, size_t cap) {
+  if (cap < ESTOP_FRAME_LEN) return 0;
+  out[0] = ESTOP_FRAME_MAGIC;
+  out[1] = ESTOP_FRAME_VERSION;
+  out[2] = action;
+  out[3] = protocolCrc8(out, ESTOP_FRAME_LEN - 1);
+  return ESTOP_FRAME_LEN;
+}
+
+DiagQuery protocolParseDiag(const uint8_t* data, size_t len) {
+  while (len > 0 && (data[len - 1] == '\n' || data[len - 1] == '\r')) len--;
+  if (len == 4 && memcmp(data, "prof", 4) == 0) return DIAG_PROF;
+  if (len == 10 && memcmp(data, "prof reset", 10) == 0) return DIAG_PROF_RESET;
+  return DIAG_NONE;
+}
 
+static void clampCommand(ControlCommand& out) {
   if (out.throttle > 100) out.throttle = 100;
   if (out.throttle < -100) out.throttle = -100;
   if (out.steer > 100) out.steer = 100;
@@ -39,6 +65,558 @@ bool protocolParse(const char* msg, ControlCommand& out) {
   if (out.accelMs < 100) out.accelMs = 100;
   if (out.accelMs > 5000) out.accelMs = 5000;
   if (out.reverseSpeed > 100) out.reverseSpeed = 100;
+}
+
+// ===== JSON control packet =====
+// Single-pass tokenizer for the fixed control-key set. It walks the NUL-
+// terminated text in place: no document, no string copies, fields are clamped
+// as they are read. Keys are matched by an FNV-1a hash computed while
+// scanning and compared against compile-time constants, so unknown keys (new
+// app fields) cost one scan plus a value skip. Values of the wrong type
+// (floats, strings for numbers, etc.) leave the default in place.
+
+static constexpr uint32_t keyHash(const char* s, size_t n) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < n; i++) {
+    h = (h ^ (uint8_t)s[i]) * 16777619u;
+  }
+  return h;
+}
+
+template <size_t N>
+static constexpr uint32_t keyHash(const char (&s)[N]) {
+  return keyHash(s, N - 1);
+}
+
+enum JsonKey : uint8_t {
+  KEY_UNKNOWN,
+  KEY_THROTTLE,
+  KEY_STEER,
+  KEY_STEER_MS,
+  KEY_SPEED,
+  KEY_ACCEL_MS,
+  KEY_MANUAL,
+  KEY_PARK,
+  KEY_REVERSE_SPEED,
+  KEY_MODE,
+  KEY_BIN_STATUS,
+  KEY_SEQ,
+  KEY_SENT_MS,
+  KEY_STEER_POS,
+};
+
+template <size_t N>
+static inline bool keyIs(const char* s, size_t n, const char (&name)[N]) {
+  return n == N - 1 && memcmp(s, name, N - 1) == 0;
+}
+
+static JsonKey lookupKey(const char* s, size_t n, uint32_t h) {
+  switch (h) {
+    case keyHash("throttle"): return keyIs(s, n, "throttle") ? KEY_THROTTLE : KEY_UNKNOWN;
+    case keyHash("steer"): return keyIs(s, n, "steer") ? KEY_STEER : KEY_UNKNOWN;
+    case keyHash("steer_ms"): return keyIs(s, n, "steer_ms") ? KEY_STEER_MS : KEY_UNKNOWN;
+    case keyHash("speed"): return keyIs(s, n, "speed") ? KEY_SPEED : KEY_UNKNOWN;
+    case keyHash("accel_ms"): return keyIs(s, n, "accel_ms") ? KEY_ACCEL_MS : KEY_UNKNOWN;
+    case keyHash("manual"): return keyIs(s, n, "manual") ? KEY_MANUAL : KEY_UNKNOWN;
+    case keyHash("park"): return keyIs(s, n, "park") ? KEY_PARK : KEY_UNKNOWN;
+    case keyHash("reverse_speed"): return keyIs(s, n, "reverse_speed") ? KEY_REVERSE_SPEED : KEY_UNKNOWN;
+    case keyHash("mode"): return keyIs(s, n, "mode") ? KEY_MODE : KEY_UNKNOWN;
+    case keyHash("bin_status"): return keyIs(s, n, "bin_status") ? KEY_BIN_STATUS : KEY_UNKNOWN;
+    case keyHash("seq"): return keyIs(s, n, "seq") ? KEY_SEQ : KEY_UNKNOWN;
+    case keyHash("sent_ms"): return keyIs(s, n, "sent_ms") ? KEY_SENT_MS : KEY_UNKNOWN;
+    case keyHash("steer_pos"): return keyIs(s, n, "steer_pos") ? KEY_STEER_POS : KEY_UNKNOWN;
+    default: return KEY_UNKNOWN;
+  }
+}
+
+static const uint8_t JSON_MAX_DEPTH = 10;
 
+static inline const char* skipWs(const char* p) {
+  while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+  return p;
+}
+
+static inline bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static inline int clampInt(int v, int lo, int hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// p points at the opening quote. Returns the char after the closing quote,
+// or nullptr if the string is unterminated. Hash covers the raw bytes.
+static const char* scanString(const char* p, const char** start, size_t* len, uint32_t* hash) {
+  p++;
+  const char* s = p;
+  uint32_t h = 2166136261u;
+  for (;;) {
+    const char c = *p;
+    if (c == '\0') return nullptr;
+    if (c == '"') break;
+    if (c == '\\') {
+      h = (h ^ (uint8_t)c) * 16777619u;
+      p++;
+      if (*p == '\0') return nullptr;
+    }
+    h = (h ^ (uint8_t)*p) * 16777619u;
+    p++;
+  }
+  *start = s;
+  *len = (size_t)(p - s);
+  *hash = h;
+  return p + 1;
+}
+
+// Parses a JSON number into sign + magnitude (saturating at UINT32_MAX).
+// Numbers with a fraction or exponent are consumed and reported as
+// non-integer; their magnitude is the value truncated toward zero, as
+// ArduinoJson converted them (50.5 -> 50, 5e1 -> 50).
+static uint32_t mul10Add(uint32_t v, uint32_t d) {
+  return (v > (0xFFFFFFFFu - d) / 10u) ? 0xFFFFFFFFu : v * 10u + d;
+}
+
+static const char* scanNumber(const char* p, uint32_t* mag, bool* neg, bool* isInt) {
+  *neg = false;
+  if (*p == '-') {
+    *neg = true;
+    p++;
+  }
+  if (!isDigit(*p)) return nullptr;
+  uint32_t v = 0;
+  while (isDigit(*p)) {
+    v = mul10Add(v, (uint32_t)(*p - '0'));
+    p++;
+  }
+  *isInt = true;
+  const char* frac = p;
+  if (*p == '.') {
+    *isInt = false;
+    p++;
+    frac = p;
+    if (!isDigit(*p)) return nullptr;
+    while (isDigit(*p)) p++;
+  }
+  const char* fracEnd = p;
+  int exp = 0;
+  if (*p == 'e' || *p == 'E') {
+    *isInt = false;
+    p++;
+    const bool expNeg = (*p == '-');
+    if (*p == '+' || *p == '-') p++;
+    if (!isDigit(*p)) return nullptr;
+    while (isDigit(*p)) {
+      if (exp < 100) exp = exp * 10 + (*p - '0');
+      p++;
+    }
+    if (expNeg) exp = -exp;
+  }
+  // Shift the decimal point: fraction digits move in for a positive
+  // exponent, integer digits drop off for a negative one.
+  for (; exp > 0 && v != 0xFFFFFFFFu; exp--) {
+    v = mul10Add(v, (frac < fracEnd) ? (uint32_t)(*frac++ - '0') : 0u);
+  }
+  for (; exp < 0 && v != 0; exp++) v /= 10u;
+  *mag = v;
+  return p;
+}
+
+static const char* scanLiteral(const char* p, const char* lit, size_t n) {
+  return strncmp(p, lit, n) == 0 ? p + n : nullptr;
+}
+
+// Skips any JSON value; nested containers are walked without being stored.
+static const char* skipValue(const char* p, uint8_t depth) {
+  const char* s;
+  size_t n;
+  uint32_t h;
+  uint32_t mag;
+  bool neg;
+  bool isInt;
+  switch (*p) {
+    case '"': return scanString(p, &s, &n, &h);
+    case 't': return scanLiteral(p, "true", 4);
+    case 'f': return scanLiteral(p, "false", 5);
+    case 'n': return scanLiteral(p, "null", 4);
+    case '{':
+    case '[': {
+      if (depth >= JSON_MAX_DEPTH) return nullptr;
+      const char close = (*p == '{') ? '}' : ']';
+      const bool isObject = (*p == '{');
+      p = skipWs(p + 1);
+      if (*p == close) return p + 1;
+      for (;;) {
+        if (isObject) {
+          if (*p != '"') return nullptr;
+          p = scanString(p, &s, &n, &h);
+          if (p == nullptr) return nullptr;
+          p = skipWs(p);
+          if (*p != ':') return nullptr;
+          p = skipWs(p + 1);
+        }
+        p = skipValue(p, depth + 1);
+        if (p == nullptr) return nullptr;
+        p = skipWs(p);
+        if (*p == ',') {
+          p = skipWs(p + 1);
+          continue;
+        }
+        if (*p == close) return p + 1;
+        return nullptr;
+      }
+    }
+    default:
+      return scanNumber(p, &mag, &neg, &isInt);
+  }
+}
+
+static const char* readInt(const char* p, int lo, int hi, int* out) {
+  if (*p != '-' && !isDigit(*p)) return skipValue(p, 1);
+  uint32_t mag;
+  bool neg;
+  bool isInt;
+  p = scanNumber(p, &mag, &neg, &isInt);
+  if (p != nullptr) {
+    const int v = (mag > 1000000u) ? 1000000 : (int)mag;
+    *out = clampInt(neg ? -v : v, lo, hi);
+  }
+  return p;
+}
+
+// Unsigned 32-bit field (timestamps). Negative or fractional values count as
+// wrong type.
+static const char* readU32(const char* p, uint32_t* out, bool* present) {
+  if (!isDigit(*p)) return skipValue(p, 1);
+  uint32_t mag;
+  bool neg;
+  bool isInt;
+  p = scanNumber(p, &mag, &neg, &isInt);
+  if (p != nullptr && isInt) {
+    *out = mag;
+    *present = true;
+  }
+  return p;
+}
+
+static const char* readBool(const char* p, bool* out) {
+  if (*p == 't') {
+    p = scanLiteral(p, "true", 4);
+    if (p != nullptr) *out = true;
+    return p;
+  }
+  if (*p == 'f') {
+    p = scanLiteral(p, "false", 5);
+    if (p != nullptr) *out = false;
+    return p;
+  }
+  return skipValue(p, 1);
+}
+
+bool protocolParse(const char* msg, ControlCommand& out) {
+  if (msg == nullptr) return false;
+
+  int throttle = 0;
+  int steer = 0;
+  int steerMs = STEER_MAX_MS;
+  int speed = 0;
+  int accelMs = REAR_RAMP_MS;
+  int reverseSpeed = 50;
+  bool manual = false;
+  bool park = false;
+  bool binaryStatus = false;
+  uint32_t seq = 0;
+  bool hasSeq = false;
+  uint32_t sentMs = 0;
+  bool hasSentMs = false;
+  int8_t modeManual = -1; // -1 absent, 0 remote, 1 manual
+  int steerPos = 0;
+  bool steerAbs = false;
+
+  const char* p = skipWs(msg);
+  if (*p != '{') return false;
+  p = skipWs(p + 1);
+  bool done = (*p == '}');
+
+  while (!done) {
+    if (*p != '"') return false;
+    const char* key;
+    size_t keyLen;
+    uint32_t h;
+    p = scanString(p, &key, &keyLen, &h);
+    if (p == nullptr) return false;
+    p = skipWs(p);
+    if (*p != ':') return false;
+    p = skipWs(p + 1);
+
+    switch (lookupKey(key, keyLen, h)) {
+      case KEY_THROTTLE: p = readInt(p, -100, 100, &throttle); break;
+      case KEY_STEER: p = readInt(p, -100, 100, &steer); break;
+      case KEY_STEER_MS: p = readInt(p, 0, STEER_MAX_MS, &steerMs); break;
+      case KEY_SPEED: p = readInt(p, 0, 100, &speed); break;
+      case KEY_ACCEL_MS: p = readInt(p, 100, 5000, &accelMs); break;
+      case KEY_REVERSE_SPEED: p = readInt(p, 0, 100, &reverseSpeed); break;
+      case KEY_MANUAL: p = readBool(p, &manual); break;
+      case KEY_PARK: p = readBool(p, &park); break;
+      case KEY_BIN_STATUS: p = readBool(p, &binaryStatus); break;
+      case KEY_SEQ: p = readU32(p, &seq, &hasSeq); break;
+      case KEY_SENT_MS: p = readU32(p, &sentMs, &hasSentMs); break;
+      case KEY_STEER_POS:
+        if (*p == '-' || isDigit(*p)) steerAbs = true;
+        p = readInt(p, -100, 100, &steerPos);
+        break;
+      case KEY_MODE:
+        if (*p == '"') {
+          const char* v;
+          size_t n;
+          uint32_t vh;
+          p = scanString(p, &v, &n, &vh);
+          if (p != nullptr) {
+            if (keyIs(v, n, "manual") || keyIs(v, n, "MANUAL")) modeManual = 1;
+            else if (keyIs(v, n, "remote") || keyIs(v, n, "REMOTE")) modeManual = 0;
+          }
+        } else {
+          p = skipValue(p, 1);
+        }
+        break;
+      default:
+        p = skipValue(p, 1);
+        break;
+    }
+    if (p == nullptr) return false;
+
+    p = skipWs(p);
+    if (*p == ',') {
+      p = skipWs(p + 1);
+      continue;
+    }
+    if (*p != '}') return false;
+    done = true;
+  }
+
+  out.throttle = throttle;
+  out.steer = steer;
+  out.steerMs = (uint16_t)steerMs;
+  out.speed = speed;
+  out.accelMs = (uint16_t)accelMs;
+  out.manualMode = (modeManual >= 0) ? (modeManual == 1) : manual;
+  out.park = park;
+  out.reverseSpeed = (uint8_t)reverseSpeed;
+  out.binaryStatus = binaryStatus;
+  out.hasSeq = hasSeq;
+  out.seq = (uint16_t)seq;
+  out.hasSentMs = hasSentMs;
+  out.sentMs = hasSentMs ? sentMs : 0;
+  // steer_pos wins over a timed steer in the same packet.
+  out.steerAbs = steerAbs;
+  if (steerAbs) out.steer = steerPos;
+  if (out.steer != 0 && out.steerMs == 0) out.steerMs = STEER_MAX_MS;
+  return true;
+}
+
+// ===== Binary command frame =====
+
+static inline uint16_t readLe16(const uint8_t* p) {
+  return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
+}
+
+static inline void writeLe16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)(v & 0xFF);
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint32_t readLe32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void writeLe32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v & 0xFF);
+  p[1] = (uint8_t)((v >> 8) & 0xFF);
+  p[2] = (uint8_t)((v >> 16) & 0xFF);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+bool protocolDecodeFrame(const uint8_t* data, size_t len, ControlCommand& out) {
+  if (len < CMD_FRAME_V1_LEN || data[0] != CMD_FRAME_MAGIC) return false;
+  const uint8_t version = data[1];
+  if (version == 1) {
+    if (len != CMD_FRAME_V1_LEN) return false;
+  } else if (version == CMD_FRAME_VERSION) {
+    if (len != CMD_FRAME_LEN) return false;
+  } else {
+    return false;
+  }
+  if (protocolCrc8(data, len - 1) != data[len - 1]) return false;
+
+  const uint8_t flags = data[2];
+  out.throttle = (int8_t)data[3];
+  out.steer = (int8_t)data[4];
+  out.speed = data[5];
+  out.reverseSpeed = data[6];
+  out.steerMs = readLe16(&data[7]);
+  out.accelMs = readLe16(&data[9]);
+  out.manualMode = (flags & CMD_FLAG_MANUAL) != 0;
+  out.park = (flags & CMD_FLAG_PARK) != 0;
+  out.binaryStatus = (flags & CMD_FLAG_BIN_STATUS) != 0;
+  out.steerAbs = (flags & CMD_FLAG_STEER_ABS) != 0;
+  out.hasSeq = (version >= 2);
+  out.seq = out.hasSeq ? readLe16(&data[11]) : 0;
+  out.hasSentMs = out.hasSeq;
+  out.sentMs = out.hasSeq ? readLe32(&data[13]) : 0;
+
+  clampCommand(out);
+  return true;
+}
+
+size_t protocolEncodeFrame(const ControlCommand& cmd, uint8_t* out, size_t cap) {
+  if (cap < CMD_FRAME_LEN) return 0;
+  int throttle = cmd.throttle;
+  if (throttle > 100) throttle = 100;
+  if (throttle < -100) throttle = -100;
+  int steer = cmd.steer;
+  if (steer > 100) steer = 100;
+  if (steer < -100) steer = -100;
+  int speed = cmd.speed;
+  if (speed < 0) speed = 0;
+  if (speed > 100) speed = 100;
+
+  out[0] = CMD_FRAME_MAGIC;
+  out[1] = CMD_FRAME_VERSION;
+  out[2] = (uint8_t)((cmd.manualMode ? CMD_FLAG_MANUAL : 0) | (cmd.park ? CMD_FLAG_PARK : 0) |
+                     (cmd.binaryStatus ? CMD_FLAG_BIN_STATUS : 0) | (cmd.steerAbs ? CMD_FLAG_STEER_ABS : 0));
+  out[3] = (uint8_t)(int8_t)throttle;
+  out[4] = (uint8_t)(int8_t)steer;
+  out[5] = (uint8_t)speed;
+  out[6] = cmd.reverseSpeed;
+  writeLe16(&out[7], cmd.steerMs);
+  writeLe16(&out[9], cmd.accelMs);
+  writeLe16(&out[11], cmd.seq);
+  writeLe32(&out[13], cmd.sentMs);
+  out[CMD_FRAME_LEN - 1] = protocolCrc8(out, CMD_FRAME_LEN - 1);
+  return CMD_FRAME_LEN;
+}
+
+// ===== Status reply =====
+
+static inline uint16_t voltsToMv(float v) {
+  if (!(v > 0.0f)) return 0;
+  if (v >= 65.535f) return 65535;
+  return (uint16_t)(v * 1000.0f + 0.5f);
+}
+
+// Same 0..65.535 fixed point.
+static inline uint16_t ampsToMa(float a) {
+  return voltsToMv(a);
+}
+
+static inline uint8_t dirCode(int8_t d) {
+  return d > 0 ? 1 : (d < 0 ? 2 : 0);
+}
+
+static inline int8_t dirFromCode(uint8_t c) {
+  return c == 1 ? 1 : (c == 2 ? -1 : 0);
+}
+
+size_t protocolEncodeStatusFrame(const StatusReport& st, uint8_t* out, size_t cap) {
+  if (cap < STATUS_FRAME_LEN) return 0;
+  out[0] = STATUS_FRAME_MAGIC;
+  out[1] = STATUS_FRAME_VERSION;
+  out[2] = (uint8_t)((st.manualActive ? STATUS_FLAG_MANUAL : 0) |
+                     (st.selectorFwd ? STATUS_FLAG_SEL_FWD : 0) |
+                     (st.selectorBack ? STATUS_FLAG_SEL_BACK : 0) |
+                     (dirCode(st.manualGear) << STATUS_GEAR_SHIFT) |
+                     (dirCode(st.driveDir) << STATUS_DIR_SHIFT) |
+                     (st.currentLimited ? STATUS_FLAG_CURRENT_LIMIT : 0));
+  out[3] = st.driveSpeedPct;
+  out[4] = st.selectorThrottlePct;
+  out[5] = st.clients;
+  writeLe16(&out[6], voltsToMv(st.batteryV));
+  writeLe16(&out[8], voltsToMv(st.selectorThrottleV));
+  writeLe32(&out[10], st.uptimeMs);
+  writeLe16(&out[14], st.rxCoalesced);
+  writeLe16(&out[16], st.rxOutOfOrder);
+  writeLe16(&out[18], st.rxStale);
+  out[20] = st.batterySocPct;
+  writeLe16(&out[21], st.runtimeMin);
+  out[23] = st.ctlMode;
+  out[24] = st.linkStage;
+  writeLe16(&out[25], ampsToMa(st.motorPeakA));
+  writeLe16(&out[27], ampsToMa(st.motorAvgA));
+  out[29] = st.motorHeatPct;
+  out[30] = st.powerLimitPct;
+  writeLe16(&out[31], st.derateEvents);
+  out[STATUS_FRAME_LEN - 1] = protocolCrc8(out, STATUS_FRAME_LEN - 1);
+  return STATUS_FRAME_LEN;
+}
+
+bool protocolDecodeStatusFrame(const uint8_t* data, size_t len, StatusReport& out) {
+  if (len < STATUS_FRAME_V1_LEN) return false;
+  if (data[0] != STATUS_FRAME_MAGIC || data[1] < 1) return false;
+  if (protocolCrc8(data, len - 1) != data[len - 1]) return false;
+
+  const uint8_t flags = data[2];
+  out.manualActive = (flags & STATUS_FLAG_MANUAL) != 0;
+  out.selectorFwd = (flags & STATUS_FLAG_SEL_FWD) != 0;
+  out.selectorBack = (flags & STATUS_FLAG_SEL_BACK) != 0;
+  out.manualGear = dirFromCode((flags >> STATUS_GEAR_SHIFT) & 0x03);
+  out.driveDir = dirFromCode((flags >> STATUS_DIR_SHIFT) & 0x03);
+  out.driveSpeedPct = data[3];
+  out.selectorThrottlePct = data[4];
+  out.clients = data[5];
+  out.batteryV = (float)readLe16(&data[6]) / 1000.0f;
+  out.selectorThrottleV = (float)readLe16(&data[8]) / 1000.0f;
+  out.uptimeMs = readLe32(&data[10]);
+  out.rxCoalesced = (data[1] >= 2 && len >= 17) ? readLe16(&data[14]) : 0;
+  out.rxOutOfOrder = (data[1] >= 3 && len >= 21) ? readLe16(&data[16]) : 0;
+  out.rxStale = (data[1] >= 3 && len >= 21) ? readLe16(&data[18]) : 0;
+  const bool v4 = data[1] >= 4 && len >= 24;
+  out.batterySocPct = v4 ? data[20] : 0;
+  out.runtimeMin = v4 ? readLe16(&data[21]) : STATUS_RUNTIME_UNKNOWN;
+  out.ctlMode = (data[1] >= 5 && len >= 25) ? data[23] : (out.manualActive ? 0 : 1);
+  out.linkStage = (data[1] >= 6 && len >= 26) ? data[24] : 0;
+  out.linkLateMs = 0;
+  const bool v7 = data[1] >= 7 && len >= 31;
+  out.motorPeakA = v7 ? (float)readLe16(&data[25]) / 1000.0f : 0.0f;
+  out.motorAvgA = v7 ? (float)readLe16(&data[27]) / 1000.0f : 0.0f;
+  out.motorHeatPct = v7 ? data[29] : 0;
+  out.currentLimited = v7 && (flags & STATUS_FLAG_CURRENT_LIMIT) != 0;
+  const bool v8 = data[1] >= 8 && len >= 34;
+  out.powerLimitPct = v8 ? data[30] : 100;
+  out.derateEvents = v8 ? readLe16(&data[31]) : 0;
   return true;
 }
+
+size_t protocolFormatStatusJson(const StatusReport& st, char* out, size_t cap) {
+  const char* mode = st.manualActive ? "MANUAL" : "REMOTE";
+  const char* gear = "N";
+  if (st.manualGear > 0) gear = "F";
+  else if (st.manualGear < 0) gear = "R";
+  const char* dir = "S";
+  if (st.driveDir > 0) dir = "F";
+  else if (st.driveDir < 0) dir = "R";
+
+  const int n = snprintf(
+    out,
+    cap,
+    "{\"ok\":1,\"bin\":1,\"clients\":%d,\"mode\":\"%s\",\"manual_gear\":\"%s\",\"drive_dir\":\"%s\",\"drive_speed\":%u,\"sel_fwd\":%d,\"sel_back\":%d,\"sel_throttle_v\":%.3f,\"sel_throttle_pct\":%u,\"batt_v\":%.2f,\"ms\":%lu,\"rx_coalesced\":%u,\"rx_ooo\":%u,\"rx_stale\":%u,\"soc\":%u,\"runtime_min\":%ld,\"ctl_mode\":%u,\"link_stage\":%u,\"link_late_ms\":%u,\"motor_peak_a\":%.1f,\"motor_avg_a\":%.1f,\"motor_heat\":%u,\"i_limit\":%d,\"power_limit\":%u,\"derate_events\":%u}",
+    (int)st.clients,
+    mode,
+    gear,
+    dir,
+    (unsigned)st.driveSpeedPct,
+    st.selectorFwd ? 1 : 0,
+    st.selectorBack ? 1 : 0,
+    st.selectorThrottleV,
+    (unsigned)st.selectorThrottlePct,
+    st.batteryV,
+    (unsigned long)st.uptimeMs,
+    (unsigned)st.rxCoalesced,
+    (unsigned)st.rxOutOfOrder,
+    (unsigned)st.rxStale,
+    (unsigned)st.batterySocPct,
+    st.runtimeMin == STATUS_RUNTIME_UNKNOWN ? -1L : (long)st.runtimeMin,
+    (unsigned)st.ctlMode, (unsigned)st.linkStage, (unsigned)st.linkLateMs,
+    st.motorPeakA, st.motorAvgA, (unsigned)st.motorHeatPct, st.currentLimited ? 1 : 0,
+    (unsigned)st.powerLimitPct, (unsigned)st.derateEvents);
+  if (n < 0 || (size_t)n >= cap) return 0;
+  return (size_t)n;
+}
@@ -10,8 +10,138 @@ struct ControlCommand {
   bool manualMode;  // true = use hardware manual inputs
   bool park;        // true = movement lock
   uint8_t reverseSpeed; // 0..100 max reverse speed
+  bool binaryStatus; // sender wants the binary status frame as reply
+  bool hasSeq;      // false for senders that predate sequencing
+  uint16_t seq;     // sender sequence number, wraps
+  bool hasSentMs;
+  uint32_t sentMs;  // sender clock at transmit (ms, any epoch, wraps)
+  bool steerAbs;    // steer is an absolute target (-100 full left .. 100
+                    // full right, 0 centre) instead of a timed pulse
 };
 
+// ===== Binary command frame =====
+// Fixed little-endian layout, see app_control/spec/protocol.md.
+// v1 (12 bytes): [0] magic  [1] version  [2] flags  [3] throttle(i8)
+//   [4] steer(i8)  [5] speed  [6] reverse_speed  [7..8] steer_ms
+//   [9..10] accel_ms  [11] crc8
+// v2 (18 bytes): as v1 up to accel_ms, then [11..12] seq  [13..16] sent_ms
+//   [17] crc8
+static const uint8_t CMD_FRAME_MAGIC = 0xA5;
+static const uint8_t CMD_FRAME_VERSION = 2;
+static const size_t CMD_FRAME_V1_LEN = 12;
+static const size_t CMD_FRAME_LEN = 18;
+static const uint8_t CMD_FLAG_MANUAL = 0x01;
+static const uint8_t CMD_FLAG_PARK = 0x02;
+static const uint8_t CMD_FLAG_BIN_STATUS = 0x04;
+static const uint8_t CMD_FLAG_STEER_ABS = 0x08; // steer is an absolute target, steer_ms unused
+
+// JSON text command (NUL-terminated).
 bool protocolParse(const char* msg, ControlCommand& out);
 
+// True when the datagram starts with the binary frame magic. JSON always
+// starts with '{' or whitespace, so the first byte is enough to dispatch.
+inline bool protocolIsCommandFrame(const uint8_t* data, size_t len) {
+  return len > 0 && data[0] == CMD_FRAME_MAGIC;
+}
+
+bool protocolDecodeFrame(const uint8_t* data, size_t len, ControlCommand& out);
+size_t protocolEncodeFrame(const ControlCommand& cmd, uint8_t* out, size_t cap);
+
+// CRC-8, polynomial 0x07, init 0x00 (CRC-8/SMBUS).
+uint8_t protocolCrc8(const uint8_t* data, size_t len);
+
+// ===== E-stop frame =====
+// Dispatched before any other parsing, on the control port and on its own
+// port (ESTOP_UDP_PORT). The ESP echoes a good frame back as the ack.
+// [0] magic  [1] version  [2] action (1 stop, 0 release)  [3] crc8
+static const uint8_t ESTOP_FRAME_MAGIC = 0xE5;
+static const uint8_t ESTOP_FRAME_VERSION = 1;
+static const size_t ESTOP_FRAME_LEN = 4;
+static const uint8_t ESTOP_ACTION_RELEASE = 0;
+static const uint8_t ESTOP_ACTION_STOP = 1;
+
+inline bool protocolIsEstopFrame(const uint8_t* data, size_t len) {
+  return len > 0 && data[0] == ESTOP_FRAME_MAGIC;
+}
+// False on bad length, version, CRC or action.
+bool protocolDecodeEstop(const uint8_t* data, size_t len, uint8_t& action);
+size_t protocolEncodeEstop(uint8_t action, uint8_t* out, size_t cap);
+
+// ===== Diagnostics query =====
+// Plain text on the control port, so `echo prof | nc -u <ip> 4210` works:
+//   "prof"        loop profiler report (text reply, see profiler.h)
+//   "prof reset"  the report, then the counters are cleared
+// A trailing newline is ignored. Queries do not count as app activity.
+enum DiagQuery : uint8_t {
+  DIAG_NONE = 0,
+  DIAG_PROF,
+  DIAG_PROF_RESET,
+};
+
+DiagQuery protocolParseDiag(const uint8_t* data, size_t len);
+
+// ===== Status reply =====
+// Everything the app is told after each packet. Sent as the binary status
+// frame when the request asked for it, JSON otherwise.
+struct StatusReport {
+  uint8_t clients;
+  bool manualActive;
+  int8_t manualGear;       // -1 R, 0 N, 1 F
+  int8_t driveDir;         // -1 R, 0 S, 1 F
+  uint8_t driveSpeedPct;   // 0..100
+  bool selectorFwd;
+  bool selectorBack;
+  float selectorThrottleV;
+  uint8_t selectorThrottlePct;
+  float batteryV;
+  uint32_t uptimeMs;
+  uint16_t rxCoalesced; // superseded commands dropped unapplied (wraps)
+  uint16_t rxOutOfOrder; // rejected: seq not newer than last applied (wraps)
+  uint16_t rxStale;      // rejected: older than CMD_MAX_AGE_MS (wraps)
+  uint8_t batterySocPct;
+  uint16_t runtimeMin;   // STATUS_RUNTIME_UNKNOWN if not known
+  uint8_t ctlMode;       // ControlMode: 0 manual, 1 remote, 2 park lock,
+                         // 3 link lost, 4 failsafe, 5 OTA, 6 link cut,
+                         // 7 e-stop
+  uint8_t linkStage;     // 0 ok, 1 hold, 2 decel, 3 cut
+  uint16_t linkLateMs;   // current late threshold (JSON only)
+  float motorPeakA;      // rear motor current, peak over the last 1..2 s
+  float motorAvgA;       //   and ~1 s average
+  uint8_t motorHeatPct;  // I²t model, 100 = at the continuous rating
+  bool currentLimited;   // duty held down by the current limit
+  uint8_t powerLimitPct; // battery derating duty ceiling, 100 = not derating
+  uint16_t derateEvents; // times derating kicked in (wraps)
+};
+
+// Binary status frame, little-endian, see app_control/spec/protocol.md.
+// v1: [0] magic  [1] version  [2] flags  [3] drive_speed  [4] sel_throttle_pct
+//     [5] clients  [6..7] batt_mv  [8..9] sel_throttle_mv  [10..13] ms
+// v2: [14..15] rx_coalesced
+// v3: [16..17] rx_ooo  [18..19] rx_stale
+// v4: [20] soc_pct  [21..22] runtime_min
+// v5: [23] ctl_mode
+// v6: [24] link_stage
+// v7: [25..26] motor_peak_ma  [27..28] motor_avg_ma  [29] motor_heat
+//     (flags bit7: current limited)
+// v8: [30] power_limit_pct  [31..32] derate_events
+// The CRC-8 is always the last byte.
+// Later versions only append fields before the CRC; readers accept longer
+// frames and use the CRC in the last byte.
+static const uint8_t STATUS_FRAME_MAGIC = 0x5A;
+static const uint8_t STATUS_FRAME_VERSION = 8;
+static const size_t STATUS_FRAME_V1_LEN = 15;
+static const size_t STATUS_FRAME_LEN = 34;
+static const uint16_t STATUS_RUNTIME_UNKNOWN = 0xFFFF;
+static const uint8_t STATUS_FLAG_MANUAL = 0x01;
+static const uint8_t STATUS_FLAG_SEL_FWD = 0x02;
+static const uint8_t STATUS_FLAG_SEL_BACK = 0x04;
+static const uint8_t STATUS_GEAR_SHIFT = 3;  // 2 bits: 0 N, 1 F, 2 R
+static const uint8_t STATUS_DIR_SHIFT = 5;   // 2 bits: 0 S, 1 F, 2 R
+static const uint8_t STATUS_FLAG_CURRENT_LIMIT = 0x80;
+
+size_t protocolEncodeStatusFrame(const StatusReport& st, uint8_t* out, size_t cap);
+bool protocolDecodeStatusFrame(const uint8_t* data, size_t len, StatusReport& out);
 
+// JSON status text for debugging clients. Returns the length written
+// (excluding NUL), 0 if it did not fit.
+size_t protocolFormatStatusJson(const StatusReport& st, char* out, size_t cap);
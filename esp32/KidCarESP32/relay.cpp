@@ -0,0 +1,125 @@
+#include "relay.h"
+#include "config.h"
+
+static const uint8_t CYCLE_LOG = 16;
+static const uint32_t CYCLE_WINDOW_MS = 60000;
+
+static RelayPolicyConfig cfg = {0, 0, 0, 0};
+static RelayState state = RELAY_OFF;
+static uint32_t stateSince = 0;
+static uint32_t prechargeNeedMs = 0;
+static uint32_t lastMotionMs = 0;
+static bool capHold = false;
+static uint32_t capHoldUntilMs = 0;
+static uint32_t cycleAt[CYCLE_LOG];
+static uint8_t cycleHead = 0;
+static uint8_t cycleCount = 0;
+static RelayStats stats = {0, 0, 0};
+
+RelayPolicyConfig relayDefaultConfig() {
+  return RelayPolicyConfig{RELAY_HOLD_MS, RELAY_PRECHARGE_MS, RELAY_DISCHARGE_MS, RELAY_MAX_CYCLES_PER_MIN};
+}
+
+void relayPolicyReset(const RelayPolicyConfig& config, uint32_t nowMs) {
+  cfg = config;
+  if (cfg.maxCyclesPerMin > CYCLE_LOG) cfg.maxCyclesPerMin = CYCLE_LOG;
+  state = RELAY_OFF;
+  // Boot counts as fully discharged.
+  stateSince = nowMs - cfg.dischargeMs;
+  lastMotionMs = nowMs;
+  capHold = false;
+  cycleHead = 0;
+  cycleCount = 0;
+  stats = RelayStats{0, 0, 0};
+}
+
+// Cycles started in the last minute; *oldestMs gets the earliest of them.
+static uint8_t cyclesInWindow(uint32_t nowMs, uint32_t* oldestMs) {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < cycleCount; i++) {
+    const uint8_t idx = (uint8_t)((cycleHead + CYCLE_LOG - 1 - i) % CYCLE_LOG);
+    if (nowMs - cycleAt[idx] >= CYCLE_WINDOW_MS) break;
+    *oldestMs = cycleAt[idx];
+    n++;
+  }
+  return n;
+}
+
+static void enter(RelayState next, uint32_t nowMs) {
+  state = next;
+  stateSince = nowMs;
+}
+
+static void switchOn(uint32_t nowMs) {
+  // Capacitors lose charge while off; only the lost share is precharged.
+  const uint32_t offMs = nowMs - stateSince;
+  if (cfg.dischargeMs == 0 || offMs >= cfg.dischargeMs) {
+    prechargeNeedMs = cfg.prechargeMs;
+  } else {
+    prechargeNeedMs = (uint32_t)(((uint64_t)cfg.prechargeMs * offMs) / cfg.dischargeMs);
+  }
+  cycleAt[cycleHead] = nowMs;
+  cycleHead = (uint8_t)((cycleHead + 1) % CYCLE_LOG);
+  if (cycleCount < CYCLE_LOG) cycleCount++;
+  stats.cycles++;
+  enter(prechargeNeedMs == 0 ? RELAY_READY : RELAY_PRECHARGE, nowMs);
+}
+
+bool relayPolicyUpdate(bool wantMotion, bool forceOff, uint32_t nowMs) {
+  if (forceOff) {
+    capHold = false;
+    if (state != RELAY_OFF) enter(RELAY_OFF, nowMs);
+    return false;
+  }
+  if (wantMotion) lastMotionMs = nowMs;
+
+  switch (state) {
+    case RELAY_OFF:
+      if (wantMotion) switchOn(nowMs);
+      break;
+    case RELAY_PRECHARGE:
+      if (nowMs - stateSince >= prechargeNeedMs) {
+        enter(wantMotion ? RELAY_READY : RELAY_HOLD, nowMs);
+      }
+      break;
+    case RELAY_READY:
+      if (!wantMotion) enter(RELAY_HOLD, nowMs);
+      break;
+    case RELAY_HOLD:
+      if (wantMotion) {
+        stats.holdReuses++;
+        capHold = false;
+        enter(RELAY_READY, nowMs);
+      } else if (capHold) {
+        if ((int32_t)(nowMs - capHoldUntilMs) >= 0) {
+          capHold = false;
+          enter(RELAY_OFF, nowMs);
+        }
+      } else if (nowMs - lastMotionMs >= cfg.holdMs) {
+        uint32_t oldestMs = nowMs;
+        if (cfg.maxCyclesPerMin > 0 && cyclesInWindow(nowMs, &oldestMs) >= cfg.maxCyclesPerMin) {
+          // The cap is used up: stay on until the oldest cycle leaves the
+          // window, so the next press does not cost another one.
+          stats.capDeferrals++;
+          capHold = true;
+          capHoldUntilMs = oldestMs + CYCLE_WINDOW_MS;
+        } else {
+          enter(RELAY_OFF, nowMs);
+        }
+      }
+      break;
+  }
+  return state == RELAY_READY;
+}
+
+bool relayPolicyOn() {
+  return state != RELAY_OFF;
+}
+
+RelayState relayPolicyState() {
+  return state;
+}
+
+RelayStats relayPolicyStats() {
+  return stats;
+}
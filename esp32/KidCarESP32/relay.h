@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Main relay policy =====
+// Decides when the power relay is on; control.cpp drives the pin. Instead of
+// dropping the relay as soon as motion stops (and paying the precharge delay
+// plus a click on the next press), it:
+// - holds the relay for holdMs after the last motion, so quick taps find
+//   power ready;
+// - tracks how far the driver's bulk capacitors have discharged while off,
+//   and only waits the share of the precharge time that is needed again;
+// - caps on/off cycles per minute: once the cap is reached a hold does not
+//   expire until the oldest cycle leaves the window.
+// forceOff (OTA, failsafe) always switches off at once.
+
+struct RelayPolicyConfig {
+  uint32_t holdMs;
+  uint32_t prechargeMs;   // full precharge from empty
+  uint32_t dischargeMs;   // off time after which a full precharge is needed; 0 = always
+  uint8_t maxCyclesPerMin; // 0 = no cap
+};
+
+enum RelayState : uint8_t {
+  RELAY_OFF = 0,
+  RELAY_PRECHARGE, // on, waiting for the driver supply to settle
+  RELAY_READY,     // on, motion allowed
+  RELAY_HOLD,      // on, idle, hold window running
+};
+
+struct RelayStats {
+  uint32_t cycles;       // off -> on
+  uint32_t holdReuses;   // motion resumed inside the hold window
+  uint32_t capDeferrals; // turn-offs postponed by the cycle cap
+};
+
+// Default policy from config.h.
+RelayPolicyConfig relayDefaultConfig();
+void relayPolicyReset(const RelayPolicyConfig& cfg, uint32_t nowMs);
+// Called every motor tick; returns true when motion may be applied.
+bool relayPolicyUpdate(bool wantMotion, bool forceOff, uint32_t nowMs);
+bool relayPolicyOn();
+RelayState relayPolicyState();
+RelayStats relayPolicyStats();
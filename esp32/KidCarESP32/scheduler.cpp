@@ -0,0 +1,46 @@
+#include "scheduler.h"
+#include "hal.h"
+
+void schedInit(SchedTask* tasks, uint8_t count, uint32_t nowUs) {
+  for (uint8_t i = 0; i < count; i++) {
+    tasks[i].nextDueUs = nowUs + tasks[i].periodUs;
+  }
+  schedResetStats(tasks, count);
+}
+
+void schedResetStats(SchedTask* tasks, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    tasks[i].stats = SchedStats{0, 0, 0, 0, 0};
+  }
+}
+
+uint8_t schedRun(SchedTask* tasks, uint8_t count, uint32_t nowUs) {
+  uint8_t ran = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    SchedTask& t = tasks[i];
+    const int32_t late = (int32_t)(nowUs - t.nextDueUs);
+    if (late < 0) continue;
+
+    uint32_t lateUs = (uint32_t)late;
+    if (lateUs >= t.periodUs) {
+      // Fell behind: skip to the current slot instead of bursting catch-up
+      // runs, and record how many were lost.
+      const uint32_t missed = lateUs / t.periodUs;
+      t.stats.overruns += missed;
+      t.nextDueUs += missed * t.periodUs;
+      lateUs -= missed * t.periodUs;
+    }
+    t.nextDueUs += t.periodUs;
+
+    const uint32_t startUs = halMicros();
+    t.fn(t.periodUs);
+    const uint32_t execUs = halMicros() - startUs;
+
+    t.stats.runs++;
+    t.stats.sumLateUs += lateUs;
+    if (lateUs > t.stats.maxLateUs) t.stats.maxLateUs = lateUs;
+    if (execUs > t.stats.maxExecUs) t.stats.maxExecUs = execUs;
+    ran++;
+  }
+  return ran;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Fixed-rate cooperative scheduler =====
+// A static table of periodic tasks, polled from loop(). Each task is due on
+// a fixed grid (nextDue += period), so it does not drift with loop load, and
+// it is always handed its nominal period as dt. Tasks run in table order, so
+// put the most time-critical first. A task that falls a whole period behind
+// skips the missed slots and counts them as overruns.
+
+typedef void (*SchedFn)(uint32_t dtUs);
+
+struct SchedStats {
+  uint32_t runs;
+  uint32_t overruns;   // whole periods skipped because the task ran late
+  uint32_t maxLateUs;  // worst start jitter (start time - due time)
+  uint32_t sumLateUs;  // for mean jitter = sumLateUs / runs (wraps)
+  uint32_t maxExecUs;
+};
+
+struct SchedTask {
+  const char* name;
+  SchedFn fn;
+  uint32_t periodUs;
+  uint32_t nextDueUs;
+  SchedStats stats;
+};
+
+// First run of each task is one period after nowUs.
+void schedInit(SchedTask* tasks, uint8_t count, uint32_t nowUs);
+// Runs every task that is due at nowUs; returns how many ran.
+uint8_t schedRun(SchedTask* tasks, uint8_t count, uint32_t nowUs);
+void schedResetStats(SchedTask* tasks, uint8_t count);
@@ -0,0 +1,99 @@
+#include "sensors.h"
+#include "pins.h"
+#include "config.h"
+#include "hal.h"
+
+struct SensorDef {
+  int pin;
+  float alpha; // EMA weight of a new frame
+};
+
+// Battery is smoothed for a steady readout; the pedal must stay responsive.
+// Motor current is taken as is: a frame's samples are spread over the PWM
+// period (sensorsStreamSampleHz), and the current limit needs every step.
+static const SensorDef defs[SENSOR_COUNT] = {
+  {PIN_BATTERY_FB, 0.1f},
+  {PIN_MANUAL_THROTTLE, 0.5f},
+  {PIN_BTS_IS, 1.0f},
+};
+
+static float filtered[SENSOR_COUNT];
+static uint8_t streamPins[SENSOR_COUNT];
+static uint8_t streamChannel[SENSOR_COUNT]; // stream slot -> SensorChannel
+static uint8_t streamCount = 0;
+static bool streamed[SENSOR_COUNT];
+static uint32_t updates[SENSOR_COUNT];
+static SensorStats stats = {0, 0, false};
+
+uint32_t sensorsStreamSampleHz(uint8_t pinCount) {
+  if (pinCount == 0) return ADC_STREAM_SAMPLE_HZ;
+  // PWM periods between two samples of one pin: the nominal count rounded,
+  // less 1/N, so N samples step back through the period evenly.
+  const float nominal = (float)pinCount * (float)PWM_FREQ / (float)ADC_STREAM_SAMPLE_HZ;
+  float periods = (float)(int)(nominal + 0.5f);
+  if (periods < 1.0f) periods = 1.0f;
+  periods -= 1.0f / (float)ADC_STREAM_SAMPLES_PER_PIN;
+  return (uint32_t)((float)pinCount * (float)PWM_FREQ / periods + 0.5f);
+}
+
+static void feed(uint8_t ch, uint16_t raw) {
+  filtered[ch] += ((float)raw - filtered[ch]) * defs[ch].alpha;
+  updates[ch]++;
+}
+
+void sensorsInit() {
+  streamCount = 0;
+  for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+    filtered[ch] = (float)halAnalogRead(defs[ch].pin);
+    updates[ch] = 0;
+    streamed[ch] = false;
+    if (halAdcStreamCapable(defs[ch].pin)) {
+      streamPins[streamCount] = (uint8_t)defs[ch].pin;
+      streamChannel[streamCount] = ch;
+      streamCount++;
+    }
+  }
+  stats = SensorStats{0, 0, false};
+  if (streamCount > 0) {
+    stats.streaming = halAdcStreamStart(streamPins, streamCount, ADC_STREAM_SAMPLES_PER_PIN,
+                                        sensorsStreamSampleHz(streamCount));
+    if (!stats.streaming) streamCount = 0;
+  }
+  for (uint8_t i = 0; i < streamCount; i++) {
+    streamed[streamChannel[i]] = true;
+  }
+}
+
+void sensorsPollStream() {
+  uint16_t raw[SENSOR_COUNT];
+  if (streamCount > 0 && halAdcStreamRead(raw, streamCount)) {
+    stats.frames++;
+    for (uint8_t i = 0; i < streamCount; i++) {
+      feed(streamChannel[i], raw[i]);
+    }
+  }
+}
+
+void sensorsPoll() {
+  sensorsPollStream();
+  if (streamCount == SENSOR_COUNT) return;
+
+  for (uint8_t ch = 0; ch < SENSOR_COUNT; ch++) {
+    if (streamed[ch]) continue;
+    stats.directReads++;
+    feed(ch, (uint16_t)halAnalogRead(defs[ch].pin));
+  }
+}
+
+float sensorsPinVoltage(SensorChannel ch) {
+  if (ch >= SENSOR_COUNT) return 0.0f;
+  return (filtered[ch] * 3.3f) / 4095.0f;
+}
+
+uint32_t sensorsUpdates(SensorChannel ch) {
+  return ch < SENSOR_COUNT ? updates[ch] : 0;
+}
+
+SensorStats sensorsGetStats() {
+  return stats;
+}
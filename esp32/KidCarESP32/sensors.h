@@ -0,0 +1,44 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Filtered analog sensor cache =====
+// The ADC converts the analog inputs in the background (continuous mode,
+// DMA); sensorsPoll folds the finished frames into per-channel low-pass
+// filters, and the control tasks only read the cached results. Inputs on
+// pins the stream cannot reach (ADC2 on the S3) get one conversion per poll
+// instead of a blocking burst.
+
+enum SensorChannel : uint8_t {
+  SENSOR_BATTERY = 0, // divider tap, see readBatteryVoltage in control.cpp
+  SENSOR_THROTTLE,    // manual pedal, direct
+  SENSOR_MOTOR_CURRENT, // BTS7960 IS, unfiltered frame average over the PWM period (motor_current.h)
+  SENSOR_COUNT
+};
+
+struct SensorStats {
+  uint32_t frames;       // DMA frames consumed
+  uint32_t directReads;  // single conversions for non-stream pins
+  bool streaming;        // continuous mode started
+};
+
+// Conversion rate for a stream over `pinCount` pins. The IS pin only carries
+// current while the bridge's high side is on, so its samples must not lock
+// to the PWM: a rate that is a sub-multiple of PWM_FREQ (20 kHz over two
+// pins) takes every sample at the same point of the period and reads either
+// the on-time current or nothing. This is ADC_STREAM_SAMPLE_HZ nudged so
+// each sample of a pin lands 1/ADC_STREAM_SAMPLES_PER_PIN of a period
+// before the one before; a frame then covers the period evenly and its mean
+// is the duty-weighted average, to within one sample.
+uint32_t sensorsStreamSampleHz(uint8_t pinCount);
+// Seeds the filters with one conversion per channel and starts the stream.
+void sensorsInit();
+// Drains the newest DMA frame into the filters; cheap, call every tick.
+void sensorsPoll();
+// The DMA part of sensorsPoll only (no direct conversions), for callers
+// faster than the input rate.
+void sensorsPollStream();
+// Filtered pin voltage, 0..3.3 V.
+float sensorsPinVoltage(SensorChannel ch);
+// Values folded into the channel since init; a change means a new reading.
+uint32_t sensorsUpdates(SensorChannel ch);
+SensorStats sensorsGetStats();
@@ -0,0 +1,143 @@
+#include "speed_ctl.h"
+#include "config.h"
+#include "hal.h"
+
+#include <math.h>
+
+float speedPiStep(SpeedPi& pi, const SpeedPiGains& g, float setpoint, float measured, float dtS) {
+  const float err = setpoint - measured;
+  float integral = pi.integral + g.ki * err * dtS;
+  float out = g.kff * setpoint + g.kp * err + integral;
+  if (out > g.outMax) {
+    if (err > 0.0f) integral = pi.integral;
+    out = g.outMax;
+  } else if (out < 0.0f) {
+    if (err < 0.0f) integral = pi.integral;
+    out = 0.0f;
+  }
+  pi.integral = integral;
+  pi.out = out;
+  return out;
+}
+
+// ===== Rear speed loop =====
+static const SpeedPiGains kGains = {SPEED_KP, SPEED_KI, 1.0f, 100.0f};
+static const uint32_t PERIOD_US = (uint32_t)SPEED_CTL_PERIOD_MS * 1000U;
+
+static bool fitted = false;
+static bool fault = false;
+static bool engaged = false;     // PI owns the output (non-zero setpoint)
+static SpeedPi pi = {0.0f, 0.0f};
+static float setpointMag = 0.0f;
+static uint32_t periodUs = 0;
+static uint32_t lastCount = 0;
+static uint32_t winPulses[SPEED_WINDOW_PERIODS];
+static uint32_t winUs[SPEED_WINDOW_PERIODS];
+static uint8_t winIdx = 0;
+static float measuredMmps = 0.0f;
+static uint32_t noPulseUs = 0;   // pushing at >= SPEED_FAULT_DUTY_PCT without a pulse
+static SpeedCtlStats stats = {0, 0, 0};
+
+// Folds the pulses of the period just ended into the window. Returns them.
+static uint32_t measure(uint32_t dtUs) {
+  const uint32_t count = halPcntCount();
+  const uint32_t pulses = count - lastCount;
+  lastCount = count;
+  winPulses[winIdx] = pulses;
+  winUs[winIdx] = dtUs;
+  winIdx = (uint8_t)((winIdx + 1) % SPEED_WINDOW_PERIODS);
+  uint32_t sumPulses = 0;
+  uint32_t sumUs = 0;
+  for (uint8_t i = 0; i < SPEED_WINDOW_PERIODS; i++) {
+    sumPulses += winPulses[i];
+    sumUs += winUs[i];
+  }
+  measuredMmps = sumUs ? (float)sumPulses * 1.0e9f / (WHEEL_PULSES_PER_M * (float)sumUs) : 0.0f;
+  return pulses;
+}
+
+static void disengage() {
+  engaged = false;
+  pi = SpeedPi{0.0f, 0.0f};
+  noPulseUs = 0;
+}
+
+void speedCtlInit(bool isFitted) {
+  fitted = isFitted;
+  fault = false;
+  disengage();
+  setpointMag = 0.0f;
+  periodUs = 0;
+  lastCount = halPcntCount();
+  for (uint8_t i = 0; i < SPEED_WINDOW_PERIODS; i++) {
+    winPulses[i] = 0;
+    winUs[i] = PERIOD_US;
+  }
+  winIdx = 0;
+  measuredMmps = 0.0f;
+  stats = SpeedCtlStats{0, 0, 0};
+}
+
+float speedCtlStep(float setpointPct, bool emergency, uint32_t dtUs, float maxDutyPct, bool currentLimited) {
+  if (!fitted || fault) return setpointPct;
+  const float mag = fabsf(setpointPct);
+  periodUs += dtUs;
+  const bool update = periodUs >= PERIOD_US;
+  uint32_t pulses = 0;
+  uint32_t elapsedUs = 0;
+  if (update) {
+    elapsedUs = periodUs;
+    periodUs = 0;
+    pulses = measure(elapsedUs);
+  }
+
+  if (mag == 0.0f) {
+    disengage();
+    return setpointPct;
+  }
+  if (emergency) {
+    // Never push harder than the emergency ramp, never step up to it.
+    if (!engaged || pi.out > mag) pi.out = mag;
+    pi.integral = 0.0f;
+    engaged = true;
+    return setpointPct < 0.0f ? -pi.out : pi.out;
+  }
+  if (!engaged) {
+    // Engage on feedforward alone; the first update adds the correction.
+    engaged = true;
+    pi.out = kGains.kff * mag;
+    if (pi.out > maxDutyPct) pi.out = maxDutyPct;
+  }
+  if (update) {
+    setpointMag = mag;
+    SpeedPiGains g = kGains;
+    g.outMax = maxDutyPct;
+    speedPiStep(pi, g, mag, measuredMmps * 100.0f / WHEEL_MAX_MMPS, (float)elapsedUs / 1.0e6f);
+    stats.updates++;
+    if (pi.out >= g.outMax || pi.out <= 0.0f) stats.saturated++;
+    if (pulses > 0 || (currentLimited && pi.out >= maxDutyPct)) {
+      noPulseUs = 0; // no pulses at the current limit: stalled, not a dead encoder
+    } else if (pi.out >= SPEED_FAULT_DUTY_PCT) {
+      noPulseUs += elapsedUs;
+      if (noPulseUs >= (uint32_t)SPEED_FAULT_MS * 1000U) {
+        fault = true;
+        stats.faults++;
+        disengage();
+        return setpointPct;
+      }
+    }
+  }
+  return setpointPct < 0.0f ? -pi.out : pi.out;
+}
+
+bool speedCtlClosed() {
+  return fitted && !fault;
+}
+
+SpeedCtlState speedCtlGetState() {
+  return SpeedCtlState{measuredMmps, setpointMag, pi.out, pi.integral, fitted, fault};
+}
+
+SpeedCtlStats speedCtlGetStats() {
+  return stats;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Closed-loop rear speed =====
+// With a wheel encoder (WHEEL_ENCODER_FITTED) the rear driver's profile
+// output is a speed setpoint in % of WHEEL_MAX_MMPS rather than a duty. Every
+// SPEED_CTL_PERIOD_MS the wheel speed is measured from the PCNT count over
+// the last SPEED_WINDOW_PERIODS periods and a PI loop (setpoint as
+// feedforward) picks the duty. The loop works on magnitudes: the single-
+// channel encoder has no direction, so the wheel is taken to turn the way
+// it is driven. Zero setpoint and emergency decel bypass the loop (the
+// profile's duty goes straight out) so a stop is never delayed. An encoder
+// that gives no pulses while the loop is pushing latches a fault, and the
+// driver falls back to open loop until the next init.
+
+// ----- PI step (pure math) -----
+struct SpeedPiGains {
+  float kp;      // duty % per speed % of error
+  float ki;      // duty % per speed %·s
+  float kff;     // duty % per speed % of setpoint
+  float outMax;  // duty %, output clamped to 0..outMax
+};
+
+struct SpeedPi {
+  float integral; // duty %
+  float out;      // duty %, last output
+};
+
+// One update. setpoint and measured are magnitudes (speed %); dtS is the time
+// since the last update. Anti-windup by conditional integration: the
+// integral does not move while the output is clamped and the error pushes
+// further into the clamp.
+float speedPiStep(SpeedPi& pi, const SpeedPiGains& g, float setpoint, float measured, float dtS);
+
+// ----- Rear speed loop -----
+// Resets the loop and the fault; `fitted` false keeps it in open loop.
+void speedCtlInit(bool fitted);
+// Called by the rear driver every tick with the profile output (signed %) and
+// the duty ceiling (current limit and battery derating), which is the PI's
+// output clamp so the integral does not wind up against it. `currentLimited`
+// is true when the ceiling is the current limit's (motor_current.h): no
+// pulses while the PI sits on it is a stall, not a dead encoder. Returns the
+// signed duty % to apply.
+float speedCtlStep(float setpointPct, bool emergency, uint32_t dtUs, float maxDutyPct, bool currentLimited);
+// True when the duty comes from the PI loop (fitted, no fault).
+bool speedCtlClosed();
+
+struct SpeedCtlState {
+  float measuredMmps;
+  float setpointPct;  // magnitude, at the last PI update
+  float dutyPct;      // PI output
+  float integralPct;
+  bool fitted;
+  bool fault;
+};
+
+struct SpeedCtlStats {
+  uint32_t updates;    // PI updates
+  uint32_t saturated;  // updates with the output clamped
+  uint32_t faults;
+};
+
+SpeedCtlState speedCtlGetState();
+SpeedCtlStats speedCtlGetStats();
@@ -0,0 +1,24 @@
+#include "telemetry.h"
+#include <atomic>
+#include <string.h>
+
+static TelemetrySnapshot current = {};
+static std::atomic<uint32_t> version{0}; // odd while a write is in flight
+
+void telemetryPublish(const TelemetrySnapshot& snap) {
+  const uint32_t v = version.load(std::memory_order_relaxed);
+  version.store(v + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(&current, &snap, sizeof(current));
+  version.store(v + 2, std::memory_order_release);
+}
+
+void telemetryRead(TelemetrySnapshot& out) {
+  for (;;) {
+    const uint32_t before = version.load(std::memory_order_acquire);
+    if (before & 1u) continue;
+    memcpy(&out, &current, sizeof(out));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (version.load(std::memory_order_relaxed) == before) return;
+  }
+}
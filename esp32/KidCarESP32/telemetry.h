@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+
+// ===== Telemetry snapshot =====
+// controlLoop publishes one snapshot per tick; readers on other tasks get a
+// tear-free copy of a single tick. Published through a seqlock: the writer
+// never waits, readers retry while a write is in flight. Readers must not
+// preempt the writer on its own core (the network task runs on the other
+// core, or in the same task when NET_TASK_ENABLED is 0).
+
+struct TelemetrySnapshot {
+  uint32_t tick;           // motor tick that produced it
+  uint32_t ms;             // halMillis() at that tick
+  float batteryV;           // estimated rest voltage (battery.h)
+  float batteryMeasuredV;   // under load
+  uint8_t batterySocPct;
+  uint16_t batteryRuntimeMin; // BATTERY_RUNTIME_UNKNOWN if not known yet
+  bool appConnected;
+  uint8_t mode;             // ControlMode (control_mode.h)
+  uint8_t linkStage;        // LinkStage (link_watch.h)
+  uint16_t linkLateMs;      // current OK -> HOLD threshold
+  bool manualActive;
+  bool relayOn;
+  int8_t manualGear;       // -1 R, 0 N, 1 F
+  int8_t driveDir;         // -1 R, 0 S, 1 F
+  uint8_t driveSpeedPct;   // 0..100
+  bool selectorFwd;
+  bool selectorBack;
+  float selectorThrottleV;
+  uint8_t selectorThrottlePct;
+  float motorPeakA;        // rear motor current (motor_current.h)
+  float motorAvgA;
+  uint8_t motorHeatPct;    // I²t state, 100 = at the continuous rating
+  bool currentLimited;     // duty held down by the current limit
+  uint8_t powerLimitPct;   // battery derating duty ceiling, 100 = none
+  uint32_t derateEvents;   // times derating kicked in since init
+};
+
+void telemetryPublish(const TelemetrySnapshot& snap);
+void telemetryRead(TelemetrySnapshot& out);
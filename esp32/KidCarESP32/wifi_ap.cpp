@@ -4,20 +4,30 @@
 #if TEST_BLINK
 void wifiApInit() {}
 void wifiApLoop() {}
+void wifiApStartTask() {}
+WifiRxStats wifiApGetRxStats() { return WifiRxStats{0, 0, 0, 0}; }
 #else
 #include "protocol.h"
+#include "cmd_guard.h"
+#include "net_queue.h"
+#include "telemetry.h"
 #include "control.h"
-#include "motor_rear.h"
-#include "motor_steer.h"
-#include "pins.h"
+#include "log.h"
+#include "profiler.h"
 
 #include <Arduino.h>
 #include <ArduinoOTA.h>
 #include <WiFi.h>
 #include <WiFiUdp.h>
+#include <lwip/sockets.h>
 
 static WiFiUDP Udp;
 static char packetBuffer[256];
+static char resp[512];
+static char diagResp[1400]; // profiler report, one datagram
+static const uint8_t RX_MAX_DRAIN = 16;
+static WifiRxStats rxStats = {0, 0, 0, 0};
+static bool binaryStatus = false; // last good packet asked for binary status
 static uint32_t lastAckLog = 0;
 static bool otaInProgress = false;
 static uint8_t otaLastPct = 255;
@@ -25,16 +35,16 @@ static uint8_t otaLastPct = 255;
 static void onWifiEvent(WiFiEvent_t event) {
   switch (event) {
     case ARDUINO_EVENT_WIFI_AP_START:
-      Serial.println("AP START");
+      logMsg(LOG_INFO, "AP START");
       break;
     case ARDUINO_EVENT_WIFI_AP_STOP:
-      Serial.println("AP STOP");
+      logMsg(LOG_INFO, "AP STOP");
       break;
     case ARDUINO_EVENT_WIFI_AP_STACONNECTED:
-      Serial.println("STA CONNECTED");
+      logMsg(LOG_INFO, "STA CONNECTED");
       break;
     case ARDUINO_EVENT_WIFI_AP_STADISCONNECTED:
-      Serial.println("STA DISCONNECTED");
+      logMsg(LOG_INFO, "STA DISCONNECTED");
       break;
     default:
       break;
@@ -52,17 +62,16 @@ static void setupOta() {
     otaInProgress = true;
     otaLastPct = 255;
 
-    // Safety: stop motion immediately while firmware is being written.
-    rearSetSpeed(0);
-    steerStop();
-    digitalWrite(PIN_RELAY_EN, LOW);
+    // controlLoop stops the motors and relay when it sees this.
+    netSetOtaActive(true);
 
-    Serial.println("OTA START");
+    logMsg(LOG_INFO, "OTA START");
   });
 
   ArduinoOTA.onEnd([]() {
     otaInProgress = false;
-    Serial.println("\nOTA END");
+    netSetOtaActive(false);
+    logMsg(LOG_INFO, "OTA END");
   });
 
   ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
@@ -70,13 +79,14 @@ static void setupOta() {
     const uint8_t pct = (uint8_t)((progress * 100U) / total);
     if (pct != otaLastPct && (pct == 0 || pct == 100 || (pct % 5) == 0)) {
       otaLastPct = pct;
-      Serial.printf("OTA %u%%\n", pct);
+      logMsg(LOG_INFO, "OTA %u%%", (unsigned)pct);
     }
   });
 
   ArduinoOTA.onError([](ota_error_t error) {
     otaInProgress = false;
-    Serial.printf("OTA ERROR[%u]\n", (unsigned int)error);
+    netSetOtaActive(false);
+    logMsg(LOG_ERROR, "OTA ERROR[%u]", (unsigned int)error);
   });
 
   ArduinoOTA.begin();
@@ -87,6 +97,46 @@ static void setupOta() {
     WiFi.softAPIP().toString().c_str());
 }
 
+// ===== E-stop =====
+// Handles an e-stop datagram and fills `ack` with the echo; returns the ack
+// length, 0 if it is not a valid e-stop frame (and nothing was done).
+static size_t handleEstop(const uint8_t* data, size_t len, uint32_t rxUs, uint8_t* ack, size_t cap) {
+  uint8_t action = 0;
+  if (!protocolDecodeEstop(data, len, action)) return 0;
+  if (action == ESTOP_ACTION_STOP) {
+    controlEstop(rxUs);
+  } else {
+    controlEstopRelease();
+  }
+  return protocolEncodeEstop(action, ack, cap);
+}
+
+// Blocks in recvfrom on ESTOP_UDP_PORT; outside the polled UDP path so a stop
+// waits for neither the net task's tick nor a backlog of control datagrams.
+static void estopTask(void*) {
+  const int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(ESTOP_UDP_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (sock < 0 || bind(sock, (sockaddr*)&addr, sizeof(addr)) != 0) {
+    Serial.println("ESTOP SOCKET FAILED");
+    vTaskDelete(nullptr);
+    return;
+  }
+  uint8_t buf[16];
+  uint8_t ack[ESTOP_FRAME_LEN];
+  for (;;) {
+    sockaddr_in from = {};
+    socklen_t fromLen = sizeof(from);
+    const int n = recvfrom(sock, buf, sizeof(buf), 0, (sockaddr*)&from, &fromLen);
+    const uint32_t rxUs = micros();
+    if (n <= 0) continue;
+    const size_t ackLen = handleEstop(buf, (size_t)n, rxUs, ack, sizeof(ack));
+    if (ackLen) sendto(sock, ack, ackLen, 0, (sockaddr*)&from, fromLen);
+  }
+}
+
 void wifiApInit() {
   WiFi.mode(WIFI_AP);
   WiFi.onEvent(onWifiEvent);
@@ -97,6 +147,7 @@ void wifiApInit() {
   }
 
   Udp.begin(UDP_PORT);
+  xTaskCreatePinnedToCore(estopTask, "estop", ESTOP_TASK_STACK, nullptr, ESTOP_TASK_PRIORITY, nullptr, NET_TASK_CORE);
   Serial.print("AP IP: ");
   Serial.println(WiFi.softAPIP());
 
@@ -104,73 +155,170 @@ void wifiApInit() {
 }
 
 void wifiApLoop() {
-  ArduinoOTA.handle();
+  {
+    PROF_SCOPE(PROF_OTA);
+    ArduinoOTA.handle();
+  }
 
   if (otaInProgress) {
     // While OTA is active, ignore runtime packets.
     return;
   }
 
-  const int packetSize = Udp.parsePacket();
-  if (packetSize <= 0) {
-    return;
-  }
-
-  const int len = Udp.read(packetBuffer, sizeof(packetBuffer) - 1);
-  if (len > 0) {
+  // Drain everything queued since the last iteration and apply only the
+  // newest good command; after a WiFi stall this skips the backlog instead of
+  // replaying it one packet per loop. Bounded so a flood cannot starve
+  // controlLoop.
+  uint8_t drained = 0;
+  uint8_t good = 0;
+  uint8_t diagQueries = 0;
+  uint8_t estops = 0;
+  ControlCommand latest;
+  IPAddress replyIp;
+  uint16_t replyPort = 0;
+  while (drained < RX_MAX_DRAIN) {
+    int len = 0;
+    {
+      PROF_SCOPE(PROF_UDP_RX); // empty polls included: they are loop time too
+      const int packetSize = Udp.parsePacket();
+      if (packetSize <= 0) break;
+      len = Udp.read(packetBuffer, sizeof(packetBuffer) - 1);
+    }
+    drained++;
+    replyIp = Udp.remoteIP();
+    replyPort = Udp.remotePort();
+    const uint32_t rxUs = micros();
+    if (len <= 0) continue;
     packetBuffer[len] = 0;
 
-    controlNotifyAppActivity();
-    Serial.print("RX ");
-    Serial.println(packetBuffer);
+    // E-stop on the control port: handled here and now, ahead of the rest
+    // of the burst, and acked on its own.
+    if (protocolIsEstopFrame((const uint8_t*)packetBuffer, (size_t)len)) {
+      estops++;
+      uint8_t ack[ESTOP_FRAME_LEN];
+      const size_t ackLen = handleEstop((const uint8_t*)packetBuffer, (size_t)len, rxUs, ack, sizeof(ack));
+      if (ackLen) {
+        Udp.beginPacket(replyIp, replyPort);
+        Udp.write(ack, ackLen);
+        Udp.endPacket();
+      }
+      continue;
+    }
+
+    const uint8_t* raw = (const uint8_t*)packetBuffer;
+    const DiagQuery diag = protocolParseDiag(raw, (size_t)len);
+    if (diag != DIAG_NONE) {
+      diagQueries++;
+      const size_t diagLen = profFormat(diagResp, sizeof(diagResp));
+      if (diag == DIAG_PROF_RESET) profReset();
+      Udp.beginPacket(replyIp, replyPort);
+      Udp.write((const uint8_t*)diagResp, diagLen);
+      Udp.endPacket();
+      continue;
+    }
 
     ControlCommand cmd;
-    if (protocolParse(packetBuffer, cmd)) {
-      controlApply(cmd);
-      if (millis() - lastAckLog > 1000) {
-        lastAckLog = millis();
-        Serial.println("APP OK");
+    bool parsed = false;
+    {
+      PROF_SCOPE(PROF_PARSE);
+      if (protocolIsCommandFrame(raw, (size_t)len)) {
+        // Compact binary frame; JSON stays as the fallback below.
+        parsed = protocolDecodeFrame(raw, (size_t)len, cmd);
+        if (!parsed) logMsg(LOG_WARN, "RX BAD FRAME");
+      } else {
+        logText(LOG_DEBUG, "RX ", packetBuffer, (size_t)len);
+        parsed = protocolParse(packetBuffer, cmd);
       }
     }
+    // Reordered and delayed commands never reach controlApply. Accepted
+    // ones arrive in increasing seq, so the last one kept is the newest.
+    if (parsed && cmdGuardAccept(cmd, millis())) {
+      latest = cmd;
+      good++;
+    }
+  }
+  // Nothing but diagnostics and e-stops: not app activity, no status reply.
+  if (drained == diagQueries + estops) {
+    return;
+  }
+
+  rxStats.packets += drained;
+  if (drained > rxStats.maxBurst) rxStats.maxBurst = drained;
+  if (good > 0) {
+    rxStats.applied++;
+    rxStats.coalesced += (uint32_t)(good - 1);
+    netQueuePush(NetMsg{NET_MSG_COMMAND, latest});
+    binaryStatus = latest.binaryStatus;
+    if (millis() - lastAckLog > 1000) {
+      lastAckLog = millis();
+      logMsg(LOG_INFO, "APP OK");
+    }
+  } else {
+    netQueuePush(NetMsg{NET_MSG_ACTIVITY, ControlCommand()});
   }
 
   // Always send status back to sender (even if parse fails)
-  char resp[340];
-  const int clients = WiFi.softAPgetStationNum();
-  const float batt = controlGetBatteryVoltage();
-  const char* mode = controlIsManualActive() ? "MANUAL" : "REMOTE";
-  const int8_t manualGear = controlGetManualGear();
-  const int8_t driveDir = controlGetDriveDir();
-  const uint8_t driveSpeed = controlGetDriveSpeedPct();
-  const int selFwd = controlGetSelectorFwdActive() ? 1 : 0;
-  const int selBack = controlGetSelectorBackActive() ? 1 : 0;
-  const float selThrottleV = controlGetSelectorThrottleVoltage();
-  const uint8_t selThrottlePct = controlGetSelectorThrottlePct();
-  const char* gear = "N";
-  if (manualGear > 0) gear = "F";
-  else if (manualGear < 0) gear = "R";
-  const char* dir = "S";
-  if (driveDir > 0) dir = "F";
-  else if (driveDir < 0) dir = "R";
-
-  snprintf(
-    resp,
-    sizeof(resp),
-    "{\"ok\":1,\"clients\":%d,\"mode\":\"%s\",\"manual_gear\":\"%s\",\"drive_dir\":\"%s\",\"drive_speed\":%u,\"sel_fwd\":%d,\"sel_back\":%d,\"sel_throttle_v\":%.3f,\"sel_throttle_pct\":%u,\"batt_v\":%.2f,\"ms\":%lu}",
-    clients,
-    mode,
-    gear,
-    dir,
-    driveSpeed,
-    selFwd,
-    selBack,
-    selThrottleV,
-    selThrottlePct,
-    batt,
-    millis());
-
-  Udp.beginPacket(Udp.remoteIP(), Udp.remotePort());
-  Udp.write((const uint8_t*)resp, strlen(resp));
+  TelemetrySnapshot snap;
+  telemetryRead(snap);
+  StatusReport st;
+  st.clients = (uint8_t)WiFi.softAPgetStationNum();
+  st.manualActive = snap.manualActive;
+  st.manualGear = snap.manualGear;
+  st.driveDir = snap.driveDir;
+  st.driveSpeedPct = snap.driveSpeedPct;
+  st.selectorFwd = snap.selectorFwd;
+  st.selectorBack = snap.selectorBack;
+  st.selectorThrottleV = snap.selectorThrottleV;
+  st.selectorThrottlePct = snap.selectorThrottlePct;
+  st.batteryV = snap.batteryV;
+  st.uptimeMs = millis();
+  st.rxCoalesced = (uint16_t)rxStats.coalesced;
+  const CmdGuardStats guard = cmdGuardGetStats();
+  st.rxOutOfOrder = (uint16_t)guard.outOfOrder;
+  st.rxStale = (uint16_t)guard.stale;
+  st.batterySocPct = snap.batterySocPct;
+  st.runtimeMin = snap.batteryRuntimeMin;
+  st.ctlMode = snap.mode;
+  st.linkStage = snap.linkStage;
+  st.linkLateMs = snap.linkLateMs;
+  st.motorPeakA = snap.motorPeakA;
+  st.motorAvgA = snap.motorAvgA;
+  st.motorHeatPct = snap.motorHeatPct;
+  st.currentLimited = snap.currentLimited;
+  st.powerLimitPct = snap.powerLimitPct;
+  st.derateEvents = (uint16_t)snap.derateEvents;
+
+  size_t respLen = 0;
+  {
+    PROF_SCOPE(PROF_STATUS);
+    if (binaryStatus) {
+      respLen = protocolEncodeStatusFrame(st, (uint8_t*)resp, sizeof(resp));
+    } else {
+      respLen = protocolFormatStatusJson(st, resp, sizeof(resp));
+    }
+  }
+  if (respLen == 0) return;
+
+  // One reply per drained burst, to the sender of the newest datagram.
+  PROF_SCOPE(PROF_UDP_TX);
+  Udp.beginPacket(replyIp, replyPort);
+  Udp.write((const uint8_t*)resp, respLen);
   Udp.endPacket();
 }
+
+static void netTask(void*) {
+  for (;;) {
+    wifiApLoop();
+    // Yield one tick; UDP and OTA are polled, not event driven.
+    vTaskDelay(1);
+  }
+}
+
+void wifiApStartTask() {
+  xTaskCreatePinnedToCore(netTask, "net", NET_TASK_STACK, nullptr, NET_TASK_PRIORITY, nullptr, NET_TASK_CORE);
+}
+
+WifiRxStats wifiApGetRxStats() {
+  return rxStats;
+}
 #endif
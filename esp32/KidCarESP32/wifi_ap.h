@@ -1,5 +1,14 @@
 #pragma once
 #include <Arduino.h>
 
+struct WifiRxStats {
+  uint32_t packets;   // datagrams read
+  uint32_t applied;   // commands handed to controlApply
+  uint32_t coalesced; // accepted commands superseded within a drained burst
+  uint8_t maxBurst;   // most datagrams drained in one wifiApLoop
+};
+
 void wifiApInit();
 void wifiApLoop();
+void wifiApStartTask(); // runs wifiApLoop forever on NET_TASK_CORE
+WifiRxStats wifiApGetRxStats();
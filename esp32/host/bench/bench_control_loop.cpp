@@ -0,0 +1,83 @@
+// Runs the real controlLoop against the simulated board with a 1 ms virtual
+// tick and reports host cost per iteration and the virtual/real time ratio.
+// Every 20 ticks it also parses a command and formats a status reply the way
+// the network task does, so the profiler report covers both loops.
+
+#include "bench_util.h"
+#include "sim_hal.h"
+#include "control.h"
+#include "protocol.h"
+#include "profiler.h"
+#include "pins.h"
+
+#include <stdlib.h>
+
+static const char kCommand[] =
+  "{\"throttle\":40,\"steer\":-20,\"steerMs\":120,\"speed\":60,\"accelMs\":800,\"manualMode\":false,"
+  "\"park\":false,\"reverseSpeed\":50,\"seq\":7,\"sentMs\":1000}";
+
+static void netPath() {
+  ControlCommand cmd;
+  {
+    PROF_SCOPE(PROF_PARSE);
+    benchKeep(protocolParse(kCommand, cmd));
+  }
+  StatusReport st = {};
+  st.batteryV = 12.1f;
+  st.uptimeMs = 123456;
+  char resp[512];
+  PROF_SCOPE(PROF_STATUS);
+  benchKeep(protocolFormatStatusJson(st, resp, sizeof(resp)));
+}
+
+static void runPhase(const char* name, uint64_t iterations) {
+  simHalResetCounters();
+  controlResetSchedStats();
+  profReset();
+  const BenchResult r = benchRun(iterations, [](uint64_t i) {
+    simAdvanceMs(1);
+    controlLoop();
+    if (i % 20 == 0) netPath();
+  });
+  benchReport(name, r);
+  const SimHalCounters& c = simHalCounters();
+  const double speedup = r.ns ? ((double)iterations * 1e6) / (double)r.ns : 0.0;
+  printf("  virtual/real %.0fx  adc=%.2f dma=%.2f ledc=%.3f fade=%.3f rgb=%.4f gpio=%.1f per loop\n",
+         speedup,
+         (double)c.analogReads / (double)iterations,
+         (double)c.adcFrames / (double)iterations,
+         (double)c.ledcWrites / (double)iterations,
+         (double)c.ledcFades / (double)iterations,
+         (double)c.rgbWrites / (double)iterations,
+         (double)c.digitalWrites / (double)iterations);
+
+  uint8_t count = 0;
+  const SchedTask* tasks = controlSchedTasks(count);
+  for (uint8_t i = 0; i < count; i++) {
+    const SchedStats& s = tasks[i].stats;
+    printf("  task %-7s runs=%u overruns=%u late_max=%uus exec_max=%uus\n",
+           tasks[i].name, (unsigned)s.runs, (unsigned)s.overruns,
+           (unsigned)s.maxLateUs, (unsigned)s.maxExecUs);
+  }
+  static char report[2048];
+  profFormat(report, sizeof(report));
+  printf("%s", report);
+}
+
+int main(int argc, char** argv) {
+  const uint64_t iterations = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000ULL;
+
+  Serial.setSink(nullptr);
+  simHalReset();
+  simAdvanceMs(1);
+  simSetAnalogMv(PIN_BATTERY_FB, 2134);      // ~12 V pack
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000); // pedal released
+  controlInit();
+
+  runPhase("control_loop idle", iterations);
+
+  simSetDigitalIn(PIN_MANUAL_FWD, LOW);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 500);
+  runPhase("control_loop manual fwd", iterations);
+  return 0;
+}
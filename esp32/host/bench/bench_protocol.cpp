@@ -0,0 +1,86 @@
+// Cycles per parse for the binary command frame, the in-place JSON tokenizer
+// and (when available) the ArduinoJson DOM parser it replaced. The "wide"
+// packets carry ten extra fields the firmware does not know about.
+
+#include "bench_util.h"
+#include "protocol.h"
+#if defined(KIDCAR_HAVE_ARDUINOJSON)
+#include "protocol_json_ref.h"
+#endif
+
+#include <stdlib.h>
+
+static const int kSamples = 64;
+
+int main(int argc, char** argv) {
+  const uint64_t iterations = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 2000000ULL;
+
+  uint8_t frames[kSamples][CMD_FRAME_LEN];
+  char json[kSamples][160];
+  char wide[kSamples][400];
+  for (int i = 0; i < kSamples; i++) {
+    ControlCommand c = {};
+    c.throttle = (i * 7) % 201 - 100;
+    c.steer = (i * 13) % 201 - 100;
+    c.steerMs = 0;
+    c.speed = (i * 3) % 101;
+    c.accelMs = 600;
+    c.manualMode = (i & 1) != 0;
+    c.park = (i & 2) != 0;
+    c.reverseSpeed = 35;
+    protocolEncodeFrame(c, frames[i], sizeof(frames[i]));
+    snprintf(json[i], sizeof(json[i]),
+             "{\"throttle\":%d,\"steer\":%d,\"speed\":%d,\"accel_ms\":%u,"
+             "\"reverse_speed\":%u,\"park\":%s,\"signal\":80,\"mode\":\"%s\"}",
+             c.throttle, c.steer, c.speed, (unsigned)c.accelMs, (unsigned)c.reverseSpeed,
+             c.park ? "true" : "false", c.manualMode ? "manual" : "remote");
+    snprintf(wide[i], sizeof(wide[i]),
+             "{\"seq\":%d,\"ts\":1739000000%03d,\"gyro\":[0.12,-0.5,9.81],\"ui\":{\"lang\":\"fa\","
+             "\"theme\":\"dark\"},\"battery_warn\":11.2,\"horn\":false,\"lights\":true,"
+             "\"app_ver\":\"1.0.0+1\",\"rssi\":-61,\"note\":\"extra \\\"quoted\\\" text\",%s",
+             i, i, json[i] + 1);
+  }
+
+  printf("frame bytes: binary=%u json~=%u\n", (unsigned)CMD_FRAME_LEN, (unsigned)strlen(json[0]));
+
+  ControlCommand out = {};
+  const BenchResult bin = benchRun(iterations, [&](uint64_t i) {
+    const bool ok = protocolDecodeFrame(frames[i % kSamples], CMD_FRAME_LEN, out);
+    benchKeep(ok);
+    benchKeep(out);
+  });
+  benchReport("decode binary frame", bin);
+
+  const BenchResult tok = benchRun(iterations, [&](uint64_t i) {
+    const bool ok = protocolParse(json[i % kSamples], out);
+    benchKeep(ok);
+    benchKeep(out);
+  });
+  benchReport("parse json (tokenizer)", tok);
+
+  const BenchResult tokWide = benchRun(iterations, [&](uint64_t i) {
+    const bool ok = protocolParse(wide[i % kSamples], out);
+    benchKeep(ok);
+    benchKeep(out);
+  });
+  benchReport("parse wide json (tokenizer)", tokWide);
+
+#if defined(KIDCAR_HAVE_ARDUINOJSON)
+  const BenchResult dom = benchRun(iterations / 10, [&](uint64_t i) {
+    const bool ok = protocolParseArduinoJson(json[i % kSamples], out);
+    benchKeep(ok);
+    benchKeep(out);
+  });
+  benchReport("parse json (ArduinoJson)", dom);
+
+  const BenchResult domWide = benchRun(iterations / 10, [&](uint64_t i) {
+    const bool ok = protocolParseArduinoJson(wide[i % kSamples], out);
+    benchKeep(ok);
+    benchKeep(out);
+  });
+  benchReport("parse wide json (ArduinoJson)", domWide);
+#else
+  printf("ArduinoJson baseline: skipped, built without ArduinoJson\n");
+#endif
+  return 0;
+}
@@ -0,0 +1,54 @@
+// Serialization cost of the status reply: snprintf JSON versus the packed
+// binary frame.
+
+#include "bench_util.h"
+#include "protocol.h"
+
+#include <stdlib.h>
+
+static const int kSamples = 64;
+
+int main(int argc, char** argv) {
+  const uint64_t iterations = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000ULL;
+
+  StatusReport reports[kSamples];
+  for (int i = 0; i < kSamples; i++) {
+    StatusReport& st = reports[i];
+    st = StatusReport{};
+    st.clients = 1;
+    st.manualActive = (i & 1) != 0;
+    st.manualGear = (int8_t)((i % 3) - 1);
+    st.driveDir = (int8_t)(((i / 3) % 3) - 1);
+    st.driveSpeedPct = (uint8_t)(i % 101);
+    st.selectorFwd = (i & 2) != 0;
+    st.selectorBack = (i & 4) != 0;
+    st.selectorThrottleV = 0.5f + 0.037f * (float)i;
+    st.selectorThrottlePct = (uint8_t)(i % 101);
+    st.batteryV = 11.0f + 0.031f * (float)i;
+    st.uptimeMs = 123456u + (uint32_t)i * 100u;
+    st.rxCoalesced = (uint16_t)i;
+    st.batterySocPct = (uint8_t)(i % 101);
+    st.runtimeMin = (uint16_t)(30 + i);
+  }
+
+  char json[512];
+  uint8_t frame[STATUS_FRAME_LEN];
+  printf("reply bytes: binary=%u json=%u\n",
+         (unsigned)protocolEncodeStatusFrame(reports[0], frame, sizeof(frame)),
+         (unsigned)protocolFormatStatusJson(reports[0], json, sizeof(json)));
+
+  const BenchResult text = benchRun(iterations, [&](uint64_t i) {
+    const size_t n = protocolFormatStatusJson(reports[i % kSamples], json, sizeof(json));
+    benchKeep(n);
+    benchKeep(json);
+  });
+  benchReport("status json (snprintf)", text);
+
+  const BenchResult bin = benchRun(iterations, [&](uint64_t i) {
+    const size_t n = protocolEncodeStatusFrame(reports[i % kSamples], frame, sizeof(frame));
+    benchKeep(n);
+    benchKeep(frame);
+  });
+  benchReport("status binary frame", bin);
+  return 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// ===== Host benchmark helpers =====
+
+inline uint64_t benchNowNs() {
+  using namespace std::chrono;
+  return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Time-stamp counter where the CPU has one, nanoseconds otherwise.
+inline uint64_t benchCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return benchNowNs();
+#endif
+}
+
+// Keeps the optimizer from discarding a computed value.
+template <typename T>
+inline void benchKeep(const T& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct BenchResult {
+  uint64_t iterations;
+  uint64_t ns;
+  uint64_t cycles;
+};
+
+inline void benchReport(const char* name, const BenchResult& r) {
+  const double n = r.iterations ? (double)r.iterations : 1.0;
+  printf("%-28s %10llu iters  %9.1f ns/op  %9.1f cycles/op\n",
+         name,
+         (unsigned long long)r.iterations,
+         (double)r.ns / n,
+         (double)r.cycles / n);
+}
+
+// Runs fn() `iterations` times and returns wall time and cycle totals.
+template <typename Fn>
+inline BenchResult benchRun(uint64_t iterations, Fn fn) {
+  const uint64_t t0 = benchNowNs();
+  const uint64_t c0 = benchCycles();
+  for (uint64_t i = 0; i < iterations; i++) {
+    fn(i);
+  }
+  const uint64_t c1 = benchCycles();
+  const uint64_t t1 = benchNowNs();
+  return {iterations, t1 - t0, c1 - c0};
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include "protocol.h"
+
+// The ArduinoJson DOM parser that protocolParse replaced, kept on the host
+// as the baseline for benchmarks and differential fuzzing. Only built when
+// KIDCAR_HAVE_ARDUINOJSON is defined.
+bool protocolParseArduinoJson(const char* msg, ControlCommand& out);
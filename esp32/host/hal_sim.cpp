@@ -0,0 +1,281 @@
+#include "sim_hal.h"
+#include "hal.h"
+
+#include <chrono>
+#include <math.h>
+
+HostSerial Serial;
+
+static uint64_t gNowUs = 0;
+static uint8_t gDigitalOut[SIM_PIN_COUNT];
+static uint8_t gDigitalIn[SIM_PIN_COUNT];
+static uint16_t gAnalog[SIM_PIN_COUNT];
+// Pins chopped at a PWM rate: gAnalog during the on part of each period, 0
+// after it.
+struct SimChop {
+  bool active;
+  float dutyFrac;
+  uint32_t hz;
+};
+static SimChop gChop[SIM_PIN_COUNT];
+static uint32_t gLedcDuty[SIM_LEDC_CHANNELS];
+struct SimFade {
+  bool active;
+  uint32_t from;
+  uint32_t to;
+  uint64_t startUs;
+  uint64_t durUs;
+};
+static SimFade gFade[SIM_LEDC_CHANNELS];
+static SimRgb gRgb = {0, 0, 0};
+static SimHalCounters gCounters = {0, 0, 0, 0, 0, 0};
+static const int SIM_ADC_STREAM_MAX = 8;
+static uint8_t gStreamPins[SIM_ADC_STREAM_MAX];
+static uint8_t gStreamCount = 0;
+static uint64_t gStreamFrameUs = 0;
+static uint64_t gStreamNextUs = 0;
+static uint32_t gStreamHz = 0;
+static uint16_t gStreamSamplesPerPin = 0;
+static bool gPcntOn = false;
+static uint32_t gPcntCount = 0;
+static SimLedcHook gLedcHook = nullptr;
+
+static bool validPin(int pin) {
+  return pin >= 0 && pin < SIM_PIN_COUNT;
+}
+
+void simHalReset() {
+  gNowUs = 0;
+  for (int i = 0; i < SIM_PIN_COUNT; i++) {
+    gDigitalOut[i] = LOW;
+    gDigitalIn[i] = HIGH;
+    gAnalog[i] = 0;
+    gChop[i] = SimChop{false, 0.0f, 0};
+  }
+  for (int i = 0; i < SIM_LEDC_CHANNELS; i++) {
+    gLedcDuty[i] = 0;
+    gFade[i] = SimFade{false, 0, 0, 0, 0};
+  }
+  gRgb = {0, 0, 0};
+  gStreamCount = 0;
+  gPcntOn = false;
+  gPcntCount = 0;
+  gLedcHook = nullptr;
+  simHalResetCounters();
+}
+
+void simAdvanceUs(uint32_t us) {
+  gNowUs += us;
+}
+
+void simAdvanceMs(uint32_t ms) {
+  gNowUs += (uint64_t)ms * 1000ULL;
+}
+
+uint64_t simNowUs() {
+  return gNowUs;
+}
+
+void simSetDigitalIn(int pin, int level) {
+  if (validPin(pin)) gDigitalIn[pin] = level ? HIGH : LOW;
+}
+
+int simGetDigitalOut(int pin) {
+  return validPin(pin) ? gDigitalOut[pin] : LOW;
+}
+
+void simSetAnalogRaw(int pin, uint16_t raw) {
+  if (raw > 4095) raw = 4095;
+  if (!validPin(pin)) return;
+  gAnalog[pin] = raw;
+  gChop[pin].active = false;
+}
+
+static uint16_t mvToRaw(uint16_t mv) {
+  if (mv > 3300) mv = 3300;
+  return (uint16_t)(((uint32_t)mv * 4095U + 1650U) / 3300U);
+}
+
+void simSetAnalogMv(int pin, uint16_t mv) {
+  simSetAnalogRaw(pin, mvToRaw(mv));
+}
+
+void simSetAnalogPwmMv(int pin, uint16_t onMv, float dutyPct, uint32_t pwmHz) {
+  if (!validPin(pin)) return;
+  gAnalog[pin] = mvToRaw(onMv);
+  const float d = dutyPct < 0.0f ? 0.0f : (dutyPct > 100.0f ? 100.0f : dutyPct);
+  gChop[pin] = SimChop{pwmHz > 0, d / 100.0f, pwmHz};
+}
+
+// One conversion of `pin` at time tS (seconds).
+static uint16_t sampleAt(int pin, double tS) {
+  const SimChop& c = gChop[pin];
+  if (!c.active) return gAnalog[pin];
+  const double cycles = tS * (double)c.hz;
+  return (cycles - floor(cycles)) < (double)c.dutyFrac ? gAnalog[pin] : 0;
+}
+
+bool simAdcStreamRunning() {
+  return gStreamCount > 0;
+}
+
+static bool validChannel(int channel) {
+  return channel >= 0 && channel < SIM_LEDC_CHANNELS;
+}
+
+// Folds an active fade into gLedcDuty at the current time.
+static void settleFade(int channel) {
+  SimFade& f = gFade[channel];
+  if (!f.active) return;
+  const uint64_t elapsed = gNowUs - f.startUs;
+  if (elapsed >= f.durUs) {
+    gLedcDuty[channel] = f.to;
+    f.active = false;
+    return;
+  }
+  const int64_t span = (int64_t)f.to - (int64_t)f.from;
+  gLedcDuty[channel] = (uint32_t)((int64_t)f.from + span * (int64_t)elapsed / (int64_t)f.durUs);
+}
+
+uint32_t simGetLedcDuty(int channel) {
+  if (!validChannel(channel)) return 0;
+  settleFade(channel);
+  return gLedcDuty[channel];
+}
+
+SimRgb simGetRgb() {
+  return gRgb;
+}
+
+const SimHalCounters& simHalCounters() {
+  return gCounters;
+}
+
+void simPcntPulses(uint32_t n) {
+  if (gPcntOn) gPcntCount += n;
+}
+
+void simSetLedcHook(SimLedcHook hook) {
+  gLedcHook = hook;
+}
+
+void simHalResetCounters() {
+  gCounters = {0, 0, 0, 0, 0, 0};
+}
+
+// ----- hal.h backend -----
+
+uint32_t halMillis() {
+  return (uint32_t)(gNowUs / 1000ULL);
+}
+
+uint32_t halMicros() {
+  return (uint32_t)gNowUs;
+}
+
+uint32_t halCycles() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool halPcntBegin(int pin) {
+  if (!validPin(pin)) return false;
+  gPcntOn = true;
+  return true;
+}
+
+uint32_t halPcntCount() {
+  return gPcntCount;
+}
+
+void halDigitalWrite(int pin, int level) {
+  gCounters.digitalWrites++;
+  if (validPin(pin)) gDigitalOut[pin] = level ? HIGH : LOW;
+}
+
+int halDigitalRead(int pin) {
+  return validPin(pin) ? gDigitalIn[pin] : LOW;
+}
+
+int halAnalogRead(int pin) {
+  gCounters.analogReads++;
+  return validPin(pin) ? sampleAt(pin, (double)gNowUs * 1.0e-6) : 0;
+}
+
+void halLedcWrite(int channel, uint32_t duty) {
+  if (gLedcHook) gLedcHook(channel, duty);
+  gCounters.ledcWrites++;
+  if (!validChannel(channel)) return;
+  gFade[channel].active = false;
+  gLedcDuty[channel] = duty;
+}
+
+bool halLedcFade(int pin, int channel, uint32_t fromDuty, uint32_t toDuty, uint16_t ms) {
+  (void)pin;
+  if (gLedcHook) gLedcHook(channel, toDuty);
+  if (!validChannel(channel)) return false;
+  gCounters.ledcFades++;
+  gLedcDuty[channel] = fromDuty;
+  gFade[channel] = SimFade{true, fromDuty, toDuty, gNowUs, (uint64_t)ms * 1000ULL};
+  settleFade(channel);
+  return true;
+}
+
+bool halLedcFading(int channel) {
+  if (!validChannel(channel)) return false;
+  settleFade(channel);
+  return gFade[channel].active;
+}
+
+void halLedcFadeStop(int channel) {
+  if (!validChannel(channel)) return;
+  settleFade(channel);
+  gFade[channel].active = false;
+}
+
+void halRgbWrite(int pin, uint8_t r, uint8_t g, uint8_t b) {
+  (void)pin;
+  gCounters.rgbWrites++;
+  gRgb = {r, g, b};
+}
+
+bool halAdcStreamStart(const uint8_t* pins, uint8_t count, uint16_t samplesPerPin, uint32_t sampleHz) {
+  if (count == 0 || count > SIM_ADC_STREAM_MAX || samplesPerPin == 0 || sampleHz == 0) return false;
+  for (uint8_t i = 0; i < count; i++) {
+    if (!halAdcStreamCapable(pins[i])) return false;
+    gStreamPins[i] = pins[i];
+  }
+  gStreamCount = count;
+  gStreamHz = sampleHz;
+  gStreamSamplesPerPin = samplesPerPin;
+  gStreamFrameUs = ((uint64_t)count * samplesPerPin * 1000000ULL) / sampleHz;
+  if (gStreamFrameUs == 0) gStreamFrameUs = 1;
+  gStreamNextUs = gNowUs + gStreamFrameUs;
+  return true;
+}
+
+bool halAdcStreamRead(uint16_t* raw, uint8_t count) {
+  if (gStreamCount == 0 || gNowUs < gStreamNextUs) return false;
+  // Frames completed since the last read are overwritten by the newest one.
+  const uint64_t skipped = (gNowUs - gStreamNextUs) / gStreamFrameUs;
+  const uint64_t endUs = gStreamNextUs + skipped * gStreamFrameUs;
+  gStreamNextUs += (skipped + 1) * gStreamFrameUs;
+  gCounters.adcFrames++;
+  // The pins are converted in turn at gStreamHz; each result is the mean of
+  // that pin's conversions over the frame, as the driver reports it.
+  const uint32_t perFrame = (uint32_t)gStreamCount * gStreamSamplesPerPin;
+  const double startS = (double)endUs * 1.0e-6 - (double)perFrame / (double)gStreamHz;
+  for (uint8_t i = 0; i < count && i < gStreamCount; i++) {
+    const int pin = gStreamPins[i];
+    if (!gChop[pin].active) {
+      raw[i] = gAnalog[pin];
+      continue;
+    }
+    uint32_t sum = 0;
+    for (uint32_t k = i; k < perFrame; k += gStreamCount) {
+      sum += sampleAt(pin, startS + (double)k / (double)gStreamHz);
+    }
+    raw[i] = (uint16_t)((sum + gStreamSamplesPerPin / 2) / gStreamSamplesPerPin);
+  }
+  return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+// Minimal Arduino core surface for the host build. Only what the core
+// translation units use outside of hal.h lives here; board I/O goes through
+// the simulated backend in hal_sim.cpp.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define HIGH 0x1
+#define LOW  0x0
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// Serial mirror that writes to a stdio stream (stdout by default).
+// Benchmarks point it at nullptr to keep log output out of the timing.
+class HostSerial {
+public:
+  void setSink(FILE* sink) { sink_ = sink; }
+  FILE* sink() const { return sink_; }
+
+  void begin(unsigned long) {}
+  size_t print(const char* s) { return write(s); }
+  size_t println(const char* s = "") { return write(s) + write("\n"); }
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    if (sink_ == nullptr) return 0;
+    va_list args;
+    va_start(args, fmt);
+    const int n = vfprintf(sink_, fmt, args);
+    va_end(args);
+    return n > 0 ? (size_t)n : 0;
+  }
+
+private:
+  size_t write(const char* s) {
+    if (sink_ == nullptr) return 0;
+    return fputs(s, sink_) >= 0 ? strlen(s) : 0;
+  }
+
+  FILE* sink_ = stdout;
+};
+
+extern HostSerial Serial;
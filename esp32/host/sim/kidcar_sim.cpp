@@ -0,0 +1,122 @@
+// Virtual-time vehicle simulator: runs a scenario script against the real
+// control stack and the vehicle model, and writes or checks its trajectory.
+//
+//   kidcar_sim [options] <scenario.scn>
+//     --out <file>     write the trace there ("-", the default without
+//                      --check or --update, for stdout)
+//     --check          compare with the golden trace; exit 1 on a mismatch
+//     --update         record the golden trace
+//     --golden <file>  golden path (default: <scenario>.golden.csv)
+//     --repeat <n>     run n times; every run must give the same trace
+//     --log            firmware log to stderr
+//
+// A summary (packets, extremes, speed against real time) goes to stderr.
+
+#include "scenario.h"
+#include "trace.h"
+#include "bench_util.h"
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int usage() {
+  fprintf(stderr,
+          "usage: kidcar_sim [--out file] [--check | --update] [--golden file] [--repeat n] [--log] "
+          "<scenario.scn>\n");
+  return 2;
+}
+
+int main(int argc, char** argv) {
+  const char* script = nullptr;
+  const char* outPath = nullptr;
+  std::string goldenPath;
+  bool check = false;
+  bool update = false;
+  bool log = false;
+  int repeat = 1;
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    if (!strcmp(a, "--out") && i + 1 < argc) outPath = argv[++i];
+    else if (!strcmp(a, "--golden") && i + 1 < argc) goldenPath = argv[++i];
+    else if (!strcmp(a, "--repeat") && i + 1 < argc) repeat = atoi(argv[++i]);
+    else if (!strcmp(a, "--check")) check = true;
+    else if (!strcmp(a, "--update")) update = true;
+    else if (!strcmp(a, "--log")) log = true;
+    else if (a[0] != '-' && !script) script = a;
+    else return usage();
+  }
+  if (!script || repeat < 1 || (check && update)) return usage();
+  if (!outPath && !check && !update) outPath = "-";
+  if (goldenPath.empty()) {
+    goldenPath = script;
+    const size_t dot = goldenPath.rfind('.');
+    if (dot != std::string::npos && goldenPath.find('/', dot) == std::string::npos) goldenPath.resize(dot);
+    goldenPath += ".golden.csv";
+  }
+
+  Scenario scn;
+  std::string err;
+  if (!scenarioLoad(script, scn, err)) {
+    fprintf(stderr, "%s\n", err.c_str());
+    return 2;
+  }
+  Serial.setSink(log ? stderr : nullptr);
+
+  SimResult first;
+  SimResult run;
+  uint64_t ns = 0;
+  for (int i = 0; i < repeat; i++) {
+    const uint64_t t0 = benchNowNs();
+    scenarioRun(scn, i == 0 ? first : run);
+    ns += benchNowNs() - t0;
+    if (i > 0 && !traceIdentical(first.trace, run.trace)) {
+      fprintf(stderr, "%s: run %d differs from run 1 (not deterministic)\n", scn.name.c_str(), i + 1);
+      traceCompare(first.trace, run.trace, stderr, 5);
+      return 1;
+    }
+  }
+  const SimRunStats& st = first.stats;
+  const double wallMs = (double)ns / 1.0e6 / repeat;
+  fprintf(stderr,
+          "%s: %.1f s virtual in %.1f ms (%.0fx real time), packets sent=%lu lost=%lu applied=%lu rejected=%lu, "
+          "max %.0f mm/s, max %.1f A, min pack %.2f V\n",
+          scn.name.c_str(), scn.durationMs / 1000.0, wallMs, wallMs > 0.0 ? scn.durationMs / wallMs : 0.0,
+          (unsigned long)st.sent, (unsigned long)st.lost, (unsigned long)st.applied, (unsigned long)st.rejected,
+          st.maxSpeedMmps, st.maxMotorA, st.minPackV);
+
+  if (outPath) {
+    FILE* f = strcmp(outPath, "-") ? fopen(outPath, "w") : stdout;
+    if (!f) {
+      fprintf(stderr, "%s: cannot write\n", outPath);
+      return 2;
+    }
+    traceWrite(f, scn.name, first.trace);
+    if (f != stdout) fclose(f);
+  }
+  if (update) {
+    FILE* f = fopen(goldenPath.c_str(), "w");
+    if (!f) {
+      fprintf(stderr, "%s: cannot write\n", goldenPath.c_str());
+      return 2;
+    }
+    traceWrite(f, scn.name, first.trace);
+    fclose(f);
+    fprintf(stderr, "recorded %s (%zu rows)\n", goldenPath.c_str(), first.trace.size());
+  }
+  if (check) {
+    std::vector<SimSample> golden;
+    if (!traceRead(goldenPath.c_str(), golden, err)) {
+      fprintf(stderr, "%s\n", err.c_str());
+      return 1;
+    }
+    const TraceDiff d = traceCompare(golden, first.trace, stderr, 10);
+    if (d.mismatches) {
+      fprintf(stderr, "%s: %lu of %lu rows differ from %s, first at %lu ms\n", scn.name.c_str(),
+              (unsigned long)d.mismatches, (unsigned long)d.rows, goldenPath.c_str(), (unsigned long)d.firstMs);
+      return 1;
+    }
+    fprintf(stderr, "%s: %lu rows match %s\n", scn.name.c_str(), (unsigned long)d.rows, goldenPath.c_str());
+  }
+  return 0;
+}
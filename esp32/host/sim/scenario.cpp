@@ -0,0 +1,367 @@
+#include "scenario.h"
+#include "control.h"
+#include "cmd_guard.h"
+#include "net_queue.h"
+#include "telemetry.h"
+#include "motor_steer.h"
+#include "protocol.h"
+#include "sim_hal.h"
+#include "hal.h"
+#include "config.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ===== Script parsing =====
+struct OpName {
+  const char* word;
+  ScenarioOp op;
+  uint8_t args;  // numeric arguments (on/off counts as one)
+};
+
+static const OpName kOps[] = {
+  {"throttle", SCN_THROTTLE, 1},
+  {"steer", SCN_STEER, 1},
+  {"speed", SCN_SPEED, 1},
+  {"accel", SCN_ACCEL, 1},
+  {"reverse", SCN_REVERSE, 1},
+  {"park", SCN_PARK, 1},
+  {"manual", SCN_MANUAL, 1},
+  {"estop", SCN_ESTOP, 0},
+  {"release", SCN_RELEASE, 0},
+  {"pedal", SCN_PEDAL, 1},
+  {"pack", SCN_PACK, 2},
+  {"crr", SCN_CRR, 1},
+  {"curb", SCN_CURB, 1},
+  {"rack_speed", SCN_RACK_SPEED, 1},
+};
+
+static bool parseNumber(const char* tok, float& out) {
+  if (!tok) return false;
+  if (!strcmp(tok, "on")) {
+    out = 1.0f;
+    return true;
+  }
+  if (!strcmp(tok, "off")) {
+    out = 0.0f;
+    return true;
+  }
+  char* end = nullptr;
+  out = strtof(tok, &end);
+  return end != tok && *end == '\0';
+}
+
+static bool parseUint(const char* tok, uint32_t& out) {
+  if (!tok) return false;
+  char* end = nullptr;
+  const unsigned long v = strtoul(tok, &end, 10);
+  if (end == tok || *end != '\0') return false;
+  out = (uint32_t)v;
+  return true;
+}
+
+// Event words after `at <ms>`. Returns an error message or nullptr.
+static const char* parseEvent(char** tok, int n, ScenarioEvent& ev) {
+  ev.a = 0.0f;
+  ev.b = 0.0f;
+  if (n < 1) return "missing event";
+  if (!strcmp(tok[0], "app")) {
+    if (n < 2) return "app needs on, off, loss or latency";
+    if (!strcmp(tok[1], "on")) {
+      ev.op = SCN_APP_ON;
+      ev.a = 50.0f;
+      if (n > 2 && (!parseNumber(tok[2], ev.a) || ev.a < 1.0f)) return "bad app period";
+      return nullptr;
+    }
+    if (!strcmp(tok[1], "off")) {
+      ev.op = SCN_APP_OFF;
+      return nullptr;
+    }
+    if (!strcmp(tok[1], "loss")) {
+      ev.op = SCN_APP_LOSS;
+      if (n < 3 || !parseNumber(tok[2], ev.a) || ev.a < 0.0f || ev.a > 100.0f) return "bad loss %";
+      return nullptr;
+    }
+    if (!strcmp(tok[1], "latency")) {
+      ev.op = SCN_APP_LATENCY;
+      if (n < 3 || !parseNumber(tok[2], ev.a) || ev.a < 0.0f) return "bad latency";
+      if (n > 3 && (!parseNumber(tok[3], ev.b) || ev.b < 0.0f)) return "bad jitter";
+      return nullptr;
+    }
+    return "app needs on, off, loss or latency";
+  }
+  if (!strcmp(tok[0], "selector")) {
+    ev.op = SCN_SELECTOR;
+    if (n < 2) return "selector needs fwd, back, neutral or fault";
+    if (!strcmp(tok[1], "fwd")) ev.a = 1.0f;
+    else if (!strcmp(tok[1], "back")) ev.a = -1.0f;
+    else if (!strcmp(tok[1], "neutral")) ev.a = 0.0f;
+    else if (!strcmp(tok[1], "fault")) ev.a = 2.0f;
+    else return "selector needs fwd, back, neutral or fault";
+    return nullptr;
+  }
+  for (const OpName& o : kOps) {
+    if (strcmp(tok[0], o.word)) continue;
+    ev.op = o.op;
+    if (n != 1 + o.args) return "wrong number of arguments";
+    if (o.args > 0 && !parseNumber(tok[1], ev.a)) return "bad number";
+    if (o.args > 1 && !parseNumber(tok[2], ev.b)) return "bad number";
+    return nullptr;
+  }
+  return "unknown event";
+}
+
+bool scenarioLoad(const char* path, Scenario& out, std::string& err) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    err = std::string(path) + ": cannot open";
+    return false;
+  }
+  out = Scenario{};
+  out.sampleMs = 20;
+  out.seed = 1;
+  const char* base = strrchr(path, '/');
+  out.name = base ? base + 1 : path;
+  const size_t dot = out.name.rfind('.');
+  if (dot != std::string::npos) out.name.resize(dot);
+
+  char line[256];
+  int lineNo = 0;
+  const char* msg = nullptr;
+  while (!msg && fgets(line, sizeof(line), f)) {
+    lineNo++;
+    char* hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    char* tok[8];
+    int n = 0;
+    for (char* t = strtok(line, " \t\r\n"); t && n < 8; t = strtok(nullptr, " \t\r\n")) tok[n++] = t;
+    if (n == 0) continue;
+    if (!strcmp(tok[0], "duration")) {
+      if (n != 2 || !parseUint(tok[1], out.durationMs) || out.durationMs == 0) msg = "bad duration";
+    } else if (!strcmp(tok[0], "sample")) {
+      if (n != 2 || !parseUint(tok[1], out.sampleMs) || out.sampleMs == 0) msg = "bad sample interval";
+    } else if (!strcmp(tok[0], "seed")) {
+      if (n != 2 || !parseUint(tok[1], out.seed)) msg = "bad seed";
+    } else if (!strcmp(tok[0], "at")) {
+      ScenarioEvent ev = {};
+      if (n < 3 || !parseUint(tok[1], ev.atMs)) msg = "bad event time";
+      else msg = parseEvent(tok + 2, n - 2, ev);
+      if (!msg) out.events.push_back(ev);
+    } else {
+      msg = "expected duration, sample, seed or at";
+    }
+  }
+  fclose(f);
+  if (!msg && out.durationMs == 0) {
+    msg = "no duration";
+    lineNo = 0;
+  }
+  if (msg) {
+    err = std::string(path) + ":" + std::to_string(lineNo) + ": " + msg;
+    return false;
+  }
+  std::stable_sort(out.events.begin(), out.events.end(),
+                   [](const ScenarioEvent& x, const ScenarioEvent& y) { return x.atMs < y.atMs; });
+  return true;
+}
+
+// ===== Runner =====
+// The app as the firmware sees it: a stream of binary command frames over a
+// lossy, delayed link.
+struct Datagram {
+  uint32_t arriveMs;
+  uint32_t order;  // send order, breaks arrival ties
+  uint8_t data[CMD_FRAME_LEN];
+  size_t len;
+};
+
+struct AppModel {
+  bool on;
+  uint32_t periodMs;
+  uint32_t nextSendMs;
+  float lossPct;
+  uint32_t latencyMs;
+  uint32_t jitterMs;
+  ControlCommand cmd;
+  std::vector<Datagram> inFlight;
+  uint32_t sendCount;
+};
+
+static uint32_t gRand = 1;
+static uint32_t rnd() {
+  gRand = gRand * 1664525u + 1013904223u;
+  return gRand >> 8;
+}
+
+static void resetApp(AppModel& app) {
+  app.on = false;
+  app.periodMs = 50;
+  app.nextSendMs = 0;
+  app.lossPct = 0.0f;
+  app.latencyMs = 0;
+  app.jitterMs = 0;
+  app.cmd = ControlCommand{0, 0, 0, 100, REAR_RAMP_MS, false, false, 50, true, true, 0, true, 0, true};
+  app.inFlight.clear();
+  app.sendCount = 0;
+}
+
+static void applyEvent(const ScenarioEvent& ev, AppModel& app) {
+  VehicleParams& vp = vehicleParams();
+  switch (ev.op) {
+    case SCN_APP_ON:
+      if (!app.on) app.nextSendMs = ev.atMs;
+      app.on = true;
+      app.periodMs = (uint32_t)ev.a;
+      break;
+    case SCN_APP_OFF: app.on = false; break;
+    case SCN_APP_LOSS: app.lossPct = ev.a; break;
+    case SCN_APP_LATENCY:
+      app.latencyMs = (uint32_t)ev.a;
+      app.jitterMs = (uint32_t)ev.b;
+      break;
+    case SCN_THROTTLE: app.cmd.throttle = (int)ev.a; break;
+    case SCN_STEER: app.cmd.steer = (int)ev.a; break;
+    case SCN_SPEED: app.cmd.speed = (int)ev.a; break;
+    case SCN_ACCEL: app.cmd.accelMs = (uint16_t)ev.a; break;
+    case SCN_REVERSE: app.cmd.reverseSpeed = (uint8_t)ev.a; break;
+    case SCN_PARK: app.cmd.park = ev.a != 0.0f; break;
+    case SCN_MANUAL: app.cmd.manualMode = ev.a != 0.0f; break;
+    case SCN_ESTOP:
+    case SCN_RELEASE: {
+      // Through the frame codec, as the e-stop socket task receives it.
+      uint8_t frame[ESTOP_FRAME_LEN];
+      uint8_t action = 0;
+      const size_t len = protocolEncodeEstop(ev.op == SCN_ESTOP ? ESTOP_ACTION_STOP : ESTOP_ACTION_RELEASE, frame,
+                                             sizeof(frame));
+      if (protocolDecodeEstop(frame, len, action)) {
+        if (action == ESTOP_ACTION_STOP) controlEstop(halMicros());
+        else controlEstopRelease();
+      }
+      break;
+    }
+    case SCN_SELECTOR: vehicleSetSelector(ev.a == 1.0f || ev.a == 2.0f, ev.a == -1.0f || ev.a == 2.0f); break;
+    case SCN_PEDAL: vehicleSetPedalV(ev.a); break;
+    case SCN_PACK:
+      vp.packOcvV = ev.a;
+      vp.packROhm = ev.b;
+      break;
+    case SCN_CRR: vp.crr = ev.a; break;
+    case SCN_CURB: vp.blocked = ev.a != 0.0f; break;
+    case SCN_RACK_SPEED: vp.rackSpeed = ev.a; break;
+  }
+}
+
+static void sendCommand(AppModel& app, uint32_t nowMs, SimRunStats& stats) {
+  app.cmd.seq = (uint16_t)app.sendCount;
+  app.cmd.sentMs = nowMs;
+  Datagram d;
+  d.arriveMs = nowMs + app.latencyMs + (app.jitterMs ? rnd() % (app.jitterMs + 1) : 0);
+  d.order = app.sendCount++;
+  d.len = protocolEncodeFrame(app.cmd, d.data, sizeof(d.data));
+  stats.sent++;
+  if ((float)(rnd() % 10000) < app.lossPct * 100.0f) {
+    stats.lost++;
+    return;
+  }
+  app.inFlight.push_back(d);
+}
+
+// Everything that has arrived by now, drained in one go as wifiApLoop does:
+// each frame decoded and guarded, only the newest accepted one pushed.
+static void deliver(AppModel& app, uint32_t nowMs, SimRunStats& stats) {
+  std::vector<Datagram> burst;
+  for (size_t i = 0; i < app.inFlight.size();) {
+    if (app.inFlight[i].arriveMs <= nowMs) {
+      burst.push_back(app.inFlight[i]);
+      app.inFlight.erase(app.inFlight.begin() + (long)i);
+    } else {
+      i++;
+    }
+  }
+  if (burst.empty()) return;
+  std::sort(burst.begin(), burst.end(), [](const Datagram& x, const Datagram& y) {
+    return x.arriveMs != y.arriveMs ? x.arriveMs < y.arriveMs : x.order < y.order;
+  });
+  ControlCommand latest;
+  bool good = false;
+  for (const Datagram& d : burst) {
+    stats.delivered++;
+    ControlCommand cmd;
+    if (protocolDecodeFrame(d.data, d.len, cmd) && cmdGuardAccept(cmd, halMillis())) {
+      latest = cmd;
+      good = true;
+    } else {
+      stats.rejected++;
+    }
+  }
+  if (good) {
+    stats.applied++;
+    netQueuePush(NetMsg{NET_MSG_COMMAND, latest});
+  } else {
+    netQueuePush(NetMsg{NET_MSG_ACTIVITY, ControlCommand()});
+  }
+}
+
+static SimSample sample(uint32_t ms) {
+  TelemetrySnapshot snap;
+  telemetryRead(snap);
+  const VehicleState& v = vehicleGetState();
+  SimSample s;
+  s.ms = ms;
+  s.mode = snap.mode;
+  s.link = snap.linkStage;
+  s.relay = snap.relayOn;
+  s.contacts = v.contacts;
+  s.dutyPct = v.contacts ? v.dutyPct : 0.0f;
+  s.speedMmps = v.speedMps * 1000.0f;
+  s.packV = v.packV;
+  s.motorA = v.motorA;
+  s.rackPct = v.rackPct;
+  s.steerEstPct = steerGetState().positionPct;
+  s.powerLimitPct = snap.powerLimitPct;
+  s.currentLimited = snap.currentLimited;
+  s.relayDrops = v.relayDrops;
+  return s;
+}
+
+void scenarioRun(const Scenario& scn, SimResult& out) {
+  out.trace.clear();
+  out.stats = SimRunStats{0, 0, 0, 0, 0, 0.0f, 1.0e9f, 0.0f};
+  gRand = scn.seed;
+  AppModel app;
+  resetApp(app);
+
+  simHalReset();
+  simAdvanceMs(1);
+  NetMsg stale;
+  while (netQueuePop(stale)) {
+  }
+  cmdGuardReset();
+  vehicleReset(vehicleDefaultParams());
+  size_t next = 0;
+  for (; next < scn.events.size() && scn.events[next].atMs == 0; next++) applyEvent(scn.events[next], app);
+  vehicleStep(0);
+  controlInit();
+  out.trace.push_back(sample(0));
+
+  for (uint32_t ms = 0; ms < scn.durationMs; ms++) {
+    for (; next < scn.events.size() && scn.events[next].atMs <= ms; next++) applyEvent(scn.events[next], app);
+    if (app.on && ms >= app.nextSendMs) {
+      sendCommand(app, ms, out.stats);
+      app.nextSendMs = ms + app.periodMs;
+    }
+    deliver(app, ms, out.stats);
+    simAdvanceMs(1);
+    controlLoop();
+    vehicleStep(1000);
+
+    const VehicleState& v = vehicleGetState();
+    const float mmps = fabsf(v.speedMps) * 1000.0f;
+    if (mmps > out.stats.maxSpeedMmps) out.stats.maxSpeedMmps = mmps;
+    if (v.packV < out.stats.minPackV) out.stats.minPackV = v.packV;
+    if (fabsf(v.motorA) > out.stats.maxMotorA) out.stats.maxMotorA = fabsf(v.motorA);
+    if ((ms + 1) % scn.sampleMs == 0) out.trace.push_back(sample(ms + 1));
+  }
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include "vehicle_model.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// ===== Scripted scenarios =====
+// A scenario is a text script: setup lines, then timed events, one per line,
+// `#` starts a comment.
+//
+//   duration <ms>              run length (required)
+//   sample <ms>                trace interval (default 20)
+//   seed <n>                   network RNG seed (default 1)
+//   at <ms> <event>            event applied at that virtual time; events at
+//                              0 are applied before power-up
+//
+// Events:
+//   app on [period_ms]         the app starts sending (default every 50 ms)
+//   app off                    the app goes silent
+//   app loss <pct>             datagrams dropped at random
+//   app latency <ms> [jitter]  one-way delay, plus 0..jitter ms at random
+//                              (jitter above the period reorders)
+//   throttle <-100..100>       app command fields
+//   steer <-100..100>          absolute steering target
+//   speed <0..100>
+//   accel <ms>
+//   reverse <0..100>
+//   park on|off
+//   manual on|off              app hands over to the pedal
+//   estop | release            e-stop frame, through the e-stop decoder
+//   selector fwd|back|neutral|fault
+//   pedal <V>                  throttle pin, 3.0 released .. 0.0 full
+//   pack <ocv_V> <r_ohm>       battery (swap, cold, tired)
+//   crr <c>                    surface rolling resistance
+//   curb on|off                wheels blocked
+//   rack_speed <f>             real steering rate / configured rate
+
+enum ScenarioOp : uint8_t {
+  SCN_APP_ON = 0,
+  SCN_APP_OFF,
+  SCN_APP_LOSS,
+  SCN_APP_LATENCY,
+  SCN_THROTTLE,
+  SCN_STEER,
+  SCN_SPEED,
+  SCN_ACCEL,
+  SCN_REVERSE,
+  SCN_PARK,
+  SCN_MANUAL,
+  SCN_ESTOP,
+  SCN_RELEASE,
+  SCN_SELECTOR,  // a: 0 neutral, 1 fwd, -1 back, 2 fault (both)
+  SCN_PEDAL,
+  SCN_PACK,
+  SCN_CRR,
+  SCN_CURB,
+  SCN_RACK_SPEED,
+};
+
+struct ScenarioEvent {
+  uint32_t atMs;
+  ScenarioOp op;
+  float a;
+  float b;
+};
+
+struct Scenario {
+  std::string name;
+  uint32_t durationMs;
+  uint32_t sampleMs;
+  uint32_t seed;
+  std::vector<ScenarioEvent> events; // ordered by time, then script order
+};
+
+// False with a "file:line: message" in `err` on a bad script.
+bool scenarioLoad(const char* path, Scenario& out, std::string& err);
+
+// ===== Runner =====
+// Powers up the firmware (controlInit) against the vehicle model and runs it
+// in 1 ms virtual steps: events, app datagrams through the real decoders,
+// command guard and net queue (as wifi_ap does, minus the socket),
+// controlLoop, then the plant. Deterministic: the same scenario gives the
+// same trace on every run.
+
+struct SimSample {
+  uint32_t ms;
+  uint8_t mode;        // ControlMode
+  uint8_t link;        // LinkStage
+  bool relay;          // coil driven
+  bool contacts;       // contacts closed
+  float dutyPct;       // signed bridge duty
+  float speedMmps;     // signed
+  float packV;
+  float motorA;
+  float rackPct;       // real rack
+  float steerEstPct;   // firmware estimate
+  uint8_t powerLimitPct;
+  bool currentLimited;
+  uint32_t relayDrops;
+};
+
+struct SimRunStats {
+  uint32_t sent;       // command datagrams
+  uint32_t lost;
+  uint32_t delivered;
+  uint32_t applied;    // passed the guard and pushed (newest per drain)
+  uint32_t rejected;   // decoder or guard
+  float maxSpeedMmps;
+  float minPackV;
+  float maxMotorA;
+};
+
+struct SimResult {
+  std::vector<SimSample> trace;
+  SimRunStats stats;
+};
+
+void scenarioRun(const Scenario& scn, SimResult& out);
@@ -0,0 +1,148 @@
+#include "trace.h"
+
+#include <math.h>
+#include <string.h>
+
+static const char* kHeader =
+  "t_ms,mode,link,relay,contacts,duty_pct,speed_mmps,pack_v,motor_a,rack_pct,steer_est_pct,power_limit,i_limit,relay_drops";
+
+// Analog tolerances (absolute).
+static const float TOL_DUTY_PCT = 0.5f;
+static const float TOL_SPEED_MMPS = 5.0f;
+static const float TOL_PACK_V = 0.02f;
+static const float TOL_MOTOR_A = 0.3f;
+static const float TOL_RACK_PCT = 0.5f;
+static const float TOL_POWER_LIMIT_PCT = 1.0f;
+
+void traceWrite(FILE* f, const std::string& scenario, const std::vector<SimSample>& trace) {
+  fprintf(f, "# kidcar_sim trace: %s\n%s\n", scenario.c_str(), kHeader);
+  for (const SimSample& s : trace) {
+    fprintf(f, "%lu,%u,%u,%d,%d,%.1f,%.0f,%.3f,%.2f,%.1f,%.1f,%u,%d,%lu\n", (unsigned long)s.ms, (unsigned)s.mode,
+            (unsigned)s.link, s.relay ? 1 : 0, s.contacts ? 1 : 0, s.dutyPct, s.speedMmps, s.packV, s.motorA,
+            s.rackPct, s.steerEstPct, (unsigned)s.powerLimitPct, s.currentLimited ? 1 : 0,
+            (unsigned long)s.relayDrops);
+  }
+}
+
+bool traceRead(const char* path, std::vector<SimSample>& out, std::string& err) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    err = std::string(path) + ": cannot open (record it with --update)";
+    return false;
+  }
+  out.clear();
+  char line[512];
+  bool header = false;
+  int lineNo = 0;
+  while (fgets(line, sizeof(line), f)) {
+    lineNo++;
+    if (line[0] == '#') continue;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (!header) {
+      if (strcmp(line, kHeader)) {
+        err = std::string(path) + ": trace columns differ from this build (re-record with --update)";
+        fclose(f);
+        return false;
+      }
+      header = true;
+      continue;
+    }
+    unsigned long ms = 0, drops = 0;
+    unsigned mode = 0, link = 0, limit = 0;
+    int relay = 0, contacts = 0, ilim = 0;
+    SimSample s = {};
+    if (sscanf(line, "%lu,%u,%u,%d,%d,%f,%f,%f,%f,%f,%f,%u,%d,%lu", &ms, &mode, &link, &relay, &contacts,
+               &s.dutyPct, &s.speedMmps, &s.packV, &s.motorA, &s.rackPct, &s.steerEstPct, &limit, &ilim,
+               &drops) != 14) {
+      err = std::string(path) + ":" + std::to_string(lineNo) + ": bad row";
+      fclose(f);
+      return false;
+    }
+    s.ms = (uint32_t)ms;
+    s.mode = (uint8_t)mode;
+    s.link = (uint8_t)link;
+    s.relay = relay != 0;
+    s.contacts = contacts != 0;
+    s.powerLimitPct = (uint8_t)limit;
+    s.currentLimited = ilim != 0;
+    s.relayDrops = (uint32_t)drops;
+    out.push_back(s);
+  }
+  fclose(f);
+  if (!header) {
+    err = std::string(path) + ": empty trace";
+    return false;
+  }
+  return true;
+}
+
+// Golden values went through the CSV's rounding; compare against the actual
+// value rounded the same way.
+static float rounded(float v, float scale) {
+  return roundf(v * scale) / scale;
+}
+
+TraceDiff traceCompare(const std::vector<SimSample>& golden, const std::vector<SimSample>& actual, FILE* report,
+                       uint32_t maxReport) {
+  TraceDiff d = {0, 0, 0};
+  uint32_t reported = 0;
+  bool rowSeen = false;
+  if (golden.size() != actual.size()) {
+    if (report) fprintf(report, "length: golden %zu rows, actual %zu rows\n", golden.size(), actual.size());
+    d.mismatches++;
+  }
+  const size_t n = golden.size() < actual.size() ? golden.size() : actual.size();
+  for (size_t i = 0; i < n; i++) {
+    const SimSample& g = golden[i];
+    const SimSample& a = actual[i];
+    d.rows++;
+    char why[160];
+    why[0] = '\0';
+#define EXACT(field)                                                                                        \
+  if (!why[0] && g.field != a.field)                                                                         \
+    snprintf(why, sizeof(why), #field " %lu != %lu", (unsigned long)g.field, (unsigned long)a.field)
+#define NEAR(field, tol, scale)                                                                             \
+  if (!why[0] && fabsf((float)g.field - rounded((float)a.field, scale)) > (tol))                             \
+    snprintf(why, sizeof(why), #field " %.3f != %.3f (tol %.3f)", (double)g.field, (double)a.field, (double)(tol))
+    EXACT(ms);
+    EXACT(mode);
+    EXACT(link);
+    EXACT(relay);
+    EXACT(contacts);
+    EXACT(currentLimited);
+    EXACT(relayDrops);
+    NEAR(dutyPct, TOL_DUTY_PCT, 10.0f);
+    NEAR(speedMmps, TOL_SPEED_MMPS, 1.0f);
+    NEAR(packV, TOL_PACK_V, 1000.0f);
+    NEAR(motorA, TOL_MOTOR_A, 100.0f);
+    NEAR(rackPct, TOL_RACK_PCT, 10.0f);
+    NEAR(steerEstPct, TOL_RACK_PCT, 10.0f);
+    NEAR(powerLimitPct, TOL_POWER_LIMIT_PCT, 1.0f);
+#undef EXACT
+#undef NEAR
+    if (!why[0]) continue;
+    if (!rowSeen) d.firstMs = g.ms;
+    rowSeen = true;
+    d.mismatches++;
+    if (report && reported < maxReport) {
+      fprintf(report, "t=%lu ms: %s\n", (unsigned long)g.ms, why);
+      reported++;
+    }
+  }
+  return d;
+}
+
+bool traceIdentical(const std::vector<SimSample>& a, const std::vector<SimSample>& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    const SimSample& x = a[i];
+    const SimSample& y = b[i];
+    if (x.ms != y.ms || x.mode != y.mode || x.link != y.link || x.relay != y.relay || x.contacts != y.contacts ||
+        x.dutyPct != y.dutyPct || x.speedMmps != y.speedMmps || x.packV != y.packV || x.motorA != y.motorA ||
+        x.rackPct != y.rackPct || x.steerEstPct != y.steerEstPct || x.powerLimitPct != y.powerLimitPct ||
+        x.currentLimited != y.currentLimited || x.relayDrops != y.relayDrops) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "scenario.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// ===== Trajectory files =====
+// A trace is CSV, one row per sample, after a `#` comment naming the
+// scenario. Golden traces live next to the scripts (<name>.golden.csv) and
+// are compared column by column: discrete columns (mode, link stage, relay,
+// flags, counters) must match exactly, analog ones within a tolerance that
+// absorbs float differences between compilers but not a changed response.
+
+void traceWrite(FILE* f, const std::string& scenario, const std::vector<SimSample>& trace);
+// False with a message in `err` on a missing file or a header that does not
+// match this build's columns (re-record with --update).
+bool traceRead(const char* path, std::vector<SimSample>& out, std::string& err);
+
+struct TraceDiff {
+  uint32_t rows;        // rows compared
+  uint32_t mismatches;  // rows with any column out of tolerance
+  uint32_t firstMs;     // time of the first mismatching row
+};
+
+// Prints up to `maxReport` mismatching rows (column, golden, actual) to `report`.
+TraceDiff traceCompare(const std::vector<SimSample>& golden, const std::vector<SimSample>& actual, FILE* report,
+                       uint32_t maxReport);
+// Bit-for-bit equality, for the determinism check.
+bool traceIdentical(const std::vector<SimSample>& a, const std::vector<SimSample>& b);
@@ -0,0 +1,137 @@
+#include "vehicle_model.h"
+#include "sim_hal.h"
+#include "config.h"
+#include "pins.h"
+
+#include <math.h>
+
+// Rear motors (both, in parallel) and drivetrain.
+static const float MOTOR_K = 0.012f;      // V·s/rad, N·m/A
+static const float GEAR = 60.0f;
+static const float WHEEL_R_M = 0.14f;
+static const float IDLE_A = 0.5f;         // ESP, relay coil, LED
+static const float STEER_RUN_A = 2.0f;
+static const float STEER_STALL_A = 4.0f;
+static const float GRAVITY = 9.81f;
+static const float BATTERY_DIVIDER = 122.0f / 22.0f;
+
+static VehicleParams params = {};
+static VehicleState state = {};
+static float pulseFrac = 0.0f;
+
+VehicleParams vehicleDefaultParams() {
+  return VehicleParams{12.7f, 0.05f, 50.0f, 0.015f, false, 1.0f, 0.0f, 0.15f, true, true};
+}
+
+// onA flows through the high side for onPct of each PWM period.
+static void writeSensors(float onA, float onPct) {
+  const float pinMv = state.packV / BATTERY_DIVIDER / BATTERY_VOLT_CAL_FACTOR * 1000.0f;
+  simSetAnalogMv(PIN_BATTERY_FB, pinMv <= 0.0f ? 0 : (pinMv >= 3300.0f ? 3300 : (uint16_t)(pinMv + 0.5f)));
+  const float isMv = onA / CURRENT_SENSE_RATIO * CURRENT_SENSE_R_OHM * 1000.0f;
+  simSetAnalogPwmMv(PIN_BTS_IS, isMv >= 3300.0f ? 3300 : (uint16_t)(isMv + 0.5f), onPct, PWM_FREQ);
+}
+
+void vehicleReset(const VehicleParams& p) {
+  params = p;
+  state = VehicleState{};
+  state.packV = p.packOcvV - IDLE_A * p.packROhm;
+  state.rackPct = p.rackPos;
+  pulseFrac = 0.0f;
+  vehicleSetSelector(false, false);
+  vehicleSetPedalV(3.0f);
+  writeSensors(0.0f, 0.0f);
+}
+
+VehicleParams& vehicleParams() {
+  return params;
+}
+
+void vehicleSetSelector(bool fwd, bool back) {
+  simSetDigitalIn(PIN_MANUAL_FWD, fwd ? LOW : HIGH);   // active-low
+  simSetDigitalIn(PIN_MANUAL_BACK, back ? LOW : HIGH);
+}
+
+void vehicleSetPedalV(float pedalV) {
+  const float mv = pedalV * 1000.0f;
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, mv <= 0.0f ? 0 : (uint16_t)(mv + 0.5f));
+}
+
+// Rack position, % of half travel; returns the steering motor current.
+static float stepRack(float dtS) {
+  const int in1 = simGetDigitalOut(PIN_L298_IN1);
+  const int in2 = simGetDigitalOut(PIN_L298_IN2);
+  const int d = (in1 && !in2) ? 1 : ((in2 && !in1) ? -1 : 0);
+  if (d == 0 || !state.contacts) return 0.0f;
+  const float pctPerS = 100.0f * 1000.0f / (STEER_TRAVEL_MS / 2.0f) * params.rackSpeed;
+  const float next = state.rackPct + d * pctPerS * dtS;
+  if (next > 100.0f || next < -100.0f) {
+    state.rackPct = next > 0.0f ? 100.0f : -100.0f;
+    state.rackStallMs += (uint32_t)(dtS * 1000.0f + 0.5f);
+    return STEER_STALL_A;
+  }
+  state.rackPct = next;
+  return STEER_RUN_A;
+}
+
+void vehicleStep(uint32_t dtUs) {
+  const float dtS = (float)dtUs / 1.0e6f;
+  const float maxDuty = (float)((1 << PWM_RES) - 1);
+  const float duty = ((float)simGetLedcDuty(CH_BTS_R) - (float)simGetLedcDuty(CH_BTS_L)) / maxDuty;
+  const bool coil = simGetDigitalOut(PIN_RELAY_EN) == HIGH;
+
+  // Contacts: follow the coil, with drop-out and pull-in on the pack voltage
+  // seen at the last step.
+  if (!params.relayFitted) {
+    state.contacts = true;
+  } else if (!coil) {
+    state.contacts = false;
+  } else if (state.contacts && state.packV < VEHICLE_RELAY_DROP_V) {
+    state.contacts = false;
+    state.relayDrops++;
+  } else if (!state.contacts && state.packV >= VEHICLE_RELAY_PULL_V) {
+    state.contacts = true;
+  }
+
+  state.steerA = stepRack(dtS);
+  const float emf = MOTOR_K * state.speedMps / WHEEL_R_M * GEAR;
+  const float d = state.contacts ? duty : 0.0f;
+  const float r = params.packROhm;
+  const float rm = params.motorROhm;
+  // packV = ocv - r * (d * motorA + other), motorA = (d * packV - emf) / rm
+  const float other = IDLE_A + state.steerA;
+  state.packV = (params.packOcvV + r * d * emf / rm - r * other) / (1.0f + r * d * d / rm);
+  // Bridge off (relay open): no drive current, the wheels turn the motors freely.
+  state.motorA = state.contacts ? (d * state.packV - emf) / rm : 0.0f;
+  state.dutyPct = d * 100.0f;
+  // IS sees the high side only: the motor current during the on part of
+  // each PWM period, none while braking.
+  const bool driving = state.motorA * d > 0.0f;
+  writeSensors(driving ? fabsf(state.motorA) : 0.0f, driving ? fabsf(d) * 100.0f : 0.0f);
+
+  if (params.blocked) {
+    state.speedMps = 0.0f;
+    return;
+  }
+  const float v = state.speedMps;
+  const float force = MOTOR_K * state.motorA * GEAR / WHEEL_R_M;
+  const float roll = params.crr * params.massKg * GRAVITY;
+  if (v != 0.0f || fabsf(force) > roll) {
+    const float dir = v != 0.0f ? (v > 0.0f ? 1.0f : -1.0f) : (force > 0.0f ? 1.0f : -1.0f);
+    const float next = v + (force - dir * roll) / params.massKg * dtS;
+    state.speedMps = (v != 0.0f && next * v < 0.0f) ? 0.0f : next;
+  }
+
+  // Single-channel encoder: pulses without direction.
+  const float travelled = fabsf(state.speedMps) * dtS;
+  state.distanceM += travelled;
+  pulseFrac += travelled * WHEEL_PULSES_PER_M;
+  if (pulseFrac >= 1.0f) {
+    const uint32_t n = (uint32_t)pulseFrac;
+    if (params.encoderOk) simPcntPulses(n);
+    pulseFrac -= (float)n;
+  }
+}
+
+const VehicleState& vehicleGetState() {
+  return state;
+}
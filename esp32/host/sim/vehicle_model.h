@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+
+// ===== Vehicle plant =====
+// Closes the loop around the simulated board (sim_hal.h): every step reads
+// what the firmware drives (relay coil, BTS7960 PWM, L298N direction pins)
+// and writes back what the car's sensors would see (battery divider, IS
+// pins, wheel encoder, manual pedal and selector). Shared by the simulator
+// and the motor tests (speed loop, current limit, derating).
+//
+// - Pack: open-circuit voltage behind an internal resistance, loaded by the
+//   rear motors, the steering motor and an idle draw.
+// - Relay: contacts follow the coil, but drop out when the pack sags below
+//   VEHICLE_RELAY_DROP_V and pull in again above VEHICLE_RELAY_PULL_V.
+//   Both drivers are supplied through it, unless `relayFitted` is off
+//   (tests that drive the bridge without the control loop).
+// - Rear: two PM motors on the synchronous BTS7960 bridge, 1:60 gearbox,
+//   0.14 m wheels, rolling resistance; a blocked car (curb) does not move.
+//   IS carries the motor current during the on part of each PWM period.
+// - Encoder: single channel, WHEEL_PULSES_PER_M; `encoderOk` off loses it.
+// - Steering: the rack moves at `rackSpeed` of the configured rate while the
+//   L298N drives it and stops hard at the ends (test_steer's model).
+// - Driver: pedal voltage and selector switches as set by the scenario.
+
+struct VehicleParams {
+  float packOcvV;
+  float packROhm;
+  float massKg;
+  float crr;        // rolling resistance coefficient (0.015 floor, 0.08 grass)
+  bool blocked;     // wheels held (curb)
+  float rackSpeed;  // real rack rate / configured rate
+  float rackPos;    // start position, % of half travel (-100..100)
+  float motorROhm;  // both rear motors in parallel, winding + brushes
+  bool relayFitted;
+  bool encoderOk;
+};
+
+struct VehicleState {
+  float packV;      // terminal voltage
+  float motorA;     // rear motor current (signed, both motors)
+  float steerA;
+  float dutyPct;    // signed bridge duty, R positive
+  float speedMps;   // signed
+  float distanceM;
+  float rackPct;    // real rack position, % of half travel
+  bool contacts;    // relay contacts closed
+  uint32_t relayDrops; // contact drop-outs from pack sag
+  uint32_t rackStallMs; // steering driven into an end stop
+};
+
+static const float VEHICLE_RELAY_DROP_V = 7.0f;
+static const float VEHICLE_RELAY_PULL_V = 8.5f;
+
+// Defaults: fresh 12 V lead-acid pack, 50 kg on a hard floor, rack as fast
+// as configured and centred, relay and encoder working.
+VehicleParams vehicleDefaultParams();
+// Sets the parameters and a standstill, and writes the sensor inputs once
+// (selector neutral, pedal idle), so the firmware can be initialised next.
+void vehicleReset(const VehicleParams& params);
+// Scenario changes while running (pack swap, curb, surface).
+VehicleParams& vehicleParams();
+// Driver inputs. fwd/back are the selector switches; pedalV the throttle pin
+// (3.0 V released, see pins.h).
+void vehicleSetSelector(bool fwd, bool back);
+void vehicleSetPedalV(float pedalV);
+// Advances the plant by dtUs against the board's current outputs and updates
+// the board's inputs.
+void vehicleStep(uint32_t dtUs);
+const VehicleState& vehicleGetState();
@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+
+// ===== Simulated board for the host build =====
+// Backing state for hal.h when KIDCAR_HOST is defined. Time only moves when
+// the caller advances it, so control code runs as fast as the CPU allows.
+
+static const int SIM_PIN_COUNT = 64;
+static const int SIM_LEDC_CHANNELS = 8;
+
+struct SimHalCounters {
+  uint32_t digitalWrites;
+  uint32_t analogReads;
+  uint32_t ledcWrites;
+  uint32_t rgbWrites;
+  uint32_t adcFrames; // continuous-mode frames handed to the caller
+  uint32_t ledcFades; // hardware fades started
+};
+
+struct SimRgb {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+};
+
+// Clears clock, pins, counters. Digital inputs idle HIGH (pull-ups),
+// ADC inputs read 0. The continuous ADC stream is stopped.
+void simHalReset();
+
+void simAdvanceUs(uint32_t us);
+void simAdvanceMs(uint32_t ms);
+uint64_t simNowUs();
+
+void simSetDigitalIn(int pin, int level);
+int simGetDigitalOut(int pin);
+
+void simSetAnalogRaw(int pin, uint16_t raw);
+void simSetAnalogMv(int pin, uint16_t mv); // 11 dB attenuation, 0..3300 mV
+// A pin chopped by a PWM output: onMv for the first dutyPct of each period
+// of pwmHz, 0 for the rest (the BTS7960 IS pin). Conversions see the level
+// at their own sample time; simSetAnalogMv/Raw makes the pin steady again.
+void simSetAnalogPwmMv(int pin, uint16_t onMv, float dutyPct, uint32_t pwmHz);
+
+// The ADC stream completes one frame every count * samplesPerPin / sampleHz
+// of virtual time; a frame carries the pin values at the time it is read
+// (chopped pins: the mean of their conversions across the frame).
+bool simAdcStreamRunning();
+
+// Current duty, including the progress of a hardware fade (linear in
+// virtual time, finished once its duration has elapsed).
+uint32_t simGetLedcDuty(int channel);
+
+// Edges for the pulse counter; ignored until halPcntBegin has been called.
+void simPcntPulses(uint32_t n);
+SimRgb simGetRgb();
+
+// Called before every LEDC write or fade start (target duty), e.g. to land
+// an e-stop from "another task" in the middle of a control tick. Cleared by
+// simHalReset.
+typedef void (*SimLedcHook)(int channel, uint32_t duty);
+void simSetLedcHook(SimLedcHook hook);
+
+const SimHalCounters& simHalCounters();
+void simHalResetCounters();
@@ -0,0 +1,16 @@
+#pragma once
+#include <stdio.h>
+
+// ===== Test checks =====
+// Each test binary counts failed CHECKs, prints "<name>: N failures" and
+// exits non-zero when N > 0.
+
+static int gFailures = 0;
+
+#define CHECK(cond)                                                  \
+  do {                                                               \
+    if (!(cond)) {                                                   \
+      gFailures++;                                                   \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond);          \
+    }                                                                \
+  } while (0)
@@ -0,0 +1,81 @@
+// Ordering and staleness rules of the command freshness guard.
+
+#include "cmd_guard.h"
+#include "config.h"
+#include "test_check.h"
+
+#include <stdio.h>
+
+static ControlCommand cmdAt(uint16_t seq, uint32_t sentMs) {
+  ControlCommand c = {};
+  c.hasSeq = true;
+  c.seq = seq;
+  c.hasSentMs = true;
+  c.sentMs = sentMs;
+  return c;
+}
+
+static void testOrdering() {
+  cmdGuardReset();
+  const uint32_t skew = 900000; // sender clock is far from ours
+  CHECK(cmdGuardAccept(cmdAt(10, skew + 0), 20));
+  CHECK(cmdGuardAccept(cmdAt(11, skew + 100), 120));
+  CHECK(!cmdGuardAccept(cmdAt(11, skew + 100), 125)); // duplicate
+  CHECK(!cmdGuardAccept(cmdAt(9, skew - 100), 130));  // reordered
+  CHECK(cmdGuardAccept(cmdAt(13, skew + 300), 320));  // gap is fine
+  CHECK(cmdGuardGetStats().outOfOrder == 2);
+  CHECK(cmdGuardGetStats().accepted == 3);
+}
+
+static void testWrapAndRestart() {
+  cmdGuardReset();
+  CHECK(cmdGuardAccept(cmdAt(65534, 1000), 1000));
+  CHECK(cmdGuardAccept(cmdAt(65535, 1100), 1100));
+  CHECK(cmdGuardAccept(cmdAt(0, 1200), 1200)); // wraps forward
+  CHECK(cmdGuardAccept(cmdAt(1, 1300), 1300));
+
+  // App restarted: sequence and clock both start over.
+  CHECK(cmdGuardAccept(cmdAt(40000, 5), 1400));
+  CHECK(cmdGuardGetStats().resyncs == 1);
+  CHECK(cmdGuardAccept(cmdAt(40001, 105), 1500));
+}
+
+static void testStale() {
+  cmdGuardReset();
+  uint32_t now = 50000;
+  uint16_t seq = 0;
+  for (int i = 0; i < 20; i++) {
+    CHECK(cmdGuardAccept(cmdAt(seq, now - 20), now)); // steady 20 ms transit
+    seq++;
+    now += 100;
+  }
+  // Sent 100 ms ago but held in a queue for another CMD_MAX_AGE_MS.
+  CHECK(!cmdGuardAccept(cmdAt(seq, now - 20 - CMD_MAX_AGE_MS - 50), now));
+  CHECK(cmdGuardGetStats().stale == 1);
+  CHECK(cmdGuardLastAgeMs() == CMD_MAX_AGE_MS + 50);
+  seq++;
+  // Moderate jitter stays within budget.
+  CHECK(cmdGuardAccept(cmdAt(seq, now - 20 - CMD_MAX_AGE_MS / 2), now));
+}
+
+static void testIdleResetAndUnsequenced() {
+  cmdGuardReset();
+  CHECK(cmdGuardAccept(cmdAt(500, 0), 0));
+  // After more than two seconds of silence a small backward step is a new
+  // session, not reordering.
+  CHECK(cmdGuardAccept(cmdAt(490, 3000), 3000));
+  CHECK(cmdGuardGetStats().outOfOrder == 0);
+
+  ControlCommand legacy = {};
+  CHECK(cmdGuardAccept(legacy, 3100));
+  CHECK(cmdGuardAccept(legacy, 3100));
+}
+
+int main() {
+  testOrdering();
+  testWrapAndRestart();
+  testStale();
+  testIdleResetAndUnsequenced();
+  printf("cmd guard: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+// Control mode table: exhaustive over every mode and input combination, plus
+// link loss in the full control loop.
+
+#include "control_mode.h"
+#include "control.h"
+#include "net_queue.h"
+#include "telemetry.h"
+#include "motor_rear.h"
+#include "sim_hal.h"
+#include "config.h"
+#include "pins.h"
+#include "test_check.h"
+
+#include <chrono>
+#include <stdio.h>
+
+static ControlCommand appCommand(int throttle, int steer) {
+  ControlCommand c = {throttle, steer, 200, throttle < 0 ? -throttle : throttle, REAR_RAMP_MS,
+                      false, false, 40, false, false, 0, false, 0, false};
+  return c;
+}
+
+static void testTable() {
+  bool reached[CTL_MODE_COUNT] = {};
+  for (uint8_t m = 0; m < CTL_MODE_COUNT; m++) {
+    for (uint16_t i = 0; i < CTL_INPUT_COMBOS; i++) {
+      const uint8_t in = (uint8_t)i;
+      const ControlMode n = controlModeNext((ControlMode)m, in);
+      CHECK(n < CTL_MODE_COUNT);
+      reached[n] = true;
+      // One lookup per tick is enough.
+      CHECK(controlModeNext(n, in) == n);
+      if (in & CTL_IN_ESTOP) {
+        CHECK(n == CTL_ESTOP);
+        continue;
+      }
+      if (in & CTL_IN_OTA) {
+        CHECK(n == CTL_OTA);
+        continue;
+      }
+      if (in & CTL_IN_FAULT) {
+        CHECK(n == CTL_FAILSAFE);
+        continue;
+      }
+      // Nothing but the app drives without a link.
+      if (!(in & CTL_IN_LINK)) CHECK(n != CTL_REMOTE && n != CTL_PARK_LOCK);
+      // Stale commands never drive.
+      if ((in & CTL_IN_STALE) && !(in & CTL_IN_APP_MANUAL)) CHECK(n != CTL_REMOTE);
+      // A moving car never hands over from the app straight to the pedal.
+      const bool remoteSide = m == CTL_REMOTE || m == CTL_LINK_LOST || m == CTL_LINK_CUT;
+      if (remoteSide && !(in & CTL_IN_LINK)) {
+        CHECK(n == ((in & CTL_IN_STOPPED) ? CTL_MANUAL : CTL_LINK_CUT));
+      }
+      if (m == CTL_REMOTE && (in & CTL_IN_LINK) && (in & CTL_IN_STALE) && !(in & CTL_IN_APP_MANUAL)) {
+        CHECK(n == CTL_LINK_LOST);
+      }
+      // Stop modes hold until the car is standing.
+      if ((m == CTL_FAILSAFE || m == CTL_OTA || m == CTL_ESTOP) && !(in & CTL_IN_STOPPED)) CHECK(n == m);
+    }
+  }
+  for (uint8_t m = 0; m < CTL_MODE_COUNT; m++) CHECK(reached[m]);
+
+  // MANUAL and REMOTE can be reached again from every mode.
+  const uint8_t toManual = CTL_IN_STOPPED;
+  const uint8_t toRemote = CTL_IN_LINK | CTL_IN_STOPPED;
+  for (uint8_t m = 0; m < CTL_MODE_COUNT; m++) {
+    CHECK(controlModeNext((ControlMode)m, toManual) == CTL_MANUAL);
+    CHECK(controlModeNext((ControlMode)m, toRemote) == CTL_REMOTE);
+  }
+  // Out-of-range mode is treated as a fault.
+  CHECK(controlModeNext((ControlMode)CTL_MODE_COUNT, 0) == CTL_FAILSAFE);
+}
+
+static void testCommands() {
+  const ControlCommand app = appCommand(-90, 50);
+  const ManualInputs pedalBack = {0.0f, false, true};
+  for (uint8_t m = 0; m < CTL_MODE_COUNT; m++) {
+    const ControlModeDef& def = controlModeDef((ControlMode)m);
+    ManualReading r;
+    const ControlCommand c = controlModeCommand((ControlMode)m, app, pedalBack, r);
+    if (!def.appDrives && !def.pedalDrives) {
+      CHECK(c.throttle == 0 && c.steer == 0 && c.speed == 0);
+    }
+    if (def.emergencyStop) CHECK(c.throttle == 0);
+    // Reverse limit applies whichever side drives.
+    CHECK(c.throttle >= -(int)app.reverseSpeed);
+    CHECK(c.speed <= 100);
+  }
+  ManualReading r;
+  ControlCommand c = controlModeCommand(CTL_REMOTE, app, pedalBack, r);
+  CHECK(c.throttle == -40 && c.steer == 50);
+  c = controlModeCommand(CTL_MANUAL, app, pedalBack, r);
+  CHECK(c.throttle == -40 && c.steer == 0);
+  CHECK(r.gear == -1 && r.throttlePct == 40);
+  // Park ignores the selector.
+  c = controlModeCommand(CTL_PARK_LOCK, app, pedalBack, r);
+  CHECK(c.throttle == 0 && r.gear == 0);
+  // Pedal released (>= 2 V) is a stop even with a gear selected.
+  const ManualInputs released = {3.0f, true, false};
+  c = controlModeCommand(CTL_MANUAL, app, released, r);
+  CHECK(c.throttle == 0);
+}
+
+static void testLookupCost() {
+  const int kIters = 1000000;
+  volatile uint8_t sink = 0;
+  ControlMode m = CTL_MANUAL;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIters; i++) {
+    m = controlModeNext(m, (uint8_t)(i * 7));
+    sink = sink + m;
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / kIters;
+  printf("mode lookup: %.2f ns\n", ns);
+}
+
+// Remote driving in the full loop, then the app goes quiet: the last command
+// is held, the car brakes in LINK_LOST and the pedal takes over once the
+// link is cut. Timing of the ladder itself is covered by test_link_watch.
+static void testLinkLoss() {
+  Serial.setSink(nullptr);
+  simHalReset();
+  simAdvanceMs(1);
+  simSetAnalogMv(PIN_BATTERY_FB, 2134);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000);
+  controlInit();
+  auto run = [](uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      simAdvanceMs(1);
+      controlLoop();
+    }
+  };
+  auto snapMode = []() {
+    TelemetrySnapshot s;
+    telemetryRead(s);
+    return s.mode;
+  };
+  CHECK(snapMode() == CTL_MANUAL);
+  NetMsg msg = {NET_MSG_COMMAND, appCommand(80, 0)};
+  for (int i = 0; i < 30; i++) {
+    netQueuePush(msg);
+    run(100);
+  }
+  CHECK(snapMode() == CTL_REMOTE);
+  CHECK(rearGetDutyPct() > 50);
+
+  // Pedal pressed while the app is driving: ignored until the handover.
+  simSetDigitalIn(PIN_MANUAL_FWD, LOW);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 500);
+  // Last command was 100 ms ago.
+  run(100);
+  CHECK(snapMode() == CTL_REMOTE);
+  CHECK(rearGetDutyPct() > 50);
+  uint32_t lostMs = 0;
+  while (snapMode() == CTL_REMOTE && lostMs < 3000) {
+    run(1);
+    lostMs++;
+  }
+  CHECK(snapMode() == CTL_LINK_LOST);
+  uint32_t handoverMs = 0;
+  while (snapMode() == CTL_LINK_LOST && handoverMs < 3000) {
+    run(1);
+    handoverMs++;
+  }
+  printf("link lost: braking after %u ms, pedal after %u ms more\n", (unsigned)(lostMs + 200),
+         (unsigned)handoverMs);
+  CHECK(snapMode() == CTL_MANUAL);
+  CHECK(rearGetDutyPct() == 0);
+  simSetDigitalIn(PIN_MANUAL_FWD, HIGH);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000);
+  run(100);
+
+  // OTA holds everything off and drops the relay.
+  netSetOtaActive(true);
+  run(10);
+  CHECK(snapMode() == CTL_OTA);
+  CHECK(simGetDigitalOut(PIN_RELAY_EN) == LOW);
+  netSetOtaActive(false);
+  run(10);
+  CHECK(snapMode() == CTL_MANUAL);
+}
+
+int main() {
+  testTable();
+  testCommands();
+  testLookupCost();
+  testLinkLoss();
+  printf("control_mode: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
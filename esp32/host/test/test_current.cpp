@@ -0,0 +1,148 @@
+// Rear motor current limit against a DC motor + vehicle plant whose bridge
+// current is fed back through the BTS7960 IS pin: a wheel stalled on a curb
+// is held at the peak limit instead of drawing stall current, the I²t model
+// brings a long stall down to the continuous rating, the duty comes back
+// once the wheel is free, normal driving is not limited, and peak/average
+// current reach the telemetry.
+
+#include "motor_current.h"
+#include "motor_rear.h"
+#include "speed_ctl.h"
+#include "sensors.h"
+#include "control.h"
+#include "net_queue.h"
+#include "telemetry.h"
+#include "sim_hal.h"
+#include "config.h"
+#include "pins.h"
+#include "test_check.h"
+#include "test_rear.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static float gMaxA = 0.0f; // largest motor current since the last start
+
+static void start(float crr, bool blocked) {
+  VehicleParams car = rearTestCar(12.6f, crr);
+  car.blocked = blocked;
+  rearTestStart(car, false);
+  gMaxA = 0.0f;
+}
+
+static float motorA() {
+  return vehicleGetState().motorA;
+}
+
+static void step() {
+  vehicleStep(1000);
+  if (fabsf(motorA()) > gMaxA) gMaxA = fabsf(motorA());
+}
+
+// Returns the mean motor current over the last `avgMs`.
+static float run(int speed, uint32_t ms, uint32_t avgMs = 0) {
+  double sum = 0.0;
+  for (uint32_t t = 0; t < ms; t++) {
+    simAdvanceMs(1);
+    sensorsPoll();
+    rearSetSpeed(speed, 1000);
+    step();
+    if (t >= ms - avgMs) sum += motorA();
+  }
+  return avgMs ? (float)(sum / avgMs) : motorA();
+}
+
+static void testCurbStall() {
+  // Full throttle into a curb. Without the limit the motors would sit at
+  // stall current, vbatt / R.
+  start(0.015f, true);
+  run(100, 3000);
+  const float stallA = vehicleParams().packOcvV / vehicleParams().motorROhm;
+  const CurrentState s = currentGetState();
+  printf("curb at 100%%: motor max %.1f A (stall %.1f A), held at %.1f A, duty %u%%, ceiling %.0f%%, %lu cuts\n",
+         gMaxA, stallA, motorA(), (unsigned)rearGetDutyPct(), s.ceilingPct,
+         (unsigned long)currentGetStats().cuts);
+  CHECK(gMaxA <= CURRENT_PEAK_LIMIT_A * 1.1f);
+  CHECK(motorA() >= CURRENT_PEAK_LIMIT_A * 0.85f);
+  CHECK(s.limiting);
+  CHECK(rearGetDutyPct() < 50);
+  CHECK(fabsf(s.motorA - motorA()) <= 0.05f * CURRENT_PEAK_LIMIT_A);
+
+  // Held there, the I²t model walks the limit down to the continuous rating.
+  uint32_t derateMs = 0;
+  for (uint32_t t = 0; t < 60000; t++) {
+    run(100, 1);
+    if (!derateMs && currentGetState().limitA < CURRENT_PEAK_LIMIT_A) derateMs = t + 1;
+  }
+  const float heldA = run(100, 5000, 5000);
+  const CurrentState hot = currentGetState();
+  printf("  after 65 s: derating from %.1f s, limit %.1f A, held at %.1f A, heat %.0f%%\n", derateMs / 1000.0f,
+         hot.limitA, heldA, hot.heatPct);
+  CHECK(derateMs > 1000 && derateMs < 20000);
+  CHECK(heldA <= CURRENT_CONT_A * 1.05f);
+  CHECK(hot.heatPct <= 105.0f);
+
+  // Off the curb: the ceiling climbs back and the car drives away.
+  vehicleParams().blocked = false;
+  uint32_t freeMs = 0;
+  for (uint32_t t = 0; t < 3000 && !freeMs; t++) {
+    run(100, 1);
+    if (!currentGetState().limiting) freeMs = t + 1;
+  }
+  run(100, 5000);
+  printf("  wheel free: ceiling back at 100%% after %lu ms, %.0f mm/s\n", (unsigned long)freeMs,
+         vehicleGetState().speedMps * 1000.0f);
+  CHECK(freeMs > 0 && freeMs <= 3000);
+  CHECK(rearGetDutyPct() == 100);
+}
+
+static void testNormalDriving() {
+  // Pulling away on grass at full duty stays under the peak limit; the
+  // limiter is not involved.
+  start(0.08f, false);
+  run(100, 6000);
+  const CurrentState s = currentGetState();
+  printf("grass, 0 -> 100%%: motor max %.1f A, cruising %.1f A, %lu cuts, %.0f mm/s\n", gMaxA, motorA(),
+         (unsigned long)currentGetStats().cuts, vehicleGetState().speedMps * 1000.0f);
+  CHECK(currentGetStats().cuts == 0);
+  CHECK(!s.limiting);
+  CHECK(rearGetDutyPct() == 100);
+  CHECK(fabsf(s.avgA - motorA()) <= 1.0f);
+  CHECK(fabsf(s.peakA - motorA()) <= 1.0f);
+}
+
+static void testTelemetry() {
+  Serial.setSink(nullptr);
+  simHalReset();
+  simAdvanceMs(1);
+  VehicleParams car = rearTestCar(12.6f, 0.015f);
+  car.blocked = true;
+  car.relayFitted = true;
+  vehicleReset(car);
+  gMaxA = 0.0f;
+  controlInit();
+  ControlCommand c = {100, 0, 0, 100, REAR_RAMP_MS, false, false, 50, false, false, 0, false, 0, false};
+  for (uint32_t t = 0; t < 3000; t++) {
+    if (t % 50 == 0) netQueuePush(NetMsg{NET_MSG_COMMAND, c});
+    simAdvanceMs(1);
+    controlLoop();
+    step();
+  }
+  TelemetrySnapshot snap;
+  telemetryRead(snap);
+  printf("control loop into a curb: motor max %.1f A, telemetry peak %.1f A avg %.1f A heat %u%% limited %d\n",
+         gMaxA, snap.motorPeakA, snap.motorAvgA, (unsigned)snap.motorHeatPct, snap.currentLimited ? 1 : 0);
+  CHECK(gMaxA <= CURRENT_PEAK_LIMIT_A * 1.1f);
+  CHECK(snap.currentLimited);
+  CHECK(snap.motorPeakA >= CURRENT_PEAK_LIMIT_A * 0.9f && snap.motorPeakA <= CURRENT_PEAK_LIMIT_A * 1.1f);
+  CHECK(snap.motorAvgA >= CURRENT_PEAK_LIMIT_A * 0.8f && snap.motorAvgA <= snap.motorPeakA);
+  CHECK(snap.motorHeatPct > 0);
+}
+
+int main() {
+  testCurbStall();
+  testNormalDriving();
+  testTelemetry();
+  printf("current: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
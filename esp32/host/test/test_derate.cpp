@@ -0,0 +1,219 @@
+// Battery derating against a pack with internal resistance feeding the rear
+// motors: the curve and its rate limits, the slope lookahead engaging before
+// the knee is reached, a weak pack held above the brownout level on a
+// full-throttle launch that would otherwise sag through it, a healthy pack
+// left alone, and the derating reaching the telemetry through the control
+// loop.
+
+#include "power_derate.h"
+#include "motor_current.h"
+#include "motor_rear.h"
+#include "speed_ctl.h"
+#include "sensors.h"
+#include "control.h"
+#include "net_queue.h"
+#include "telemetry.h"
+#include "sim_hal.h"
+#include "config.h"
+#include "pins.h"
+#include "test_check.h"
+#include "test_rear.h"
+
+#include <math.h>
+#include <stdio.h>
+
+// Where the ESP supply or the relay would drop out.
+static const float BROWNOUT_V = 8.5f;
+
+// No derating: a single point at 100 %.
+static const float kOffV[] = {0.0f};
+static const uint8_t kOffPct[] = {100};
+
+static DerateConfig offConfig() {
+  DerateConfig c = derateDefaultConfig();
+  c.curveV = kOffV;
+  c.curveDutyPct = kOffPct;
+  c.curveAccelPct = kOffPct;
+  c.points = 1;
+  return c;
+}
+
+static float gMinV = 0.0f; // lowest pack terminal voltage since the last start
+
+static float packFromPin() {
+  return sensorsPinVoltage(SENSOR_BATTERY) * (122.0f / 22.0f) * BATTERY_VOLT_CAL_FACTOR;
+}
+
+static float packV() {
+  return vehicleGetState().packV;
+}
+
+static float speedMps() {
+  return vehicleGetState().speedMps;
+}
+
+static void step() {
+  vehicleStep(1000);
+  if (packV() < gMinV) gMinV = packV();
+}
+
+// Pack (open-circuit voltage behind rInt) driving the rear motors.
+static void start(float ocv, float rInt, float crr, const DerateConfig& cfg) {
+  rearTestStart(rearTestCar(ocv, crr, rInt), false, REAR_RAMP_MS);
+  derateReset(cfg, packFromPin());
+  gMinV = packV();
+}
+
+// Full throttle for `ms`, with the derating wired in as the motor task does.
+// Returns the time to reach `mmps` (0 if not reached).
+static uint32_t launch(uint32_t ms, float mmps) {
+  uint32_t reachedMs = 0;
+  for (uint32_t t = 0; t < ms; t++) {
+    simAdvanceMs(1);
+    sensorsPoll();
+    const DerateLimits lim = derateUpdate(packFromPin(), 1000);
+    rearSetPowerLimit(lim.maxDutyPct, lim.accelScale);
+    rearSetSpeed(100, 1000);
+    step();
+    if (!reachedMs && speedMps() * 1000.0f >= mmps) reachedMs = t + 1;
+  }
+  return reachedMs;
+}
+
+static void testCurve() {
+  // Static lookups: flat outside the curve, linear in between.
+  derateReset(derateDefaultConfig(), 12.6f);
+  CHECK(!derateGetState().active && derateGetState().maxDutyPct == 100.0f);
+  derateReset(derateDefaultConfig(), 8.0f);
+  CHECK(derateGetState().maxDutyPct == DERATE_CURVE_DUTY_PCT[0]);
+  CHECK(derateGetState().accelPct == DERATE_CURVE_ACCEL_PCT[0]);
+  CHECK(derateGetStats().events == 1);
+  const float mid = (DERATE_CURVE_V[1] + DERATE_CURVE_V[2]) / 2.0f;
+  derateReset(derateDefaultConfig(), mid);
+  const float want = (DERATE_CURVE_DUTY_PCT[1] + DERATE_CURVE_DUTY_PCT[2]) / 2.0f;
+  CHECK(fabsf(derateGetState().maxDutyPct - want) < 0.5f);
+
+  // A pack stepping from full to the bottom of the curve: the ceiling falls
+  // at the fall rate, then climbs back at the rise rate once it recovers.
+  derateReset(derateDefaultConfig(), 12.6f);
+  uint32_t downMs = 0;
+  for (uint32_t t = 0; t < 2000; t++) {
+    derateUpdate(8.0f, 1000);
+    if (!downMs && derateGetState().maxDutyPct <= DERATE_CURVE_DUTY_PCT[0]) downMs = t + 1;
+  }
+  uint32_t upMs = 0;
+  for (uint32_t t = 0; t < 10000; t++) {
+    derateUpdate(12.6f, 1000);
+    if (!upMs && !derateGetState().active) upMs = t + 1;
+  }
+  const float fallMs = (100.0f - DERATE_CURVE_DUTY_PCT[0]) / DERATE_FALL_PCT_S * 1000.0f;
+  const float riseMs = (100.0f - DERATE_CURVE_DUTY_PCT[0]) / DERATE_RISE_PCT_S * 1000.0f;
+  printf("curve: 12.6 V -> 8 V ceiling down in %lu ms, back in %lu ms; %lu events, min %.2f V\n",
+         (unsigned long)downMs, (unsigned long)upMs, (unsigned long)derateGetStats().events,
+         derateGetStats().minV);
+  CHECK(downMs >= fallMs && downMs <= fallMs + 2.0f * DERATE_FILTER_TAU_MS + 50.0f);
+  CHECK(upMs >= riseMs && upMs <= riseMs + 500.0f);
+  CHECK(derateGetStats().events == 1);
+  CHECK(derateGetStats().minV < 8.2f);
+}
+
+static void testLookahead() {
+  // A pack falling at 3 V/s from 12.4 V: the projection crosses the top of
+  // the curve while the filtered voltage is still well above it.
+  derateReset(derateDefaultConfig(), 12.4f);
+  const float top = DERATE_CURVE_V[sizeof(DERATE_CURVE_V) / sizeof(DERATE_CURVE_V[0]) - 1];
+  float onV = 0.0f;
+  for (uint32_t t = 0; t < 1000 && onV == 0.0f; t++) {
+    derateUpdate(12.4f - 3.0f * (float)t / 1000.0f, 1000);
+    if (derateGetState().active) onV = derateGetState().filteredV;
+  }
+  printf("lookahead: 3 V/s sag derated at %.2f V (curve top %.2f V)\n", onV, top);
+  CHECK(onV > top + 0.5f);
+  for (uint32_t t = 0; t < 500; t++) derateUpdate(onV - 3.0f * (float)t / 1000.0f, 1000);
+  CHECK(fabsf(derateGetState().slopeVps + 3.0f) < 0.3f);
+
+  // The same voltage held still does not derate.
+  derateReset(derateDefaultConfig(), onV);
+  for (uint32_t t = 0; t < 1000; t++) derateUpdate(onV, 1000);
+  CHECK(!derateGetState().active);
+}
+
+static void testWeakPack() {
+  // A tired pack with a long run of thin wire: full throttle from rest.
+  const float ocv = 11.4f;
+  const float rInt = 0.15f;
+  start(ocv, rInt, 0.06f, offConfig());
+  launch(4000, 0.0f);
+  const uint32_t rawCuts = currentGetStats().cuts;
+  const float rawMinV = gMinV;
+  const float rawV = speedMps();
+
+  start(ocv, rInt, 0.06f, derateDefaultConfig());
+  launch(4000, 0.0f);
+  const DerateStats s = derateGetStats();
+  printf("weak pack %.1f V / %.2f ohm: min %.2f V without derating (%lu current cuts), %.2f V with "
+         "(%lu events, %lu ms active), %.0f vs %.0f mm/s at 4 s\n",
+         ocv, rInt, rawMinV, (unsigned long)rawCuts, gMinV, (unsigned long)s.events,
+         (unsigned long)s.activeMs, rawV * 1000.0f, speedMps() * 1000.0f);
+  CHECK(rawMinV < BROWNOUT_V);
+  CHECK(gMinV >= BROWNOUT_V);
+  CHECK(s.events >= 1);
+  CHECK(speedMps() > 0.5f * rawV);
+
+  // Once the car is rolling the sag eases and the ceiling comes back up.
+  launch(8000, 0.0f);
+  printf("  cruising: pack %.2f V, ceiling %.0f%%, %.0f mm/s\n", packV(), derateGetState().maxDutyPct,
+         speedMps() * 1000.0f);
+  CHECK(derateGetState().maxDutyPct > 80.0f);
+}
+
+static void testHealthyPack() {
+  // A fresh pack: derating never engages and the launch is unchanged.
+  start(12.8f, 0.04f, 0.06f, offConfig());
+  const uint32_t rawMs = launch(6000, 2000.0f);
+  start(12.8f, 0.04f, 0.06f, derateDefaultConfig());
+  const uint32_t carMs = launch(6000, 2000.0f);
+  printf("healthy pack: min %.2f V, 0 -> 2 m/s in %lu ms (%lu without derating), %lu events\n", gMinV,
+         (unsigned long)carMs, (unsigned long)rawMs, (unsigned long)derateGetStats().events);
+  CHECK(derateGetStats().events == 0);
+  CHECK(rawMs > 0 && carMs == rawMs);
+}
+
+static void testTelemetry() {
+  Serial.setSink(nullptr);
+  simHalReset();
+  simAdvanceMs(1);
+  VehicleParams car = rearTestCar(11.4f, 0.06f, 0.15f);
+  car.relayFitted = true;
+  vehicleReset(car);
+  gMinV = packV();
+  controlInit();
+  ControlCommand c = {100, 0, 0, 100, REAR_RAMP_MS, false, false, 50, false, false, 0, false, 0, false};
+  uint8_t minLimit = 100;
+  for (uint32_t t = 0; t < 4000; t++) {
+    if (t % 50 == 0) netQueuePush(NetMsg{NET_MSG_COMMAND, c});
+    simAdvanceMs(1);
+    controlLoop();
+    step();
+    TelemetrySnapshot snap;
+    telemetryRead(snap);
+    if (snap.powerLimitPct < minLimit) minLimit = snap.powerLimitPct;
+  }
+  TelemetrySnapshot snap;
+  telemetryRead(snap);
+  printf("control loop, weak pack: min %.2f V, telemetry power limit min %u%% now %u%%, %lu events\n", gMinV,
+         (unsigned)minLimit, (unsigned)snap.powerLimitPct, (unsigned long)snap.derateEvents);
+  CHECK(gMinV >= BROWNOUT_V);
+  CHECK(snap.derateEvents >= 1);
+  CHECK(minLimit < 100);
+}
+
+int main() {
+  testCurve();
+  testLookahead();
+  testWeakPack();
+  testHealthyPack();
+  testTelemetry();
+  printf("derate: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
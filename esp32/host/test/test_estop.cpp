@@ -0,0 +1,192 @@
+// E-stop fast path: outputs are off when controlEstop returns, before any
+// control task runs; the latch holds against app and pedal until released;
+// latency histograms; comparison with a stop sent as a normal command.
+
+#include "control.h"
+#include "control_mode.h"
+#include "net_queue.h"
+#include "telemetry.h"
+#include "motor_rear.h"
+#include "protocol.h"
+#include "sim_hal.h"
+#include "config.h"
+#include "pins.h"
+#include "test_check.h"
+
+#include <chrono>
+#include <stdio.h>
+
+static ControlCommand drive(int throttle) {
+  ControlCommand c = {throttle, 0, 0, throttle < 0 ? -throttle : throttle, REAR_RAMP_MS,
+                      false, false, 50, false, false, 0, false, 0, false};
+  return c;
+}
+
+static void run(uint32_t ms, int throttle = 0, bool send = false) {
+  for (uint32_t i = 0; i < ms; i++) {
+    if (send && i % 100 == 0) netQueuePush(NetMsg{NET_MSG_COMMAND, drive(throttle)});
+    simAdvanceMs(1);
+    controlLoop();
+  }
+}
+
+static uint8_t snapMode() {
+  TelemetrySnapshot s;
+  telemetryRead(s);
+  return s.mode;
+}
+
+static bool outputsOff() {
+  return simGetLedcDuty(CH_BTS_R) == 0 && simGetLedcDuty(CH_BTS_L) == 0 &&
+         simGetDigitalOut(PIN_RELAY_EN) == LOW;
+}
+
+static void start() {
+  Serial.setSink(nullptr);
+  simHalReset();
+  simAdvanceMs(1);
+  simSetAnalogMv(PIN_BATTERY_FB, 2134);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000);
+  controlInit();
+}
+
+// The stop as the app sends it today: throttle 0 in a normal command.
+static uint32_t commandStopMs() {
+  start();
+  run(3000, 80, true);
+  uint32_t ms = 0;
+  while (rearGetDutyPct() > 0 && ms < 5000) {
+    run(1, 0, ms == 0);
+    ms++;
+  }
+  return ms;
+}
+
+static void testFastPath() {
+  start();
+  run(3000, 80, true);
+  CHECK(snapMode() == CTL_REMOTE);
+  CHECK(rearGetDutyPct() > 50);
+
+  // Arrives as a datagram; decoded and applied by the e-stop task.
+  uint8_t frame[ESTOP_FRAME_LEN];
+  protocolEncodeEstop(ESTOP_ACTION_STOP, frame, sizeof(frame));
+  uint8_t action = 0;
+  CHECK(protocolDecodeEstop(frame, sizeof(frame), action) && action == ESTOP_ACTION_STOP);
+  controlEstop((uint32_t)simNowUs());
+  // Off before the control loop has run at all.
+  CHECK(outputsOff());
+  run(1);
+  CHECK(snapMode() == CTL_ESTOP);
+  CHECK(rearGetDutyPct() == 0);
+
+  // App keeps driving, kid presses the pedal: nothing moves.
+  simSetDigitalIn(PIN_MANUAL_FWD, LOW);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 500);
+  run(2000, 80, true);
+  CHECK(snapMode() == CTL_ESTOP);
+  CHECK(outputsOff());
+  simSetDigitalIn(PIN_MANUAL_FWD, HIGH);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000);
+
+  // Release: the app drives again from a standstill.
+  controlEstopRelease();
+  run(1000, 80, true);
+  CHECK(snapMode() == CTL_REMOTE);
+  CHECK(rearGetDutyPct() > 0);
+  CHECK(simGetDigitalOut(PIN_RELAY_EN) == HIGH);
+
+  const EstopStats s = controlEstopStats();
+  CHECK(s.stops == 1 && s.releases == 1);
+  CHECK(s.maxApplyUs <= 1000); // applied on the next loop pass
+}
+
+// A stop in the middle of an accelerating fade cuts the fade too.
+static void testMidFade() {
+  start();
+  run(300, 100, true);
+  CHECK(simHalCounters().ledcFades > 0);
+  CHECK(simGetLedcDuty(CH_BTS_R) > 0 || simGetLedcDuty(CH_BTS_L) > 0);
+  controlEstop((uint32_t)simNowUs());
+  CHECK(outputsOff());
+  simAdvanceMs(REAR_FADE_SEGMENT_MS);
+  CHECK(outputsOff());
+  // A second stop while latched is harmless.
+  controlEstop((uint32_t)simNowUs());
+  run(5);
+  CHECK(outputsOff() && snapMode() == CTL_ESTOP);
+}
+
+// The e-stop task cuts while a motor tick on the other core is between
+// reading its inputs and writing the bridge: the tick's write must not
+// survive the cut.
+static bool gRaceFired = false;
+static void estopDuringWrite(int, uint32_t duty) {
+  if (gRaceFired || duty == 0) return;
+  gRaceFired = true;
+  controlEstop((uint32_t)simNowUs());
+}
+
+static void testRaceWithMotorTick() {
+  start();
+  run(3000, 80, true);
+  CHECK(rearGetDutyPct() > 50);
+  gRaceFired = false;
+  simSetLedcHook(estopDuringWrite);
+  // Slowing down, so the tick has a new duty to write. Checked right after
+  // that tick, before the next pass applies the stop.
+  for (int i = 0; i < 50 && !gRaceFired; i++) run(1, 30, i == 0);
+  simSetLedcHook(nullptr);
+  CHECK(gRaceFired);
+  CHECK(outputsOff());
+  run(1);
+  CHECK(outputsOff() && snapMode() == CTL_ESTOP);
+}
+
+static void testHistogram() {
+  start();
+  using Clock = std::chrono::steady_clock;
+  const int kStops = 1000;
+  double totalNs = 0.0;
+  for (int i = 0; i < kStops; i++) {
+    run(1 + (uint32_t)(i % 7), 60, true);
+    // Datagram read a little before the fast path ran.
+    const uint32_t rxUs = (uint32_t)simNowUs();
+    simAdvanceUs((uint32_t)(i % 50));
+    const auto t0 = Clock::now();
+    controlEstop(rxUs);
+    totalNs += std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+    CHECK(outputsOff());
+    simAdvanceUs((uint32_t)(i % 900));
+    controlLoop();
+    controlEstopRelease();
+  }
+  const EstopStats s = controlEstopStats();
+  CHECK(s.stops == (uint32_t)kStops);
+  uint32_t cut = 0, apply = 0;
+  printf("estop latency histogram (us)\n  bucket        cut  apply\n");
+  for (uint8_t b = 0; b < ESTOP_HIST_BUCKETS; b++) {
+    cut += s.cutHist[b];
+    apply += s.applyHist[b];
+    if (!s.cutHist[b] && !s.applyHist[b]) continue;
+    printf("  < %-8u %6lu %6lu\n", 1u << b, (unsigned long)s.cutHist[b], (unsigned long)s.applyHist[b]);
+  }
+  CHECK(cut == (uint32_t)kStops && apply == (uint32_t)kStops);
+  CHECK(s.maxCutUs < 50);
+  CHECK(s.maxApplyUs < 1000);
+  printf("  cut max %lu us, apply max %lu us; controlEstop host cost %.0f ns avg\n",
+         (unsigned long)s.maxCutUs, (unsigned long)s.maxApplyUs, totalNs / kStops);
+}
+
+int main() {
+  const uint32_t legacy = commandStopMs();
+  testFastPath();
+  testMidFade();
+  testRaceWithMotorTick();
+  testHistogram();
+  printf("stop from 80%%: command path %u ms to zero duty, e-stop 0 ms (outputs off on receipt)\n",
+         (unsigned)legacy);
+  CHECK(legacy > 100);
+  printf("estop: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
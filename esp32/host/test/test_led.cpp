@@ -0,0 +1,109 @@
+// Status LED engine: frames are sent only on colour changes; patterns keep
+// their blink phase; and the LED bus time the full loop gives back compared
+// with writing every loop pass or every 50 ms LED tick.
+
+#include "led.h"
+#include "control.h"
+#include "net_queue.h"
+#include "sim_hal.h"
+#include "config.h"
+#include "pins.h"
+#include "test_check.h"
+
+#include <stdio.h>
+
+// A WS2812 frame is 24 bits at 800 kHz; rgbLedWrite blocks at least that long.
+static const double kRgbFrameUs = 30.0;
+
+static const LedPattern kSolid = {0, {0, 0, 64}, false};
+static const LedPattern kBlink = {500, {255, 0, 0}, true};
+
+static uint32_t runEngine(uint32_t fromMs, uint32_t ms) {
+  for (uint32_t t = 0; t < ms; t += 10) ledRun(fromMs + t);
+  return fromMs + ms;
+}
+
+static void testEngine() {
+  simHalReset();
+  ledReset(kSolid, 0);
+  simHalResetCounters();
+  ledSetPattern(kSolid, 0, 0);
+  uint32_t now = runEngine(0, 10000);
+  CHECK(simHalCounters().rgbWrites == 1);
+  CHECK(simGetRgb().b == 64);
+
+  // Blink: one frame per edge.
+  simHalResetCounters();
+  ledSetPattern(kBlink, 0, 0);
+  now = runEngine(now, 10000);
+  CHECK(simHalCounters().rgbWrites >= 19 && simHalCounters().rgbWrites <= 21);
+
+  // Driving forward: green, brightness follows speed; a steady speed costs
+  // nothing more than the blink edges.
+  ledSetPattern(kBlink, 1, 50);
+  bool sawGreen = false;
+  for (int i = 0; i < 100; i++) {
+    ledRun(now += 10);
+    const SimRgb c = simGetRgb();
+    if (c.g) {
+      sawGreen = true;
+      CHECK(c.r == 0 && c.b == 0 && c.g == (50 * 255) / 100);
+    }
+  }
+  CHECK(sawGreen);
+  ledSetPattern(kBlink, -1, 5);
+  bool sawBlue = false;
+  for (int i = 0; i < 100; i++) {
+    ledRun(now += 10);
+    if (simGetRgb().b) {
+      sawBlue = true;
+      CHECK(simGetRgb().b == 20); // floor so slow reverse is still visible
+    }
+  }
+  CHECK(sawBlue);
+
+  // Switching pattern keeps the phase: no extra edge.
+  const LedStats before = ledGetStats();
+  ledSetPattern(kBlink, 0, 0);
+  ledRun(now += 10);
+  ledSetPattern(LedPattern{150, {255, 0, 0}, true}, 0, 0);
+  ledRun(now += 10);
+  CHECK(ledGetStats().writes - before.writes <= 1);
+}
+
+static void testLoop() {
+  Serial.setSink(nullptr);
+  simHalReset();
+  simAdvanceMs(1);
+  simSetAnalogMv(PIN_BATTERY_FB, 2134);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000);
+  controlInit();
+  simHalResetCounters();
+  const uint32_t kMs = 20000;
+  // Idle 10 s with the app connected, then 10 s of pedal driving.
+  for (uint32_t t = 0; t < kMs; t++) {
+    if (t < kMs / 2 && t % 100 == 0) netQueuePush(NetMsg{NET_MSG_ACTIVITY, ControlCommand()});
+    if (t == kMs / 2) {
+      simSetDigitalIn(PIN_MANUAL_FWD, LOW);
+      simSetAnalogMv(PIN_MANUAL_THROTTLE, 500);
+    }
+    simAdvanceMs(1);
+    controlLoop();
+  }
+  const double secs = kMs / 1000.0;
+  const double writes = simHalCounters().rgbWrites / secs;
+  const double perLoop = 1000.0;  // original: setRgb on every 1 ms loop pass
+  const double perTick = 20.0;    // fixed-rate LED task at 50 ms
+  printf("rgb frames/s: engine %.1f, per LED tick %.0f, per loop %.0f\n", writes, perTick, perLoop);
+  printf("LED bus time reclaimed: %.2f ms/s vs per loop, %.2f ms/s vs per tick (%.0f us/frame)\n",
+         (perLoop - writes) * kRgbFrameUs / 1000.0, (perTick - writes) * kRgbFrameUs / 1000.0, kRgbFrameUs);
+  CHECK(writes < 8.0);
+  CHECK(ledGetStats().suppressed > ledGetStats().writes);
+}
+
+int main() {
+  testEngine();
+  testLoop();
+  printf("led: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
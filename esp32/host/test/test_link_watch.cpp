@@ -0,0 +1,208 @@
+// Link failsafe ladder: adaptive late threshold from packet gaps, stage
+// timing, and Wi-Fi dropout scenarios in the full control loop against the
+// old fixed 2 s timeout.
+
+#include "link_watch.h"
+#include "control.h"
+#include "control_mode.h"
+#include "net_queue.h"
+#include "telemetry.h"
+#include "motor_rear.h"
+#include "sim_hal.h"
+#include "config.h"
+#include "pins.h"
+#include "test_check.h"
+
+#include <stdio.h>
+
+static uint32_t gRand = 12345;
+static uint32_t rnd() {
+  gRand = gRand * 1664525u + 1013904223u;
+  return gRand >> 8;
+}
+
+// Feeds `count` packets with gaps base +- jitter; returns the time after the last.
+static uint32_t feed(uint32_t now, int count, uint32_t base, uint32_t jitter) {
+  for (int i = 0; i < count; i++) {
+    now += base - jitter + (jitter ? rnd() % (2 * jitter + 1) : 0);
+    linkWatchPacket(now);
+    linkWatchUpdate(now);
+  }
+  return now;
+}
+
+static void testAdaptiveThreshold() {
+  const LinkWatchConfig cfg = linkWatchDefaultConfig();
+  linkWatchReset(cfg, 0);
+  CHECK(linkWatchUpdate(0) == LINK_CUT);
+  CHECK(linkWatchStats().lateMs == cfg.lateMaxMs); // no gaps seen yet
+
+  uint32_t now = feed(0, 50, 100, 0);
+  const uint32_t steady = linkWatchStats().lateMs;
+  CHECK(steady == cfg.lateMinMs);
+  CHECK(linkWatchStats().meanGapMs == 100);
+
+  linkWatchReset(cfg, 0);
+  now = feed(0, 200, 100, 60);
+  const uint32_t jittery = linkWatchStats().lateMs;
+  CHECK(jittery > steady && jittery < cfg.lateMaxMs);
+
+  // Phone in the background: 500 ms heartbeats only.
+  linkWatchReset(cfg, 0);
+  now = feed(0, 50, 500, 20);
+  const uint32_t slow = linkWatchStats().lateMs;
+  CHECK(slow > jittery && slow <= cfg.lateMaxMs);
+  printf("late threshold: steady 100 ms %u ms, 100+-60 ms %u ms, 500 ms %u ms\n", (unsigned)steady,
+         (unsigned)jittery, (unsigned)slow);
+
+  // One long outage does not poison the estimate.
+  linkWatchReset(cfg, 0);
+  now = feed(0, 50, 100, 0);
+  now += 5000;
+  linkWatchPacket(now);
+  CHECK(linkWatchStats().maxGapMs == 5000);
+  now = feed(now, 1, 100, 0);
+  CHECK(linkWatchStats().lateMs == cfg.lateMinMs);
+}
+
+static void testLadder() {
+  const LinkWatchConfig cfg = linkWatchDefaultConfig();
+  linkWatchReset(cfg, 0);
+  const uint32_t t0 = feed(0, 50, 100, 0);
+  const uint32_t late = linkWatchStats().lateMs;
+  CHECK(linkWatchUpdate(t0 + late) == LINK_OK);
+  CHECK(linkWatchUpdate(t0 + late + 1) == LINK_HOLD);
+  CHECK(linkWatchUpdate(t0 + late + cfg.holdMs) == LINK_HOLD);
+  CHECK(linkWatchUpdate(t0 + late + cfg.holdMs + 1) == LINK_DECEL);
+  CHECK(linkWatchUpdate(t0 + late + cfg.holdMs + cfg.decelMs) == LINK_DECEL);
+  CHECK(linkWatchUpdate(t0 + late + cfg.holdMs + cfg.decelMs + 1) == LINK_CUT);
+  LinkWatchStats s = linkWatchStats();
+  CHECK(s.holds == 1 && s.decels == 1 && s.cuts == 1);
+
+  // A packet restores OK at once; a stage skipped in one tick still counts.
+  const uint32_t t1 = t0 + 3000;
+  linkWatchPacket(t1);
+  CHECK(linkWatchUpdate(t1) == LINK_OK);
+  CHECK(linkWatchUpdate(t1 + late + cfg.holdMs + 1) == LINK_DECEL);
+  s = linkWatchStats();
+  CHECK(s.holds == 2 && s.decels == 2 && s.cuts == 1);
+}
+
+// ===== Full loop scenarios =====
+// App drives at 80 % sending every 100 ms; `dropped(t)` says whether the
+// datagram due at t ms (since the start of the scenario) is lost. With
+// `stale` it still arrives but cmd_guard rejects it, so the network side
+// only reports activity.
+
+struct LoopResult {
+  uint32_t firstBrakeMs;   // first tick with duty below cruise, from the drop
+  uint32_t stopMs;         // duty reached zero, from the drop
+  float dutySeconds;       // integral of duty after the drop (%·s), ~distance
+  uint8_t minDuty;
+  bool relayDropped;
+  uint8_t maxStage;        // highest link stage after the drop
+  uint8_t finalMode;
+};
+
+static void startLoop() {
+  Serial.setSink(nullptr);
+  simHalReset();
+  simAdvanceMs(1);
+  simSetAnalogMv(PIN_BATTERY_FB, 2134);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000);
+  controlInit();
+}
+
+static ControlCommand drive80() {
+  ControlCommand c = {80, 0, 0, 80, REAR_RAMP_MS, false, false, 50, false, false, 0, false, 0, false};
+  return c;
+}
+
+template <typename Dropped>
+static LoopResult runScenario(uint32_t dropAtMs, uint32_t totalMs, Dropped dropped, bool stale = false) {
+  startLoop();
+  const NetMsg msg = {NET_MSG_COMMAND, drive80()};
+  const NetMsg activity = {NET_MSG_ACTIVITY, ControlCommand()};
+  LoopResult r = {0, 0, 0.0f, 100, false, 0, 0};
+  uint8_t cruise = 0;
+  for (uint32_t t = 0; t < totalMs; t++) {
+    if (t % 100 == 0) {
+      if (!(t >= dropAtMs && dropped(t - dropAtMs))) netQueuePush(msg);
+      else if (stale) netQueuePush(activity);
+    }
+    simAdvanceMs(1);
+    controlLoop();
+    const uint8_t duty = rearGetDutyPct();
+    if (t + 1 == dropAtMs) cruise = duty;
+    if (t < dropAtMs) continue;
+    const uint32_t since = t - dropAtMs;
+    if (!r.firstBrakeMs && duty < cruise) r.firstBrakeMs = since;
+    if (!r.stopMs && duty == 0) r.stopMs = since;
+    if (duty < r.minDuty) r.minDuty = duty;
+    if (simGetDigitalOut(PIN_RELAY_EN) == LOW) r.relayDropped = true;
+    r.dutySeconds += duty / 1000.0f;
+    TelemetrySnapshot snap;
+    telemetryRead(snap);
+    if (snap.linkStage > r.maxStage) r.maxStage = snap.linkStage;
+  }
+  TelemetrySnapshot snap;
+  telemetryRead(snap);
+  r.finalMode = snap.mode;
+  return r;
+}
+
+static void testDropouts() {
+  const uint32_t kDrop = 3000;
+  // Short hiccup (two datagrams lost): the last command is held.
+  LoopResult r = runScenario(kDrop, kDrop + 2000, [](uint32_t t) { return t < 300; });
+  printf("300 ms dropout: min duty %u%%, relay dropped %d\n", (unsigned)r.minDuty, r.relayDropped ? 1 : 0);
+  CHECK(r.minDuty >= 79);
+  CHECK(!r.relayDropped);
+  CHECK(r.finalMode == CTL_REMOTE);
+
+  // Periodic loss of every third datagram: jitter widens the threshold and
+  // the car never brakes.
+  r = runScenario(kDrop, kDrop + 5000, [](uint32_t t) { return (t / 100) % 3 == 0; });
+  printf("1/3 loss: min duty %u%%\n", (unsigned)r.minDuty);
+  CHECK(r.minDuty >= 79);
+
+  // 800 ms outage: braking starts, the car recovers when the app returns.
+  r = runScenario(kDrop, kDrop + 3000, [](uint32_t t) { return t < 800; });
+  printf("800 ms dropout: brake at %u ms, min duty %u%%, relay dropped %d\n", (unsigned)r.firstBrakeMs,
+         (unsigned)r.minDuty, r.relayDropped ? 1 : 0);
+  CHECK(r.firstBrakeMs > 0 && r.minDuty < 79);
+  CHECK(!r.relayDropped);
+  CHECK(r.finalMode == CTL_REMOTE);
+
+  // Phone stalls for good.
+  r = runScenario(kDrop, kDrop + 4000, [](uint32_t) { return true; });
+  // The old loop: full throttle until 2 s of silence, then emergency stop.
+  const float legacyStop = 2000.0f + 80.0f * 1000.0f / REAR_EDECEL_PCT_S;
+  const float legacyDutySeconds = 80.0f * 2.0f + 80.0f * 80.0f / (2.0f * REAR_EDECEL_PCT_S);
+  printf("stall: brake at %u ms, stopped at %u ms, %.1f %%s (legacy ~%.0f ms, %.1f %%s)\n",
+         (unsigned)r.firstBrakeMs, (unsigned)r.stopMs, r.dutySeconds, legacyStop, legacyDutySeconds);
+  CHECK(r.firstBrakeMs <= LINK_LATE_MIN_MS + LINK_HOLD_MS + 120);
+  CHECK(r.stopMs > 0 && r.stopMs < 1500);
+  CHECK(r.dutySeconds < legacyDutySeconds / 2);
+  CHECK(r.finalMode == CTL_MANUAL);
+
+  // Sender still there but every frame stale (or unparseable): the datagrams
+  // keep the LED connected, not the ladder, which brakes and cuts as above.
+  const LoopResult stale = runScenario(kDrop, kDrop + 4000, [](uint32_t) { return true; }, true);
+  TelemetrySnapshot snap;
+  telemetryRead(snap);
+  printf("stale frames: brake at %u ms, stopped at %u ms, stage %u, app shown connected %d\n",
+         (unsigned)stale.firstBrakeMs, (unsigned)stale.stopMs, (unsigned)stale.maxStage, snap.appConnected ? 1 : 0);
+  CHECK(stale.firstBrakeMs == r.firstBrakeMs && stale.stopMs == r.stopMs);
+  CHECK(stale.maxStage == LINK_CUT);
+  CHECK(stale.finalMode == CTL_MANUAL);
+  CHECK(snap.appConnected);
+}
+
+int main() {
+  testAdaptiveThreshold();
+  testLadder();
+  testDropouts();
+  printf("link_watch: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+// Rear motion profile against a simple DC motor + vehicle model: limits on
+// duty rate and jerk, smooth launch, reversal coast, emergency stop.
+
+#include "motion_profile.h"
+#include "motor_rear.h"
+#include "sim_hal.h"
+#include "config.h"
+#include "pins.h"
+#include "test_check.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static const uint32_t TICK_US = 1000;
+static const float DT = 0.001f;
+
+static const MotionLimits kManual = {REAR_MANUAL_ACCEL_PCT_S, REAR_MANUAL_DECEL_PCT_S, REAR_EDECEL_PCT_S,
+                                     REAR_MANUAL_JERK_PCT_S2, REAR_COAST_MS};
+
+// Two brushed motors driving a ~30 kg car + child through a gearbox,
+// reduced to the wheel: armature current from duty and back-EMF, static
+// friction holds the car until the motor force breaks it away.
+struct Vehicle {
+  float v = 0.0f;    // m/s
+  float a = 0.0f;    // m/s^2
+  float amps = 0.0f; // armature current
+  void step(float dutyPct) {
+    const float vbat = 12.0f, rArm = 0.4f, ke = 3.0f, kf = 3.0f;
+    const float mass = 30.0f, rolling = 12.0f, breakaway = 25.0f;
+    amps = (vbat * dutyPct / 100.0f - ke * v) / rArm;
+    float force = kf * amps;
+    if (v == 0.0f && fabsf(force) < breakaway) force = 0.0f;
+    if (v != 0.0f) force -= (v > 0.0f ? rolling : -rolling);
+    const float aNew = force / mass;
+    const float vNew = v + aNew * DT;
+    // Friction stops the car, it does not push it backwards.
+    v = (v != 0.0f && vNew * v < 0.0f) ? 0.0f : vNew;
+    a = aNew;
+  }
+};
+
+struct Trace {
+  float maxDutyStep = 0.0f;  // |d duty| per tick
+  float maxRateStep = 0.0f;  // |d rate| per tick
+  float maxCurrentStep = 0.0f; // A per tick
+  float maxAccel = 0.0f;
+};
+
+static void track(MotionState& s, const MotionLimits& lim, float target, bool emergency, int ticks,
+                  Vehicle& car, Trace& tr) {
+  for (int i = 0; i < ticks; i++) {
+    const float d0 = s.duty, r0 = s.rate, i0 = car.amps;
+    motionStep(s, lim, target, emergency, TICK_US);
+    car.step(s.duty);
+    tr.maxDutyStep = fmaxf(tr.maxDutyStep, fabsf(s.duty - d0));
+    tr.maxRateStep = fmaxf(tr.maxRateStep, fabsf(s.rate - r0));
+    tr.maxCurrentStep = fmaxf(tr.maxCurrentStep, fabsf(car.amps - i0));
+    tr.maxAccel = fmaxf(tr.maxAccel, fabsf(car.a));
+  }
+}
+
+// The previous rearSetSpeed: jump to the soft-start duty, then a linear ramp.
+static Trace legacyLaunch(float target, int ticks) {
+  Vehicle car;
+  Trace tr;
+  float duty = REAR_SOFTSTART_MIN_PCT;
+  for (int i = 0; i < ticks; i++) {
+    const float i0 = car.amps;
+    car.step(duty);
+    tr.maxCurrentStep = fmaxf(tr.maxCurrentStep, fabsf(car.amps - i0));
+    tr.maxAccel = fmaxf(tr.maxAccel, fabsf(car.a));
+    duty = fminf(target, duty + 100.0f * DT * 1000.0f / REAR_RAMP_MS);
+  }
+  return tr;
+}
+
+static void testLaunch() {
+  MotionState s;
+  motionReset(s);
+  Vehicle car;
+  Trace tr;
+  track(s, kManual, 60.0f, false, 3000, car, tr);
+  CHECK(s.duty == 60.0f && s.rate == 0.0f);
+  CHECK(tr.maxDutyStep <= REAR_MANUAL_ACCEL_PCT_S * DT + 1e-4f);
+  // The landing tick zeroes what is left of the rate: at most two jerk steps.
+  CHECK(tr.maxRateStep <= 2.0f * REAR_MANUAL_JERK_PCT_S2 * DT);
+  CHECK(car.v > 0.0f);
+
+  MotionState first;
+  motionReset(first);
+  motionStep(first, kManual, 60.0f, false, TICK_US);
+  CHECK(first.duty < 0.01f); // no soft-start step
+
+  const Trace legacy = legacyLaunch(60.0f, 3000);
+  printf("launch: current step %.2f A/tick (legacy %.2f), peak accel %.2f m/s^2 (legacy %.2f)\n",
+         tr.maxCurrentStep, legacy.maxCurrentStep, tr.maxAccel, legacy.maxAccel);
+  CHECK(tr.maxCurrentStep * 10.0f < legacy.maxCurrentStep);
+  CHECK(tr.maxAccel < legacy.maxAccel);
+}
+
+static void testNoOvershoot() {
+  MotionState s;
+  motionReset(s);
+  float peak = 0.0f;
+  for (int i = 0; i < 3000; i++) {
+    peak = fmaxf(peak, motionStep(s, kManual, 40.0f, false, TICK_US));
+  }
+  CHECK(peak <= 40.0f);
+  CHECK(s.duty == 40.0f);
+
+  // Release: decel limit, lands on zero.
+  Vehicle car;
+  Trace tr;
+  track(s, kManual, 0.0f, false, 2000, car, tr);
+  CHECK(s.duty == 0.0f);
+  CHECK(tr.maxDutyStep <= REAR_MANUAL_DECEL_PCT_S * DT + 1e-4f);
+}
+
+static void testReversal() {
+  MotionState s;
+  motionReset(s);
+  for (int i = 0; i < 3000; i++) motionStep(s, kManual, 50.0f, false, TICK_US);
+  int zeroTicks = 0;
+  int ticksToReverse = 0;
+  float prev = s.duty;
+  for (int i = 0; i < 5000; i++) {
+    const float d = motionStep(s, kManual, -50.0f, false, TICK_US);
+    CHECK(!(prev > 0.0f && d < 0.0f)); // never jumps across zero
+    if (d == 0.0f) zeroTicks++;
+    if (d < 0.0f && ticksToReverse == 0) ticksToReverse = i;
+    prev = d;
+  }
+  CHECK(zeroTicks >= (int)REAR_COAST_MS);
+  CHECK(zeroTicks <= (int)REAR_COAST_MS + 2);
+  CHECK(ticksToReverse > 0);
+  CHECK(s.duty == -50.0f);
+
+  // Braking towards zero and asked for a little forward again: the leftover
+  // braking rate must not produce reverse duty.
+  motionReset(s);
+  for (int i = 0; i < 3000; i++) motionStep(s, kManual, 30.0f, false, TICK_US);
+  for (int i = 0; i < 3000 && s.duty > 1.0f; i++) motionStep(s, kManual, 0.0f, false, TICK_US);
+  for (int i = 0; i < 2000; i++) CHECK(motionStep(s, kManual, 5.0f, false, TICK_US) >= 0.0f);
+}
+
+static void testEmergency() {
+  MotionState s;
+  motionReset(s);
+  for (int i = 0; i < 5000; i++) motionStep(s, kManual, 100.0f, false, TICK_US);
+  CHECK(s.duty == 100.0f);
+  const int bound = (int)(100.0f / REAR_EDECEL_PCT_S / DT) + 1;
+  int ticks = 0;
+  while (s.duty != 0.0f && ticks < 10000) {
+    motionStep(s, kManual, 0.0f, true, TICK_US);
+    ticks++;
+  }
+  CHECK(ticks <= bound);
+}
+
+static void testRearDriver() {
+  simHalReset();
+  rearSetMode(REAR_MODE_REMOTE);
+  rearSetRampMs(600);
+  rearSetSpeed(0, 0);
+  // 200 ms into a launch the bridge sees a small, growing duty, not 20 %.
+  uint32_t last = 0;
+  bool rising = true;
+  for (int i = 0; i < 200; i++) {
+    simAdvanceUs(TICK_US);
+    rearSetSpeed(80, TICK_US);
+    const uint32_t duty = simGetLedcDuty(CH_BTS_R);
+    if (duty < last) rising = false;
+    last = duty;
+  }
+  CHECK(rising);
+  CHECK(last > 0 && last < (uint32_t)(((1 << PWM_RES) - 1) * REAR_SOFTSTART_MIN_PCT / 100));
+  CHECK(simGetLedcDuty(CH_BTS_L) == 0);
+  for (int i = 0; i < 5000; i++) {
+    simAdvanceUs(TICK_US);
+    rearEmergencyStop(TICK_US);
+  }
+  CHECK(simGetLedcDuty(CH_BTS_R) == 0 && rearGetDutyPct() == 0);
+}
+
+static void testFadeOffload() {
+  simHalReset();
+  rearSetMode(REAR_MODE_MANUAL);
+  rearSetSpeed(0, 0);
+  simHalResetCounters();
+  const RearPwmStats before = rearGetPwmStats();
+  // The bridge follows the profile within one fade segment of ramping, and
+  // ends exactly on it.
+  const uint32_t maxDuty = (1 << PWM_RES) - 1;
+  const uint32_t segSlack = (uint32_t)(REAR_MANUAL_ACCEL_PCT_S * REAR_FADE_SEGMENT_MS / 1000.0f * maxDuty / 100.0f) + 2;
+  bool tracked = true;
+  for (int i = 0; i < 3000; i++) {
+    simAdvanceUs(TICK_US);
+    rearSetSpeed(70, TICK_US);
+    const uint32_t hw = simGetLedcDuty(CH_BTS_R);
+    const uint32_t sw = (uint32_t)rearGetDutyPct() * maxDuty / 100;
+    if ((hw > sw ? hw - sw : sw - hw) > segSlack) tracked = false;
+  }
+  CHECK(tracked);
+  CHECK(simGetLedcDuty(CH_BTS_R) == (uint32_t)(0.70f * maxDuty + 0.5f));
+  const SimHalCounters& c = simHalCounters();
+  const RearPwmStats after = rearGetPwmStats();
+  printf("3 s launch: %u duty writes, %u fades (was 6000 writes)\n", (unsigned)c.ledcWrites,
+         (unsigned)c.ledcFades);
+  CHECK(c.ledcWrites + c.ledcFades <= 3000 / REAR_FADE_SEGMENT_MS + 4);
+  CHECK(after.fades - before.fades == c.ledcFades);
+  CHECK(after.writes - before.writes == c.ledcWrites);
+
+  // Holding the speed costs nothing.
+  simHalResetCounters();
+  for (int i = 0; i < 1000; i++) {
+    simAdvanceUs(TICK_US);
+    rearSetSpeed(70, TICK_US);
+  }
+  CHECK(simHalCounters().ledcWrites == 0 && simHalCounters().ledcFades == 0);
+
+  // Emergency stop interrupts a fade and follows the linear e-decel.
+  for (int i = 0; i < 5; i++) {
+    simAdvanceUs(TICK_US);
+    rearEmergencyStop(TICK_US);
+  }
+  CHECK(simGetLedcDuty(CH_BTS_R) < (uint32_t)(0.70f * maxDuty));
+  for (int i = 0; i < 1000; i++) {
+    simAdvanceUs(TICK_US);
+    rearEmergencyStop(TICK_US);
+  }
+  CHECK(simGetLedcDuty(CH_BTS_R) == 0);
+}
+
+int main() {
+  testLaunch();
+  testNoOvershoot();
+  testReversal();
+  testEmergency();
+  testRearDriver();
+  testFadeOffload();
+  printf("motion profile: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// Loop profiler: log2 bucket edges, min/max/avg and percentiles, the text
+// report (whole lines only), the diagnostics query parser, a PROF_SCOPE
+// around a known busy-wait, and what a scope itself costs.
+
+#include "profiler.h"
+#include "protocol.h"
+#include "test_check.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+static void testBuckets() {
+  CHECK(profBucket(0) == 0);
+  CHECK(profBucket(1) == 1);
+  CHECK(profBucket(2) == 2);
+  CHECK(profBucket(3) == 2);
+  CHECK(profBucket(4) == 3);
+  CHECK(profBucket(1023) == 10);
+  CHECK(profBucket(1024) == 11);
+  CHECK(profBucket(0xFFFFFFFFu) == PROF_BUCKETS - 1);
+  // Every sample is below its bucket's upper bound (except the open last one).
+  for (uint32_t c = 1; c < (1u << 20); c = c * 3 + 1) {
+    const uint8_t b = profBucket(c);
+    CHECK(c < (1u << b) && c >= (1u << (b - 1)));
+  }
+}
+
+static void testStats() {
+  profReset();
+  for (uint32_t i = 0; i < 98; i++) profRecord(PROF_REAR, 300);
+  profRecord(PROF_REAR, 100);
+  profRecord(PROF_REAR, 5000);
+  const ProfStats& st = profStats(PROF_REAR);
+  CHECK(st.count == 100);
+  CHECK(st.minCycles == 100);
+  CHECK(st.maxCycles == 5000);
+  CHECK(st.sumCycles == 98 * 300 + 100 + 5000);
+  CHECK(st.hist[profBucket(300)] == 98);
+  CHECK(profPercentileCycles(PROF_REAR, 50) == 512);
+  CHECK(profPercentileCycles(PROF_REAR, 99) == 512);
+  CHECK(profPercentileCycles(PROF_REAR, 100) == 8192);
+  CHECK(profPercentileCycles(PROF_LED, 99) == 0);
+
+  // Overlong samples land in the last bucket; its bound is the real max.
+  profRecord(PROF_LED, 0x80000000u);
+  CHECK(profPercentileCycles(PROF_LED, 100) == 0x80000000u);
+
+  char out[1024];
+  const size_t n = profFormat(out, sizeof(out));
+  CHECK(n == strlen(out));
+  CHECK(strncmp(out, "rear    n=100 ", 14) == 0);
+  CHECK(strstr(out, " 9:98 ") != nullptr);
+  CHECK(strstr(out, "\nled ") != nullptr);
+  CHECK(strstr(out, "loop") == nullptr); // no samples, no line
+
+  // A short buffer gets whole lines only.
+  char small[200];
+  const size_t m = profFormat(small, sizeof(small));
+  CHECK(m > 0 && m < n && small[m - 1] == '\n' && strchr(small, '\n') == small + m - 1);
+  char tiny[16];
+  CHECK(profFormat(tiny, sizeof(tiny)) == 0 && tiny[0] == 0);
+
+  profReset();
+  CHECK(profStats(PROF_REAR).count == 0 && profFormat(out, sizeof(out)) == 0);
+}
+
+static void testDiagQuery() {
+  const auto q = [](const char* s) { return protocolParseDiag((const uint8_t*)s, strlen(s)); };
+  CHECK(q("prof") == DIAG_PROF);
+  CHECK(q("prof\n") == DIAG_PROF);
+  CHECK(q("prof reset\r\n") == DIAG_PROF_RESET);
+  CHECK(q("prof  reset") == DIAG_NONE);
+  CHECK(q("{\"throttle\":0}") == DIAG_NONE);
+  CHECK(q("pro") == DIAG_NONE);
+  CHECK(q("") == DIAG_NONE);
+}
+
+static void spinNs(uint64_t ns) {
+  const auto t0 = std::chrono::steady_clock::now();
+  while ((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0)
+           .count() < ns) {
+  }
+}
+
+static void testScope() {
+  profReset();
+  for (int i = 0; i < 50; i++) {
+    PROF_SCOPE(PROF_PARSE);
+    spinNs(20000);
+  }
+  const ProfStats& st = profStats(PROF_PARSE);
+  CHECK(st.count == 50);
+  CHECK(st.minCycles >= 20000 * halCyclesPerUs() / 1000);
+  printf("20 us busy-wait: min=%.1fus avg=%.1fus max=%.1fus\n", st.minCycles / (double)halCyclesPerUs(),
+         (double)st.sumCycles / st.count / halCyclesPerUs(), st.maxCycles / (double)halCyclesPerUs());
+
+  // Cost of an empty scope: two counter reads and one record.
+  profReset();
+  const uint32_t kScopes = 1000000;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < kScopes; i++) {
+    PROF_SCOPE(PROF_LED);
+  }
+  const double ns =
+    std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / kScopes;
+  printf("empty PROF_SCOPE: %.1f ns on host (recorded avg %.1f ns)\n", ns,
+         (double)profStats(PROF_LED).sumCycles / profStats(PROF_LED).count);
+  CHECK(profStats(PROF_LED).count == kScopes);
+  profReset();
+}
+
+int main() {
+  testBuckets();
+  testStats();
+  testDiagQuery();
+  testScope();
+  printf("profiler: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
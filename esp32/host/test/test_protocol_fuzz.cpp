@@ -0,0 +1,404 @@
+// Fuzzes the JSON tokenizer and the binary frame decoder.
+//  - random bytes and mutated packets must never crash or read past the NUL
+//    (build with -DKIDCAR_SANITIZE=ON to have ASan check the latter),
+//  - anything accepted must come out inside the protocol clamps,
+//  - generated well-formed packets must decode to the expected values,
+//  - with ArduinoJson available, in-range packets must match the old parser.
+
+#include "protocol.h"
+#include "config.h"
+#include "test_check.h"
+#if defined(KIDCAR_HAVE_ARDUINOJSON)
+#include "protocol_json_ref.h"
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include <string>
+
+static uint32_t gRng = 0x12345678u;
+
+static uint32_t rnd() {
+  gRng ^= gRng << 13;
+  gRng ^= gRng >> 17;
+  gRng ^= gRng << 5;
+  return gRng;
+}
+
+static int rndRange(int lo, int hi) {
+  return lo + (int)(rnd() % (uint32_t)(hi - lo + 1));
+}
+
+// CHECK with the offending input printed, first 10 failures only.
+#define CHECK_INPUT(cond, input)                                        \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      if (gFailures++ < 10) {                                           \
+        printf("FAIL %s:%d %s\n  input: %s\n", __FILE__, __LINE__, #cond, \
+               (input).c_str());                                        \
+      }                                                                 \
+    }                                                                   \
+  } while (0)
+
+static bool inRange(const ControlCommand& c) {
+  return c.throttle >= -100 && c.throttle <= 100 && c.steer >= -100 && c.steer <= 100 &&
+         c.steerMs <= STEER_MAX_MS && c.speed >= 0 && c.speed <= 100 && c.accelMs >= 100 &&
+         c.accelMs <= 5000 && c.reverseSpeed <= 100 && !(c.steer != 0 && c.steerMs == 0);
+}
+
+// Copies into an exact-size heap block so over-reads are visible to ASan.
+static bool parseExact(const std::string& text, ControlCommand& out) {
+  char* buf = (char*)malloc(text.size() + 1);
+  memcpy(buf, text.c_str(), text.size() + 1);
+  const bool ok = protocolParse(buf, out);
+  free(buf);
+  return ok;
+}
+
+static const char* const kJunkValues[] = {
+  "null", "true", "false", "\"x\"", "\"\\\"esc\\\\\"", "1.5", "-2e3", "[]", "{}",
+  "[1,[2,{\"a\":[3]}]]", "{\"nested\":{\"throttle\":99}}", "\"throttle\"", "0",
+};
+
+struct Expected {
+  ControlCommand cmd;
+  std::string text;
+};
+
+static Expected makeDoc(bool inRangeOnly, bool withJunk) {
+  Expected e;
+  e.cmd = {0, 0, STEER_MAX_MS, 0, REAR_RAMP_MS, false, false, 50, false, false, 0, false, 0, false};
+  const char* ws[] = {"", " ", "\n\t", "  "};
+  std::string body;
+  int fields = 0;
+  int8_t mode = -1;
+  bool manual = false;
+  auto add = [&](const std::string& kv) {
+    if (fields++ > 0) body += std::string(ws[rnd() % 4]) + ",";
+    body += ws[rnd() % 4] + kv + ws[rnd() % 4];
+  };
+  const int lo = inRangeOnly ? 0 : -2000;
+  const int hi = inRangeOnly ? 0 : 9000;
+  for (int k = 0; k < 12; k++) {
+    if (rnd() % 3 == 0) continue;
+    int v;
+    switch (k) {
+      case 0:
+        v = rndRange(-100 + lo, 100 + hi);
+        add("\"throttle\":" + std::to_string(v));
+        e.cmd.throttle = v < -100 ? -100 : (v > 100 ? 100 : v);
+        break;
+      case 1:
+        v = rndRange(-100 + lo, 100 + hi);
+        add("\"steer\":" + std::to_string(v));
+        e.cmd.steer = v < -100 ? -100 : (v > 100 ? 100 : v);
+        break;
+      case 2:
+        v = rndRange(0, STEER_MAX_MS + hi);
+        add("\"steer_ms\":" + std::to_string(v));
+        e.cmd.steerMs = (uint16_t)(v > STEER_MAX_MS ? STEER_MAX_MS : v);
+        break;
+      case 3:
+        v = rndRange(0 + lo, 100 + hi);
+        add("\"speed\":" + std::to_string(v));
+        e.cmd.speed = v < 0 ? 0 : (v > 100 ? 100 : v);
+        break;
+      case 4:
+        v = rndRange(100, 5000 + hi);
+        add("\"accel_ms\":" + std::to_string(v));
+        e.cmd.accelMs = (uint16_t)(v > 5000 ? 5000 : v);
+        break;
+      case 5:
+        manual = rnd() & 1;
+        add(std::string("\"manual\":") + (manual ? "true" : "false"));
+        break;
+      case 6:
+        e.cmd.park = rnd() & 1;
+        add(std::string("\"park\":") + (e.cmd.park ? "true" : "false"));
+        break;
+      case 7:
+        v = rndRange(0, 100 + hi);
+        add("\"reverse_speed\":" + std::to_string(v));
+        e.cmd.reverseSpeed = (uint8_t)(v > 100 ? 100 : v);
+        break;
+      case 8: {
+        static const char* const modes[] = {"manual", "MANUAL", "remote", "REMOTE", "other"};
+        const int m = rndRange(0, 4);
+        add(std::string("\"mode\":\"") + modes[m] + "\"");
+        mode = (m < 2) ? 1 : (m < 4 ? 0 : -1);
+        break;
+      }
+      case 9:
+        e.cmd.binaryStatus = rnd() & 1;
+        add(std::string("\"bin_status\":") + (e.cmd.binaryStatus ? "true" : "false"));
+        break;
+      case 10:
+        e.cmd.hasSeq = true;
+        e.cmd.seq = (uint16_t)rnd();
+        add("\"seq\":" + std::to_string(e.cmd.seq));
+        break;
+      case 11:
+        e.cmd.hasSentMs = true;
+        e.cmd.sentMs = rnd();
+        add("\"sent_ms\":" + std::to_string(e.cmd.sentMs));
+        break;
+    }
+    if (withJunk && rnd() % 2 == 0) {
+      const int j = rndRange(0, (int)(sizeof(kJunkValues) / sizeof(kJunkValues[0])) - 1);
+      add("\"extra_" + std::to_string(k) + "\":" + kJunkValues[j]);
+    }
+  }
+  e.cmd.manualMode = (mode >= 0) ? (mode == 1) : manual;
+  if (e.cmd.steer != 0 && e.cmd.steerMs == 0) e.cmd.steerMs = STEER_MAX_MS;
+  e.text = std::string(ws[rnd() % 4]) + "{" + body + "}";
+  return e;
+}
+
+static bool sameCommand(const ControlCommand& a, const ControlCommand& b) {
+  return a.throttle == b.throttle && a.steer == b.steer && a.steerMs == b.steerMs &&
+         a.speed == b.speed && a.accelMs == b.accelMs && a.manualMode == b.manualMode &&
+         a.park == b.park && a.reverseSpeed == b.reverseSpeed && a.binaryStatus == b.binaryStatus &&
+         a.hasSeq == b.hasSeq && a.seq == b.seq && a.hasSentMs == b.hasSentMs && a.sentMs == b.sentMs &&
+         a.steerAbs == b.steerAbs;
+}
+
+static void fuzzRandomBytes(int iterations) {
+  static const char alphabet[] = "{}[]\":,-0123456789.eE tfnrulase\\x_";
+  for (int i = 0; i < iterations; i++) {
+    std::string s;
+    const int len = rndRange(0, 96);
+    for (int j = 0; j < len; j++) {
+      s += (rnd() & 1) ? alphabet[rnd() % (sizeof(alphabet) - 1)] : (char)rndRange(1, 255);
+    }
+    ControlCommand c = {};
+    if (parseExact(s, c)) CHECK_INPUT(inRange(c), s);
+  }
+}
+
+static void fuzzMutations(int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    std::string s = makeDoc(false, true).text;
+    const int edits = rndRange(1, 4);
+    for (int e = 0; e < edits && !s.empty(); e++) {
+      const size_t pos = rnd() % s.size();
+      switch (rnd() % 3) {
+        case 0: s[pos] = (char)rndRange(1, 255); break;
+        case 1: s.erase(pos, 1); break;
+        default: s.insert(pos, 1, "{}[]\",:\\"[rnd() % 8]); break;
+      }
+    }
+    ControlCommand c = {};
+    if (parseExact(s, c)) CHECK_INPUT(inRange(c), s);
+  }
+}
+
+static void checkGenerated(int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    const Expected e = makeDoc(false, (i & 1) != 0);
+    ControlCommand c = {};
+    const bool ok = parseExact(e.text, c);
+    CHECK_INPUT(ok, e.text);
+    CHECK_INPUT(!ok || sameCommand(c, e.cmd), e.text);
+  }
+}
+
+static void checkRejects() {
+  static const char* const bad[] = {
+    "", "   ", "[]", "{", "{\"throttle\"", "{\"throttle\":}", "{\"throttle\":1,}",
+    "{\"throttle\":1 \"steer\":2}", "{throttle:1}", "{\"a\":\"unterminated}", "{\"a\":tru}",
+    "{\"a\":-}", "{\"a\":1.}", "{\"a\":[1,2}", "{\"a\":[[[[[[[[[[[[1]]]]]]]]]]]]}",
+  };
+  for (const char* b : bad) {
+    ControlCommand c = {};
+    const std::string s(b);
+    CHECK_INPUT(!parseExact(s, c), s);
+  }
+}
+
+// Absolute steer target: steer_pos replaces a timed steer in the same packet.
+static void checkSteerPos() {
+  ControlCommand c = {};
+  std::string s = "{\"steer\":40,\"steer_pos\":-250}";
+  CHECK_INPUT(parseExact(s, c) && c.steerAbs && c.steer == -100, s);
+  s = "{\"steer_pos\":0}";
+  CHECK_INPUT(parseExact(s, c) && c.steerAbs && c.steer == 0, s);
+  s = "{\"steer\":40,\"steer_pos\":\"x\"}";
+  CHECK_INPUT(parseExact(s, c) && !c.steerAbs && c.steer == 40, s);
+  s = "{\"steer\":-30}";
+  CHECK_INPUT(parseExact(s, c) && !c.steerAbs, s);
+}
+
+// Fractional and exponent values are truncated toward zero (as ArduinoJson
+// did), then clamped; timestamps stay integer-only.
+static void checkFractions() {
+  struct Case {
+    const char* text;
+    int throttle;
+  };
+  static const Case cases[] = {
+    {"{\"throttle\":50.5}", 50},   {"{\"throttle\":-50.9}", -50}, {"{\"throttle\":0.99}", 0},
+    {"{\"throttle\":-0.5}", 0},    {"{\"throttle\":5e1}", 50},    {"{\"throttle\":1.25E1}", 12},
+    {"{\"throttle\":4.56e+1}", 45}, {"{\"throttle\":7500e-2}", 75}, {"{\"throttle\":1e-9}", 0},
+    {"{\"throttle\":250.5}", 100}, {"{\"throttle\":-1e99}", -100}, {"{\"throttle\":1.5e400}", 100},
+  };
+  for (const Case& k : cases) {
+    ControlCommand c = {};
+    const std::string s(k.text);
+    CHECK_INPUT(parseExact(s, c) && c.throttle == k.throttle, s);
+  }
+  ControlCommand c = {};
+  std::string s = "{\"speed\":33.3,\"accel_ms\":12.5e2,\"steer_pos\":-20.7}";
+  CHECK_INPUT(parseExact(s, c) && c.speed == 33 && c.accelMs == 1250 && c.steerAbs && c.steer == -20, s);
+  s = "{\"seq\":12.5,\"sent_ms\":1e3}";
+  CHECK_INPUT(parseExact(s, c) && !c.hasSeq && !c.hasSentMs, s);
+}
+
+#if defined(KIDCAR_HAVE_ARDUINOJSON)
+static void checkAgainstArduinoJson(int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    const Expected e = makeDoc(true, false);
+    ControlCommand a = {};
+    ControlCommand b = {};
+    const bool okA = parseExact(e.text, a);
+    const bool okB = protocolParseArduinoJson(e.text.c_str(), b);
+    CHECK_INPUT(okA == okB, e.text);
+    CHECK_INPUT(!okA || sameCommand(a, b), e.text);
+  }
+}
+#endif
+
+static void fuzzFrames(int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    ControlCommand in = {rndRange(-100, 100), rndRange(-100, 100), (uint16_t)rndRange(0, STEER_MAX_MS),
+                         rndRange(0, 100), (uint16_t)rndRange(100, 5000), (rnd() & 1) != 0,
+                         (rnd() & 1) != 0, (uint8_t)rndRange(0, 100), (rnd() & 1) != 0,
+                         true, (uint16_t)rnd(), true, rnd(), (rnd() & 1) != 0};
+    if (in.steer != 0 && in.steerMs == 0) in.steerMs = STEER_MAX_MS;
+    uint8_t frame[CMD_FRAME_LEN];
+    const std::string tag = "frame #" + std::to_string(i);
+    CHECK_INPUT(protocolEncodeFrame(in, frame, sizeof(frame)) == CMD_FRAME_LEN, tag);
+    ControlCommand out = {};
+    CHECK_INPUT(protocolDecodeFrame(frame, CMD_FRAME_LEN, out) && sameCommand(in, out), tag);
+
+    // v1 frames (no seq/timestamp) are still accepted.
+    uint8_t v1[CMD_FRAME_V1_LEN];
+    memcpy(v1, frame, CMD_FRAME_V1_LEN - 1);
+    v1[1] = 1;
+    v1[CMD_FRAME_V1_LEN - 1] = protocolCrc8(v1, CMD_FRAME_V1_LEN - 1);
+    CHECK_INPUT(protocolDecodeFrame(v1, CMD_FRAME_V1_LEN, out) && !out.hasSeq && !out.hasSentMs, tag);
+
+    // Any single-bit flip must be rejected (CRC-8 detects all of them).
+    const int bit = rndRange(0, (int)CMD_FRAME_LEN * 8 - 1);
+    frame[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+    CHECK_INPUT(!protocolDecodeFrame(frame, CMD_FRAME_LEN, out), tag);
+
+    uint8_t junk[CMD_FRAME_LEN + 4];
+    for (uint8_t& b : junk) b = (uint8_t)rnd();
+    const size_t len = (size_t)rndRange(0, (int)sizeof(junk));
+    if (protocolDecodeFrame(junk, len, out)) CHECK_INPUT(inRange(out), tag);
+  }
+}
+
+static void fuzzEstopFrames(int iterations) {
+  for (uint8_t action = 0; action <= 1; action++) {
+    uint8_t frame[ESTOP_FRAME_LEN];
+    CHECK_INPUT(protocolEncodeEstop(action, frame, sizeof(frame)) == ESTOP_FRAME_LEN, std::string("estop encode"));
+    uint8_t out = 0xFF;
+    CHECK_INPUT(protocolDecodeEstop(frame, sizeof(frame), out) && out == action, std::string("estop round trip"));
+    // Never mistaken for a command frame, and every bit flip is rejected.
+    CHECK_INPUT(protocolIsEstopFrame(frame, sizeof(frame)) && !protocolIsCommandFrame(frame, sizeof(frame)),
+                std::string("estop dispatch"));
+    for (int bit = 0; bit < (int)ESTOP_FRAME_LEN * 8; bit++) {
+      uint8_t flipped[ESTOP_FRAME_LEN];
+      memcpy(flipped, frame, sizeof(flipped));
+      flipped[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+      CHECK_INPUT(!protocolDecodeEstop(flipped, sizeof(flipped), out), std::string("estop bit flip"));
+    }
+  }
+  for (int i = 0; i < iterations; i++) {
+    uint8_t junk[ESTOP_FRAME_LEN + 2];
+    for (uint8_t& b : junk) b = (uint8_t)rnd();
+    junk[0] = ESTOP_FRAME_MAGIC;
+    const size_t len = (size_t)rndRange(0, (int)sizeof(junk));
+    uint8_t action = 0xFF;
+    if (protocolDecodeEstop(junk, len, action)) {
+      CHECK_INPUT(action <= ESTOP_ACTION_STOP, "estop junk #" + std::to_string(i));
+    }
+  }
+}
+
+static void checkStatusFrames(int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    StatusReport in = {};
+    in.clients = (uint8_t)rndRange(0, 4);
+    in.manualActive = rnd() & 1;
+    in.manualGear = (int8_t)rndRange(-1, 1);
+    in.driveDir = (int8_t)rndRange(-1, 1);
+    in.driveSpeedPct = (uint8_t)rndRange(0, 100);
+    in.selectorFwd = rnd() & 1;
+    in.selectorBack = rnd() & 1;
+    in.selectorThrottleV = (float)rndRange(0, 3300) / 1000.0f;
+    in.selectorThrottlePct = (uint8_t)rndRange(0, 100);
+    in.batteryV = (float)rndRange(0, 20000) / 1000.0f;
+    in.uptimeMs = rnd();
+    in.rxCoalesced = (uint16_t)rnd();
+    in.rxOutOfOrder = (uint16_t)rnd();
+    in.rxStale = (uint16_t)rnd();
+    in.batterySocPct = (uint8_t)rndRange(0, 100);
+    in.runtimeMin = (uint16_t)rnd();
+    in.ctlMode = (uint8_t)rndRange(0, 6);
+    in.linkStage = (uint8_t)rndRange(0, 3);
+    in.motorPeakA = (float)rndRange(0, 60000) / 1000.0f;
+    in.motorAvgA = (float)rndRange(0, 60000) / 1000.0f;
+    in.motorHeatPct = (uint8_t)rndRange(0, 255);
+    in.currentLimited = rnd() & 1;
+    in.powerLimitPct = (uint8_t)rndRange(0, 100);
+    in.derateEvents = (uint16_t)rnd();
+
+    const std::string tag = "status #" + std::to_string(i);
+    uint8_t frame[STATUS_FRAME_LEN];
+    CHECK_INPUT(protocolEncodeStatusFrame(in, frame, sizeof(frame)) == STATUS_FRAME_LEN, tag);
+    StatusReport out = {};
+    CHECK_INPUT(protocolDecodeStatusFrame(frame, sizeof(frame), out), tag);
+    CHECK_INPUT(out.clients == in.clients && out.manualActive == in.manualActive &&
+                    out.manualGear == in.manualGear && out.driveDir == in.driveDir &&
+                    out.driveSpeedPct == in.driveSpeedPct && out.selectorFwd == in.selectorFwd &&
+                    out.selectorBack == in.selectorBack &&
+                    out.selectorThrottlePct == in.selectorThrottlePct && out.uptimeMs == in.uptimeMs &&
+                    out.rxCoalesced == in.rxCoalesced && out.rxOutOfOrder == in.rxOutOfOrder &&
+                    out.rxStale == in.rxStale && out.batterySocPct == in.batterySocPct &&
+                    out.runtimeMin == in.runtimeMin && out.ctlMode == in.ctlMode &&
+                    out.linkStage == in.linkStage && out.motorHeatPct == in.motorHeatPct &&
+                    out.currentLimited == in.currentLimited && out.powerLimitPct == in.powerLimitPct &&
+                    out.derateEvents == in.derateEvents,
+                tag);
+    CHECK_INPUT(fabsf(out.batteryV - in.batteryV) < 0.0011f &&
+                    fabsf(out.selectorThrottleV - in.selectorThrottleV) < 0.0011f &&
+                    fabsf(out.motorPeakA - in.motorPeakA) < 0.0011f && fabsf(out.motorAvgA - in.motorAvgA) < 0.0011f,
+                tag);
+
+    char json[512];
+    CHECK_INPUT(protocolFormatStatusJson(in, json, sizeof(json)) > 0, tag);
+  }
+}
+
+int main(int argc, char** argv) {
+  const int iterations = (argc > 1) ? atoi(argv[1]) : 100000;
+  if (argc > 2) gRng = (uint32_t)strtoul(argv[2], nullptr, 0);
+
+  checkRejects();
+  checkSteerPos();
+  checkFractions();
+  fuzzRandomBytes(iterations);
+  fuzzMutations(iterations);
+  checkGenerated(iterations);
+#if defined(KIDCAR_HAVE_ARDUINOJSON)
+  checkAgainstArduinoJson(iterations);
+#endif
+  fuzzFrames(iterations);
+  fuzzEstopFrames(iterations);
+  checkStatusFrames(iterations / 10);
+
+  printf("protocol fuzz: %d iterations, %d failures\n", iterations, gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "vehicle_model.h"
+#include "motor_current.h"
+#include "motor_rear.h"
+#include "speed_ctl.h"
+#include "sensors.h"
+#include "sim_hal.h"
+#include "pins.h"
+#include "hal.h"
+
+// ===== Rear drive against the vehicle plant =====
+// Shared start for the tests that drive the BTS7960 bridge themselves
+// (rearSetSpeed once per 1 ms tick) against the simulator's vehicle model
+// (sim/vehicle_model.h), relay bypassed.
+
+// 50 kg car on `crr` (0.015 floor, 0.08 grass); the pack sags only with rInt.
+inline VehicleParams rearTestCar(float packV, float crr, float rInt = 0.0f) {
+  VehicleParams p = vehicleDefaultParams();
+  p.packOcvV = packV;
+  p.packROhm = rInt;
+  p.crr = crr;
+  p.relayFitted = false;
+  return p;
+}
+
+// Board, plant and rear chain from power-up: sensors seeded from the plant,
+// current sense and speed loop reset, remote mode with `rampMs`, no power
+// limit.
+inline void rearTestStart(const VehicleParams& car, bool closedLoop, uint16_t rampMs = 1000) {
+  simHalReset();
+  simAdvanceMs(1);
+  halPcntBegin(PIN_WHEEL_ENC);
+  vehicleReset(car);
+  sensorsInit();
+  currentInit();
+  rearCut();
+  rearSetMode(REAR_MODE_REMOTE);
+  rearSetRampMs(rampMs);
+  rearSetPowerLimit(100.0f, 1.0f);
+  speedCtlInit(closedLoop);
+}
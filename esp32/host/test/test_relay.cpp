@@ -0,0 +1,153 @@
+// Relay policy: hold window, partial precharge, cycle cap, forced off; and
+// the stop-start latency it saves against the old drop-on-stop behaviour.
+
+#include "relay.h"
+#include "control.h"
+#include "motor_rear.h"
+#include "sim_hal.h"
+#include "config.h"
+#include "pins.h"
+#include "test_check.h"
+
+#include <stdio.h>
+
+// The old controlLoop: relay off as soon as motion stops, full precharge
+// delay on every start, no cap.
+static const RelayPolicyConfig kLegacy = {0, RELAY_PRECHARGE_MS, 0, 0};
+
+// Press for pressMs, release for gapMs, `taps` times; returns the summed
+// press-to-ready latency and the relay cycles it cost.
+static uint32_t tapLatency(const RelayPolicyConfig& cfg, int taps, uint32_t pressMs, uint32_t gapMs,
+                           uint32_t* cycles) {
+  uint32_t now = 1000;
+  relayPolicyReset(cfg, now);
+  uint32_t total = 0;
+  for (int t = 0; t < taps; t++) {
+    bool ready = false;
+    for (uint32_t ms = 0; ms < pressMs; ms++, now++) {
+      const bool r = relayPolicyUpdate(true, false, now);
+      if (r && !ready) total += ms;
+      ready = ready || r;
+    }
+    if (!ready) total += pressMs;
+    for (uint32_t ms = 0; ms < gapMs; ms++, now++) relayPolicyUpdate(false, false, now);
+  }
+  *cycles = relayPolicyStats().cycles;
+  return total;
+}
+
+static void testLatency() {
+  uint32_t legacyCycles = 0, cycles = 0;
+  const uint32_t legacy = tapLatency(kLegacy, 10, 400, 600, &legacyCycles);
+  const uint32_t held = tapLatency(relayDefaultConfig(), 10, 400, 600, &cycles);
+  printf("10 taps: dead input %u ms, %u relay cycles (legacy %u ms, %u cycles)\n", (unsigned)held,
+         (unsigned)cycles, (unsigned)legacy, (unsigned)legacyCycles);
+  CHECK(legacy == 10 * RELAY_PRECHARGE_MS);
+  CHECK(legacyCycles == 10);
+  CHECK(held == RELAY_PRECHARGE_MS); // only the first press precharges
+  CHECK(cycles == 1);
+}
+
+static void testHoldAndIdleOff() {
+  uint32_t now = 5000;
+  relayPolicyReset(relayDefaultConfig(), now);
+  CHECK(!relayPolicyUpdate(true, false, now));
+  CHECK(relayPolicyOn() && relayPolicyState() == RELAY_PRECHARGE);
+  now += RELAY_PRECHARGE_MS;
+  CHECK(relayPolicyUpdate(true, false, now));
+  relayPolicyUpdate(false, false, ++now);
+  CHECK(relayPolicyState() == RELAY_HOLD);
+  // The window counts from the last tick with motion.
+  now += RELAY_HOLD_MS - 2;
+  relayPolicyUpdate(false, false, now);
+  CHECK(relayPolicyOn());
+  relayPolicyUpdate(false, false, ++now);
+  CHECK(!relayPolicyOn());
+
+  // Re-armed after a short off time: only part of the precharge is needed.
+  now += RELAY_DISCHARGE_MS / 4;
+  CHECK(!relayPolicyUpdate(true, false, now));
+  now += RELAY_PRECHARGE_MS / 4 + 1;
+  CHECK(relayPolicyUpdate(true, false, now));
+
+  // Forced off wins immediately, also inside the hold window.
+  relayPolicyUpdate(false, false, ++now);
+  CHECK(!relayPolicyUpdate(false, true, ++now));
+  CHECK(!relayPolicyOn());
+}
+
+static void testCycleCap() {
+  RelayPolicyConfig cfg = relayDefaultConfig();
+  cfg.holdMs = 100;
+  cfg.maxCyclesPerMin = 3;
+  uint32_t now = 100000;
+  relayPolicyReset(cfg, now);
+  // Long idle gaps would normally cycle the relay on every press.
+  for (int i = 0; i < 6; i++) {
+    for (int ms = 0; ms < 300; ms++) relayPolicyUpdate(true, false, now++);
+    for (int ms = 0; ms < 2000; ms++) relayPolicyUpdate(false, false, now++);
+  }
+  const RelayStats s = relayPolicyStats();
+  CHECK(s.cycles == 3);
+  CHECK(s.capDeferrals >= 1);
+  CHECK(relayPolicyOn());
+  // Once the oldest cycle is a minute old the relay may drop again.
+  for (int ms = 0; ms < 60000; ms++) relayPolicyUpdate(false, false, now++);
+  CHECK(!relayPolicyOn());
+}
+
+// Full control loop in manual mode: a second press inside the hold window
+// starts the rear ramp as soon as the input task has seen it.
+static void testControlLoop() {
+  Serial.setSink(nullptr);
+  simHalReset();
+  simAdvanceMs(1);
+  simSetAnalogMv(PIN_BATTERY_FB, 2134);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000);
+  controlInit();
+  auto run = [](uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      simAdvanceMs(1);
+      controlLoop();
+    }
+  };
+  auto pressToMotionMs = [&](uint32_t limit) {
+    simSetDigitalIn(PIN_MANUAL_FWD, LOW);
+    simSetAnalogMv(PIN_MANUAL_THROTTLE, 500);
+    // First tick the rear output starts ramping (a fade is queued).
+    const uint32_t fades = simHalCounters().ledcFades;
+    for (uint32_t ms = 1; ms <= limit; ms++) {
+      run(1);
+      if (simHalCounters().ledcFades != fades) return ms;
+    }
+    return limit;
+  };
+  auto release = [&]() {
+    simSetDigitalIn(PIN_MANUAL_FWD, HIGH);
+    simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000);
+  };
+  run(20);
+  const uint32_t first = pressToMotionMs(500);
+  run(1000);
+  release();
+  run(1500);
+  CHECK(rearGetDutyPct() == 0);
+  CHECK(simGetDigitalOut(PIN_RELAY_EN) == HIGH);
+  const uint32_t second = pressToMotionMs(500);
+  printf("control loop: first press %u ms, press after 1.5 s stop %u ms\n", (unsigned)first,
+         (unsigned)second);
+  CHECK(first >= RELAY_PRECHARGE_MS);
+  CHECK(second <= 10); // input sampling only
+  release();
+  run(RELAY_HOLD_MS + 100);
+  CHECK(simGetDigitalOut(PIN_RELAY_EN) == LOW);
+}
+
+int main() {
+  testLatency();
+  testHoldAndIdleOff();
+  testCycleCap();
+  testControlLoop();
+  printf("relay: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
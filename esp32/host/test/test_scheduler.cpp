@@ -0,0 +1,104 @@
+// Fixed-grid timing, overrun skipping and jitter counters of the scheduler.
+
+#include "scheduler.h"
+#include "sim_hal.h"
+#include "test_check.h"
+
+#include <stdio.h>
+
+static uint32_t gFastRuns = 0;
+static uint32_t gSlowRuns = 0;
+static uint32_t gLastDt = 0;
+static uint32_t gFastExecUs = 0;
+
+static void fastTask(uint32_t dtUs) {
+  gFastRuns++;
+  gLastDt = dtUs;
+  simAdvanceUs(gFastExecUs);
+}
+
+static void slowTask(uint32_t) {
+  gSlowRuns++;
+}
+
+static SchedTask gTasks[] = {
+  {"fast", fastTask, 1000, 0, {}},
+  {"slow", slowTask, 10000, 0, {}},
+};
+static const uint8_t COUNT = 2;
+
+static void reset() {
+  simHalReset();
+  gFastRuns = gSlowRuns = gLastDt = gFastExecUs = 0;
+  schedInit(gTasks, COUNT, (uint32_t)simNowUs());
+}
+
+static void testRates() {
+  reset();
+  // Poll every 100 us for 100 ms.
+  for (int i = 0; i < 1000; i++) {
+    simAdvanceUs(100);
+    schedRun(gTasks, COUNT, (uint32_t)simNowUs());
+  }
+  CHECK(gFastRuns == 100);
+  CHECK(gSlowRuns == 10);
+  CHECK(gLastDt == 1000);
+  CHECK(gTasks[0].stats.overruns == 0);
+  CHECK(gTasks[0].stats.maxLateUs == 0);
+}
+
+static void testNoDrift() {
+  reset();
+  // Uneven polling: the grid keeps the average rate exact.
+  const uint32_t steps[] = {300, 900, 500, 700};
+  for (int i = 0; i < 400; i++) {
+    simAdvanceUs(steps[i % 4]);
+    schedRun(gTasks, COUNT, (uint32_t)simNowUs());
+  }
+  // 240 ms elapsed.
+  CHECK(gFastRuns == 240);
+  CHECK(gSlowRuns == 24);
+  CHECK(gTasks[0].stats.overruns == 0);
+  CHECK(gTasks[0].stats.maxLateUs < 900);
+  CHECK(gTasks[0].stats.maxLateUs > 0);
+}
+
+static void testOverrun() {
+  reset();
+  simAdvanceUs(1000);
+  schedRun(gTasks, COUNT, (uint32_t)simNowUs());
+  CHECK(gFastRuns == 1);
+  // A 3.5 ms stall: the 2 and 3 ms slots are skipped, not replayed, and the
+  // 4 ms slot runs 500 us late.
+  simAdvanceUs(3500);
+  schedRun(gTasks, COUNT, (uint32_t)simNowUs());
+  CHECK(gFastRuns == 2);
+  CHECK(gTasks[0].stats.overruns == 2);
+  CHECK(gTasks[0].stats.maxLateUs == 500);
+  simAdvanceUs(400);
+  schedRun(gTasks, COUNT, (uint32_t)simNowUs());
+  CHECK(gFastRuns == 2);
+  simAdvanceUs(100);
+  schedRun(gTasks, COUNT, (uint32_t)simNowUs());
+  CHECK(gFastRuns == 3);
+}
+
+static void testExecTime() {
+  reset();
+  gFastExecUs = 250;
+  simAdvanceUs(1000);
+  schedRun(gTasks, COUNT, (uint32_t)simNowUs());
+  CHECK(gTasks[0].stats.maxExecUs == 250);
+  schedResetStats(gTasks, COUNT);
+  CHECK(gTasks[0].stats.runs == 0);
+  CHECK(gTasks[0].stats.maxExecUs == 0);
+}
+
+int main() {
+  testRates();
+  testNoDrift();
+  testOverrun();
+  testExecTime();
+  printf("scheduler: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+// Sensor cache: DMA frames and direct reads feed the filters; polling between
+// frames does no ADC work; the motor current, chopped by the bridge PWM,
+// reads as its duty-weighted average at any duty and PWM phase.
+
+#include "sensors.h"
+#include "sim_hal.h"
+#include "pins.h"
+#include "hal.h"
+#include "config.h"
+#include "test_check.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static bool near(float a, float b, float tol) {
+  return fabsf(a - b) <= tol;
+}
+
+static void testSeedAndStream() {
+  simHalReset();
+  simSetAnalogMv(PIN_BATTERY_FB, 2000);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000);
+  sensorsInit();
+  CHECK(simAdcStreamRunning());
+  CHECK(sensorsGetStats().streaming);
+  CHECK(near(sensorsPinVoltage(SENSOR_BATTERY), 2.0f, 0.01f));
+  CHECK(near(sensorsPinVoltage(SENSOR_THROTTLE), 3.0f, 0.01f));
+
+  // Battery is streamed: polls before a frame is complete change nothing and
+  // cost no conversions on it.
+  simSetAnalogMv(PIN_BATTERY_FB, 1000);
+  simHalResetCounters();
+  sensorsPoll();
+  CHECK(sensorsGetStats().frames == 0);
+  CHECK(near(sensorsPinVoltage(SENSOR_BATTERY), 2.0f, 0.01f));
+
+  // One frame moves the battery filter part of the way; many settle it.
+  simAdvanceMs(2);
+  sensorsPoll();
+  CHECK(sensorsGetStats().frames == 1);
+  const float v = sensorsPinVoltage(SENSOR_BATTERY);
+  CHECK(v < 2.0f && v > 1.0f);
+  for (int i = 0; i < 200; i++) {
+    simAdvanceMs(2);
+    sensorsPoll();
+  }
+  CHECK(near(sensorsPinVoltage(SENSOR_BATTERY), 1.0f, 0.01f));
+  CHECK(simHalCounters().adcFrames == 201);
+}
+
+static void testDirectFallback() {
+  simHalReset();
+  simSetAnalogMv(PIN_BATTERY_FB, 2000);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000);
+  sensorsInit();
+
+  // The pedal pin is not streamable; it gets exactly one conversion per poll.
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 500);
+  simHalResetCounters();
+  for (int i = 0; i < 20; i++) {
+    simAdvanceMs(5);
+    sensorsPoll();
+  }
+  CHECK(simHalCounters().analogReads == (halAdcStreamCapable(PIN_MANUAL_THROTTLE) ? 0u : 20u));
+  CHECK(near(sensorsPinVoltage(SENSOR_THROTTLE), 0.5f, 0.01f));
+}
+
+// The IS pin carries the on-time current during the high side's on part of
+// each PWM period and nothing after it.
+static void testChoppedCurrent() {
+  static const float kOnV = 2.0f;
+  static const float kDuties[] = {5.0f, 7.0f, 10.0f, 33.0f, 50.0f, 62.0f, 90.0f, 100.0f};
+  // One sample of the period's on/off pattern: 1/N of the on level, plus
+  // the ADC step.
+  const float tol = kOnV / ADC_STREAM_SAMPLES_PER_PIN + 0.005f;
+  float worst = 0.0f;
+  for (float duty : kDuties) {
+    simHalReset();
+    simSetAnalogMv(PIN_BATTERY_FB, 2000);
+    simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000);
+    simSetAnalogPwmMv(PIN_BTS_IS, (uint16_t)(kOnV * 1000.0f), duty, PWM_FREQ);
+    sensorsInit();
+    const uint32_t before = sensorsUpdates(SENSOR_MOTOR_CURRENT);
+    for (int i = 0; i < 200; i++) {
+      // Polls land at varying PWM phases.
+      simAdvanceUs(2000 + (uint32_t)(i * 37) % 53);
+      sensorsPoll();
+      const float want = kOnV * duty / 100.0f;
+      const float got = sensorsPinVoltage(SENSOR_MOTOR_CURRENT);
+      if (fabsf(got - want) > worst) worst = fabsf(got - want);
+      CHECK(near(got, want, tol));
+    }
+    CHECK(sensorsUpdates(SENSOR_MOTOR_CURRENT) - before == 200);
+  }
+  printf("chopped IS: worst error %.0f mV of %.0f mV on, tolerance %.0f mV\n", worst * 1000.0f, kOnV * 1000.0f,
+         tol * 1000.0f);
+
+  // What a stream locked to the PWM makes of it (20 kHz over two pins: one
+  // IS sample every two periods): all on or all off depending on where in
+  // the period the stream started (off the edges), never the average.
+  const uint16_t onRaw = (uint16_t)((kOnV * 1000.0f * 4095.0f + 1650.0f) / 3300.0f);
+  int onFrames = 0, offFrames = 0;
+  for (uint32_t startUs = 2; startUs < 50; startUs += 5) {
+    simHalReset();
+    simAdvanceUs(startUs);
+    simSetAnalogMv(PIN_BATTERY_FB, 2000);
+    simSetAnalogPwmMv(PIN_BTS_IS, (uint16_t)(kOnV * 1000.0f), 50.0f, PWM_FREQ);
+    const uint8_t pins[] = {(uint8_t)PIN_BATTERY_FB, (uint8_t)PIN_BTS_IS};
+    CHECK(halAdcStreamStart(pins, 2, 20, (uint32_t)PWM_FREQ));
+    for (int i = 0; i < 20; i++) {
+      simAdvanceUs(2000 + (uint32_t)(i * 37) % 53);
+      uint16_t raw[2];
+      if (!halAdcStreamRead(raw, 2)) continue;
+      if (raw[1] == onRaw) onFrames++;
+      else if (raw[1] == 0) offFrames++;
+    }
+  }
+  CHECK(onFrames + offFrames == 200 && onFrames > 0 && offFrames > 0);
+  // The rate the firmware uses is off the PWM harmonics.
+  CHECK(((uint32_t)PWM_FREQ * 2u) % sensorsStreamSampleHz(2) != 0);
+}
+
+int main() {
+  testSeedAndStream();
+  testDirectFallback();
+  testChoppedCurrent();
+  printf("sensors: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+// SpscQueue: FIFO order, full/empty edges, and a two-thread stress run that
+// checks nothing is lost, duplicated or reordered.
+
+#include "spsc_queue.h"
+#include "test_check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+static void testEdges() {
+  SpscQueue<uint32_t, 4> q;
+  uint32_t v = 0;
+  CHECK(!q.pop(v));
+  for (uint32_t i = 0; i < 4; i++) CHECK(q.push(i));
+  CHECK(!q.push(99));
+  CHECK(q.size() == 4);
+  for (uint32_t i = 0; i < 4; i++) CHECK(q.pop(v) && v == i);
+  CHECK(!q.pop(v));
+
+  // Indices keep running past the capacity without losing order.
+  for (uint32_t i = 0; i < 1000; i++) {
+    CHECK(q.push(i));
+    CHECK(q.pop(v) && v == i);
+  }
+}
+
+struct Item {
+  uint32_t seq;
+  uint32_t check;
+};
+
+static void testThreads(uint32_t count) {
+  static SpscQueue<Item, 16> q;
+  std::thread producer([count]() {
+    for (uint32_t i = 0; i < count;) {
+      if (q.push(Item{i, ~i})) {
+        i++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  uint32_t bad = 0;
+  while (expected < count) {
+    Item it;
+    if (!q.pop(it)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (it.seq != expected || it.check != ~expected) bad++;
+    expected = it.seq + 1;
+  }
+  producer.join();
+  CHECK(bad == 0);
+  CHECK(q.size() == 0);
+}
+
+int main(int argc, char** argv) {
+  const uint32_t count = (argc > 1) ? (uint32_t)strtoul(argv[1], nullptr, 10) : 500000u;
+  testEdges();
+  testThreads(count);
+  printf("spsc queue: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+// Steering actuator against a rack model: a held timed command no longer
+// stalls the motor on the end stop for the whole hold; absolute targets
+// centre repeatably although the real rack is slower than configured; the
+// estimate's uncertainty always covers the real position; the bridge coasts
+// before reversing; and the direction pins are written only on changes.
+
+#include "motor_steer.h"
+#include "control.h"
+#include "net_queue.h"
+#include "sim_hal.h"
+#include "config.h"
+#include "pins.h"
+#include "test_check.h"
+
+#include <math.h>
+#include <stdio.h>
+
+static const float kHalfMs = STEER_TRAVEL_MS / 2.0f;
+
+// Rack: moves `speed` of the configured rate while the bridge drives it,
+// and stops hard at the ends. Position in configured-rate ms from centre.
+struct Rack {
+  float speed;
+  float pos;
+  uint32_t stallMs;
+  uint32_t badReversals; // IN1 to IN2 (or back) without the coast dwell
+  int8_t lastDrive;
+  uint32_t offMs;
+  float worstMiss;       // real position outside estimate +/- uncertainty (ms)
+
+  void step() {
+    const int in1 = simGetDigitalOut(PIN_L298_IN1);
+    const int in2 = simGetDigitalOut(PIN_L298_IN2);
+    const int8_t d = (in1 && !in2) ? 1 : ((in2 && !in1) ? -1 : 0);
+    if (d == 0) {
+      offMs++;
+    } else {
+      if (d == -lastDrive && offMs < STEER_REVERSE_DWELL_MS) badReversals++;
+      lastDrive = d;
+      offMs = 0;
+    }
+    if (d != 0) {
+      const float next = pos + d * speed;
+      if (next > kHalfMs || next < -kHalfMs) stallMs++;
+      pos = next > kHalfMs ? kHalfMs : (next < -kHalfMs ? -kHalfMs : next);
+    }
+    const SteerState s = steerGetState();
+    const float miss = fabsf(pos - s.positionPct * kHalfMs / 100.0f) - s.uncertaintyPct * kHalfMs / 100.0f;
+    if (miss > worstMiss) worstMiss = miss;
+  }
+};
+
+static Rack startRack(float speed, float pos) {
+  simHalReset();
+  simAdvanceMs(1);
+  steerReset();
+  simHalResetCounters();
+  Rack r = {speed, pos, 0, 0, 0, 1000, 0.0f};
+  return r;
+}
+
+template <typename Cmd>
+static void run(Rack& rack, uint32_t ms, Cmd cmd) {
+  for (uint32_t t = 0; t < ms; t++) {
+    simAdvanceMs(1);
+    cmd();
+    steerLoop();
+    rack.step();
+  }
+}
+
+static void testHeldTimedCommand() {
+  // The app holds "right" for 8 s, resending 200 ms pulses every tick. The
+  // old driver pushed the end time forward on every call and rewrote both
+  // pins: 8 s of motor on, most of it stalled on the stop.
+  const uint32_t kHoldMs = 8000;
+  Rack rack = startRack(0.95f, 0.0f);
+  run(rack, kHoldMs, [] { steerStart(1, 200); });
+  const uint32_t legacyStall = kHoldMs - (uint32_t)(kHalfMs / 0.95f);
+  const uint32_t legacyWrites = 2 * kHoldMs;
+  printf("8 s right hold: stalled %lu ms (legacy %lu), pin writes %lu (legacy %lu)\n",
+         (unsigned long)rack.stallMs, (unsigned long)legacyStall, (unsigned long)simHalCounters().digitalWrites,
+         (unsigned long)legacyWrites);
+  CHECK(rack.stallMs <= kHalfMs + STEER_ENDSTOP_MS);
+  CHECK(simGetDigitalOut(PIN_L298_IN1) == LOW);
+  CHECK(steerGetState().homed && steerGetStats().endStops == 1);
+  CHECK(simHalCounters().digitalWrites <= 4);
+  CHECK(fabsf(rack.pos - kHalfMs) < 1.0f);
+
+  // Homed now: the next push into the same stop costs only the margin.
+  run(rack, 100, [] { steerStop(); });
+  run(rack, 1000, [] { steerStart(-1, 200); });
+  run(rack, 100, [] { steerStop(); });
+  const uint32_t before = rack.stallMs;
+  run(rack, 3000, [] { steerStart(-1, 200); });
+  CHECK(rack.stallMs - before <= STEER_ENDSTOP_MS + 0.2f * kHalfMs);
+
+  // STEER_MAX_MS still bounds a hold (the end stop normally ends it much
+  // earlier), and a still-held button does not restart it.
+  rack = startRack(0.95f, 0.0f);
+  run(rack, STEER_MAX_MS + 1000, [] { steerStart(1, 200); });
+  CHECK(steerGetStats().holdCutoffs == 1);
+  CHECK(simGetDigitalOut(PIN_L298_IN1) == LOW);
+  run(rack, 100, [] { steerStop(); });
+  run(rack, 100, [] { steerStart(-1, 200); });
+  CHECK(simGetDigitalOut(PIN_L298_IN2) == HIGH); // released, other way
+}
+
+static void testAbsoluteTargets() {
+  Rack rack = startRack(0.95f, 0.0f);
+  static const int kSeq[] = {100, 0, -100, 0, 40, -60, 0, 100, 20, -20, 0, -100, 0};
+  float worstCentre = 0.0f;
+  uint32_t worstCentreMs = 0;
+  for (int round = 0; round < 5; round++) {
+    for (int target : kSeq) {
+      uint32_t settle = 0;
+      for (uint32_t t = 0; t < 3000; t++) {
+        simAdvanceMs(1);
+        steerTarget(target);
+        steerLoop();
+        rack.step();
+        if (steerNeedsMove(target)) settle = t + 1;
+      }
+      if (target == 0 && steerGetState().homed) {
+        const float err = fabsf(rack.pos);
+        if (err > worstCentre) worstCentre = err;
+        if (settle > worstCentreMs) worstCentreMs = settle;
+      }
+    }
+  }
+  const float allowed = (1.0f - rack.speed) * kHalfMs + STEER_DEADBAND_MS + 2.0f;
+  printf("absolute targets, rack 5%% slow: centre error max %.0f ms of %.0f (%.1f%% of lock), settle max %lu ms\n",
+         worstCentre, kHalfMs, 100.0f * worstCentre / kHalfMs, (unsigned long)worstCentreMs);
+  printf("  estimate miss beyond uncertainty %.1f ms, end stops %lu, bad reversals %lu\n", rack.worstMiss,
+         (unsigned long)steerGetStats().endStops, (unsigned long)rack.badReversals);
+  CHECK(worstCentre <= allowed);
+  CHECK(worstCentreMs <= kHalfMs / rack.speed + 2 * STEER_REVERSE_DWELL_MS);
+  CHECK(rack.worstMiss <= 1.0f);
+  CHECK(rack.badReversals == 0);
+  // Every lock in the sequence re-zeroes the estimate.
+  CHECK(steerGetStats().endStops >= 5 * 4);
+
+  // Reaching a full-lock target stalls the motor only for the estimate's
+  // uncertainty (two half-travel moves since the last stop) plus the margin.
+  const uint32_t stall = rack.stallMs;
+  run(rack, 2000, [] { steerTarget(100); });
+  run(rack, 2000, [] { steerTarget(100); });
+  printf("  stall to reach a lock from centre: %lu ms\n", (unsigned long)(rack.stallMs - stall));
+  CHECK(rack.stallMs - stall <= STEER_ENDSTOP_MS + 2 * STEER_DRIFT_PCT / 100.0f * kHalfMs + 1);
+  CHECK(!steerNeedsMove(100));
+}
+
+static void testControlLoop() {
+  Serial.setSink(nullptr);
+  simHalReset();
+  simAdvanceMs(1);
+  simSetAnalogMv(PIN_BATTERY_FB, 2134);
+  simSetAnalogMv(PIN_MANUAL_THROTTLE, 3000);
+  controlInit();
+  simHalResetCounters();
+  Rack rack = {0.95f, 0.0f, 0, 0, 0, 1000, 0.0f};
+  ControlCommand c = {0, 100, 0, 50, REAR_RAMP_MS, false, false, 50, false, false, 0, false, 0, true};
+  for (uint32_t t = 0; t < 6000; t++) {
+    if (t == 3000) c.steer = 0;
+    if (t % 50 == 0) netQueuePush(NetMsg{NET_MSG_COMMAND, c});
+    simAdvanceMs(1);
+    controlLoop();
+    rack.step();
+  }
+  printf("control loop: steer to lock and back to centre, rack at %.0f ms, %lu GPIO writes in 6 s\n", rack.pos,
+         (unsigned long)simHalCounters().digitalWrites);
+  CHECK(steerGetState().homed);
+  CHECK(fabsf(rack.pos) <= (1.0f - rack.speed) * kHalfMs + STEER_DEADBAND_MS + 2.0f);
+  CHECK(simHalCounters().digitalWrites < 20);
+}
+
+int main() {
+  testHeldTimedCommand();
+  testAbsoluteTargets();
+  testControlLoop();
+  printf("steer: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}
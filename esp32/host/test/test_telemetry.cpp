@@ -0,0 +1,73 @@
+// Seqlock snapshot: a reader racing a writer must only ever see snapshots
+// whose fields all come from the same tick.
+
+#include "telemetry.h"
+#include "test_check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+
+static TelemetrySnapshot makeSnap(uint32_t tick) {
+  TelemetrySnapshot s = {};
+  s.tick = tick;
+  s.ms = tick * 7u;
+  s.batteryV = (float)(tick % 1000u) * 0.02f;
+  s.appConnected = (tick & 1u) != 0;
+  s.manualActive = (tick & 2u) != 0;
+  s.relayOn = (tick & 4u) != 0;
+  s.manualGear = (int8_t)((int)(tick % 3u) - 1);
+  s.driveDir = (int8_t)((int)((tick / 3u) % 3u) - 1);
+  s.driveSpeedPct = (uint8_t)(tick % 101u);
+  s.selectorFwd = (tick & 8u) != 0;
+  s.selectorBack = (tick & 16u) != 0;
+  s.selectorThrottleV = (float)(tick % 3300u) / 1000.0f;
+  s.selectorThrottlePct = (uint8_t)((tick * 3u) % 101u);
+  return s;
+}
+
+static bool consistent(const TelemetrySnapshot& s) {
+  const TelemetrySnapshot e = makeSnap(s.tick);
+  return s.ms == e.ms && s.batteryV == e.batteryV && s.appConnected == e.appConnected &&
+         s.manualActive == e.manualActive && s.relayOn == e.relayOn &&
+         s.manualGear == e.manualGear && s.driveDir == e.driveDir &&
+         s.driveSpeedPct == e.driveSpeedPct && s.selectorFwd == e.selectorFwd &&
+         s.selectorBack == e.selectorBack && s.selectorThrottleV == e.selectorThrottleV &&
+         s.selectorThrottlePct == e.selectorThrottlePct;
+}
+
+int main(int argc, char** argv) {
+  const uint32_t ticks = (argc > 1) ? (uint32_t)strtoul(argv[1], nullptr, 10) : 2000000u;
+  std::atomic<bool> done{false};
+
+  telemetryPublish(makeSnap(0));
+  std::thread writer([&]() {
+    for (uint32_t t = 1; t <= ticks; t++) telemetryPublish(makeSnap(t));
+    done.store(true);
+  });
+
+  uint32_t reads = 0;
+  uint32_t torn = 0;
+  uint32_t backwards = 0;
+  uint32_t last = 0;
+  while (!done.load()) {
+    TelemetrySnapshot s;
+    telemetryRead(s);
+    reads++;
+    if (!consistent(s)) torn++;
+    if (s.tick < last) backwards++;
+    last = s.tick;
+  }
+  writer.join();
+
+  TelemetrySnapshot final;
+  telemetryRead(final);
+  printf("telemetry: %u reads, %u torn, %u backwards\n", reads, torn, backwards);
+  CHECK(torn == 0);
+  CHECK(backwards == 0);
+  CHECK(final.tick == ticks);
+  CHECK(consistent(final));
+  printf("telemetry: %d failures\n", gFailures);
+  return gFailures == 0 ? 0 : 1;
+}